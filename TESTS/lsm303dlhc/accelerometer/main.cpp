@@ -1,10 +1,16 @@
+#include "HeapBlockDevice.h"
+#include "LittleFileSystem.h"
 #include "greentea-client/test_env.h"
 #include "lsm303dlhc_driver.h"
+#include "lsm303dlhc_persistent_state.h"
 #include "math.h"
 #include "mbed.h"
 #include "rtos.h"
 #include "unity.h"
 #include "utest.h"
+#if MBED_CONF_LSM303DLHC_DRIVER_PERSISTENT_STATE_KVSTORE
+#include "kvstore_global_api.h"
+#endif
 
 using namespace utest::v1;
 using namespace lsm303dlhc;
@@ -215,6 +221,893 @@ void test_fifo_interrupt_usage()
     TEST_ASSERT_FLOAT_WITHIN(1.0f, 9.8f, a_abs);
 }
 
+/**
+ * Test FIFO overrun detection and sample loss accounting.
+ */
+void test_fifo_overrun_accounting()
+{
+    int16_t samples[LSM303DLHCAccelerometer::FIFO_SIZE][3];
+    LSM303DLHCAccelerometer::BlockInfo block_info;
+    LSM303DLHCAccelerometer::LossStatistics loss_stats;
+    int n;
+
+    acc->set_output_data_rate(LSM303DLHCAccelerometer::ODR_100HZ);
+    acc->set_fifo_mode(LSM303DLHCAccelerometer::FIFO_ENABLE);
+    acc->clear_fifo();
+    acc->reset_loss_statistics();
+
+    // fast drain shouldn't lose anything
+    ThisThread::sleep_for(100ms);
+    n = acc->read_fifo_data_16(samples, LSM303DLHCAccelerometer::FIFO_SIZE, &block_info);
+    TEST_ASSERT_INT_WITHIN(3, 10, n);
+    TEST_ASSERT_FALSE(block_info.overrun);
+    TEST_ASSERT_EQUAL(0, block_info.lost_samples);
+
+    // late drain: ~100 samples are produced, so ~68 samples should be lost
+    ThisThread::sleep_for(1000ms);
+    n = acc->read_fifo_data_16(samples, LSM303DLHCAccelerometer::FIFO_SIZE, &block_info);
+    TEST_ASSERT_EQUAL(LSM303DLHCAccelerometer::FIFO_SIZE, n);
+    TEST_ASSERT_TRUE(block_info.overrun);
+    TEST_ASSERT_INT_WITHIN(10, 68, block_info.lost_samples);
+
+    acc->get_loss_statistics(&loss_stats);
+    TEST_ASSERT_EQUAL(2, loss_stats.reads);
+    TEST_ASSERT_EQUAL(1, loss_stats.overruns);
+    TEST_ASSERT_EQUAL(1, loss_stats.full_reads);
+    TEST_ASSERT_EQUAL(block_info.lost_samples, loss_stats.lost_samples);
+}
+
+/**
+ * Test that full FIFO that is drained before the next sample isn't reported as loss.
+ */
+void test_fifo_full_drain_without_loss()
+{
+    int16_t samples[LSM303DLHCAccelerometer::FIFO_SIZE][3];
+    LSM303DLHCAccelerometer::BlockInfo block_info;
+    LSM303DLHCAccelerometer::LossStatistics loss_stats;
+    int n;
+
+    // low output data rate gives wide window between the 32nd and 33rd samples
+    acc->set_output_data_rate(LSM303DLHCAccelerometer::ODR_10HZ);
+    acc->set_fifo_mode(LSM303DLHCAccelerometer::FIFO_ENABLE);
+    acc->clear_fifo();
+    acc->reset_loss_statistics();
+
+    // synchronize drain with sample generation
+    do {
+        ThisThread::sleep_for(1ms);
+        n = acc->read_fifo_data_16(samples, LSM303DLHCAccelerometer::FIFO_SIZE, &block_info);
+    } while (n == 0);
+
+    // drain in the middle between the 32nd and 33rd samples
+    ThisThread::sleep_for(3250ms);
+    n = acc->read_fifo_data_16(samples, LSM303DLHCAccelerometer::FIFO_SIZE, &block_info);
+    TEST_ASSERT_EQUAL(LSM303DLHCAccelerometer::FIFO_SIZE, n);
+    TEST_ASSERT_TRUE(block_info.overrun);
+    TEST_ASSERT_EQUAL(0, block_info.lost_samples);
+
+    acc->get_loss_statistics(&loss_stats);
+    TEST_ASSERT_EQUAL(0, loss_stats.overruns);
+    TEST_ASSERT_EQUAL(1, loss_stats.full_reads);
+    TEST_ASSERT_EQUAL(0, loss_stats.lost_samples);
+
+    acc->set_fifo_mode(LSM303DLHCAccelerometer::FIFO_DISABLE);
+}
+
+struct block_timestamp_checker_t {
+    int block_count;
+    int timestamp_errors;
+    us_timestamp_t next_timestamp;
+    EventQueue *queue;
+
+    void process_edge()
+    {
+        acc->mark_watermark_interrupt();
+        queue->call(this, &block_timestamp_checker_t::process_block);
+    }
+
+    void process_block()
+    {
+        int16_t samples[LSM303DLHCAccelerometer::FIFO_SIZE][3];
+        LSM303DLHCAccelerometer::BlockInfo block_info;
+        int n = acc->read_fifo_data_16(samples, LSM303DLHCAccelerometer::FIFO_SIZE, &block_info);
+        if (n <= 0) {
+            return;
+        }
+        // check that blocks are continuous (tolerance is a quarter of the sample period)
+        if (block_count > 0) {
+            int64_t diff = (int64_t)block_info.timestamp - (int64_t)next_timestamp;
+            if (diff > 2500 / 4 || diff < -2500 / 4) {
+                timestamp_errors++;
+            }
+        }
+        next_timestamp = block_info.get_sample_timestamp(n);
+        block_count++;
+    }
+};
+
+/**
+ * Test FIFO sample timestamps and output data rate estimation.
+ */
+void test_fifo_timestamps()
+{
+    InterruptIn drdy_pin(MBED_CONF_LSM303DLHC_DRIVER_TEST_INT_1);
+    block_timestamp_checker_t checker = { .block_count = 0, .timestamp_errors = 0, .next_timestamp = 0, .queue = mbed_event_queue() };
+    drdy_pin.disable_irq();
+    drdy_pin.rise(callback(&checker, &block_timestamp_checker_t::process_edge));
+
+    acc->set_output_data_rate(LSM303DLHCAccelerometer::ODR_400HZ);
+    acc->set_fifo_watermark(20);
+    acc->set_fifo_mode(LSM303DLHCAccelerometer::FIFO_ENABLE);
+    acc->clear_fifo();
+    acc->set_data_ready_interrupt_mode(LSM303DLHCAccelerometer::DRDY_ENABLE);
+    drdy_pin.enable_irq();
+
+    ThisThread::sleep_for(2000ms);
+
+    acc->set_data_ready_interrupt_mode(LSM303DLHCAccelerometer::DRDY_DISABLE);
+    drdy_pin.disable_irq();
+    ThisThread::sleep_for(100ms);
+
+    TEST_ASSERT_INT_WITHIN(5, 38, checker.block_count);
+    TEST_ASSERT_EQUAL(0, checker.timestamp_errors);
+    // internal oscillator shouldn't differ more than several percents
+    TEST_ASSERT_FLOAT_WITHIN(20.0f, 400.0f, acc->get_estimated_output_data_rate_hz());
+}
+
+/**
+ * Test stream reconfiguration without mis-scaled and lost samples.
+ */
+void test_stream_reconfiguration()
+{
+    float samples[LSM303DLHCAccelerometer::FIFO_SIZE][3];
+    LSM303DLHCAccelerometer::BlockInfo block_info;
+    LSM303DLHCAccelerometer::LossStatistics loss_stats;
+    LSM303DLHCAccelerometer::StreamConfig config;
+    int n;
+
+    acc->set_output_data_rate(LSM303DLHCAccelerometer::ODR_100HZ);
+    acc->set_fifo_mode(LSM303DLHCAccelerometer::FIFO_ENABLE);
+    acc->clear_fifo();
+    acc->reset_loss_statistics();
+    ThisThread::sleep_for(200ms);
+
+    // switch full scale and output data rate
+    acc->get_stream_config(&config);
+    TEST_ASSERT_EQUAL(LSM303DLHCAccelerometer::ODR_100HZ, config.odr);
+    TEST_ASSERT_EQUAL(LSM303DLHCAccelerometer::FULL_SCALE_2G, config.full_scale);
+    float prev_sensitivity = acc->get_sensitivity();
+    config.full_scale = LSM303DLHCAccelerometer::FULL_SCALE_8G;
+    config.odr = LSM303DLHCAccelerometer::ODR_50HZ;
+    n = acc->reconfigure_stream(config, samples, LSM303DLHCAccelerometer::FIFO_SIZE, &block_info);
+    TEST_ASSERT_INT_WITHIN(3, 20, n);
+    TEST_ASSERT_EQUAL_FLOAT(prev_sensitivity, block_info.sensitivity);
+    TEST_ASSERT_FLOAT_WITHIN(1.0f, 9.8f, abs_acc_val(samples[n - 1]));
+    TEST_ASSERT_LESS_THAN(5000, acc->get_reconfiguration_time_us());
+
+    // check new configuration
+    ThisThread::sleep_for(200ms);
+    n = acc->read_fifo_data(samples, LSM303DLHCAccelerometer::FIFO_SIZE, &block_info);
+    TEST_ASSERT_INT_WITHIN(2, 10, n);
+    TEST_ASSERT_EQUAL_FLOAT(acc->get_sensitivity(), block_info.sensitivity);
+    TEST_ASSERT_FLOAT_WITHIN(1.0f, 9.8f, abs_acc_val(samples[0]));
+    TEST_ASSERT_EQUAL(LSM303DLHCAccelerometer::FULL_SCALE_8G, acc->get_full_scale());
+    TEST_ASSERT_EQUAL(LSM303DLHCAccelerometer::ODR_50HZ, acc->get_output_data_rate());
+
+    // switch full scale back with small buffer, the rest of previous samples should keep previous sensitivity
+    ThisThread::sleep_for(200ms);
+    prev_sensitivity = acc->get_sensitivity();
+    config.full_scale = LSM303DLHCAccelerometer::FULL_SCALE_2G;
+    n = acc->reconfigure_stream(config, samples, 4, &block_info);
+    TEST_ASSERT_EQUAL(4, n);
+    TEST_ASSERT_EQUAL_FLOAT(prev_sensitivity, block_info.sensitivity);
+    n = acc->read_fifo_data(samples, LSM303DLHCAccelerometer::FIFO_SIZE, &block_info);
+    TEST_ASSERT_INT_WITHIN(2, 6, n);
+    TEST_ASSERT_EQUAL_FLOAT(prev_sensitivity, block_info.sensitivity);
+    TEST_ASSERT_FLOAT_WITHIN(1.0f, 9.8f, abs_acc_val(samples[n - 1]));
+    ThisThread::sleep_for(200ms);
+    n = acc->read_fifo_data(samples, LSM303DLHCAccelerometer::FIFO_SIZE, &block_info);
+    TEST_ASSERT_INT_WITHIN(2, 10, n);
+    TEST_ASSERT_EQUAL_FLOAT(acc->get_sensitivity(), block_info.sensitivity);
+    TEST_ASSERT_FLOAT_WITHIN(1.0f, 9.8f, abs_acc_val(samples[0]));
+
+    acc->get_loss_statistics(&loss_stats);
+    TEST_ASSERT_EQUAL(0, loss_stats.overruns);
+
+    // reconfigure twice at high output data rate without full drains,
+    // the samples of both previous configurations should keep their sensitivity
+    config.odr = LSM303DLHCAccelerometer::ODR_1344HZ;
+    config.full_scale = LSM303DLHCAccelerometer::FULL_SCALE_2G;
+    acc->reconfigure_stream(config, samples, LSM303DLHCAccelerometer::FIFO_SIZE);
+    ThisThread::sleep_for(5ms);
+    config.full_scale = LSM303DLHCAccelerometer::FULL_SCALE_8G;
+    n = acc->reconfigure_stream(config, samples, 2, &block_info);
+    TEST_ASSERT_EQUAL(2, n);
+    ThisThread::sleep_for(2ms);
+    config.full_scale = LSM303DLHCAccelerometer::FULL_SCALE_4G;
+    n = acc->reconfigure_stream(config, samples, 2, &block_info);
+    TEST_ASSERT_EQUAL(0, block_info.untagged_samples);
+    for (int i = 0; i < 4; i++) {
+        n = acc->read_fifo_data(samples, LSM303DLHCAccelerometer::FIFO_SIZE, &block_info);
+        TEST_ASSERT_EQUAL(0, block_info.lost_samples);
+        for (int j = 0; j < n; j++) {
+            TEST_ASSERT_FLOAT_WITHIN(1.5f, 9.8f, abs_acc_val(samples[j]));
+        }
+    }
+    TEST_ASSERT_EQUAL_FLOAT(acc->get_sensitivity(), block_info.sensitivity);
+}
+
+struct fifo_drainer_t {
+    int samples_count;
+    EventQueue *queue;
+
+    void process_edge()
+    {
+        acc->mark_watermark_interrupt();
+        queue->call(this, &fifo_drainer_t::drain);
+    }
+
+    void drain()
+    {
+        int16_t samples[LSM303DLHCAccelerometer::FIFO_SIZE][3];
+        samples_count += acc->read_fifo_data_16(samples, LSM303DLHCAccelerometer::FIFO_SIZE);
+    }
+};
+
+/**
+ * Test adaptive FIFO watermark.
+ */
+void test_adaptive_watermark()
+{
+    InterruptIn drdy_pin(MBED_CONF_LSM303DLHC_DRIVER_TEST_INT_1);
+    fifo_drainer_t drainer = { .samples_count = 0, .queue = mbed_event_queue() };
+    LSM303DLHCAccelerometer::LossStatistics loss_stats;
+    drdy_pin.disable_irq();
+    drdy_pin.rise(callback(&drainer, &fifo_drainer_t::process_edge));
+
+    // low output data rate: watermark is limited by latency target
+    acc->set_output_data_rate(LSM303DLHCAccelerometer::ODR_25HZ);
+    acc->set_fifo_watermark(1);
+    acc->set_fifo_mode(LSM303DLHCAccelerometer::FIFO_ENABLE);
+    acc->set_adaptive_watermark_mode(LSM303DLHCAccelerometer::AWM_ENABLE, 300000);
+    acc->clear_fifo();
+    acc->reset_loss_statistics();
+    acc->set_data_ready_interrupt_mode(LSM303DLHCAccelerometer::DRDY_ENABLE);
+    drdy_pin.enable_irq();
+    ThisThread::sleep_for(2000ms);
+    TEST_ASSERT_INT_WITHIN(2, 6, acc->get_fifo_watermark());
+
+    // high output data rate without latency target: maximal coalescing
+    acc->set_output_data_rate(LSM303DLHCAccelerometer::ODR_400HZ);
+    acc->set_adaptive_watermark_mode(LSM303DLHCAccelerometer::AWM_ENABLE);
+    ThisThread::sleep_for(1000ms);
+    TEST_ASSERT_GREATER_OR_EQUAL(20, acc->get_fifo_watermark());
+
+    acc->set_data_ready_interrupt_mode(LSM303DLHCAccelerometer::DRDY_DISABLE);
+    drdy_pin.disable_irq();
+    ThisThread::sleep_for(100ms);
+
+    acc->get_loss_statistics(&loss_stats);
+    TEST_ASSERT_EQUAL(0, loss_stats.overruns);
+}
+
+/**
+ * Test burst capture state transitions.
+ */
+void test_burst_capture()
+{
+    int16_t samples[LSM303DLHCAccelerometer::FIFO_SIZE][3];
+    int n;
+
+    LSM303DLHCAccelerometer::BurstCaptureConfig config;
+    config.idle_odr = LSM303DLHCAccelerometer::ODR_10HZ;
+    config.capture_odr = LSM303DLHCAccelerometer::ODR_100HZ;
+    config.full_scale = LSM303DLHCAccelerometer::FULL_SCALE_4G;
+    config.watermark = 16;
+    config.wakeup_threshold = 4.0f;
+    config.capture_duration = 500;
+    config.quiescent_threshold = 0.5f;
+    config.quiescent_duration = 0;
+
+    // idle state
+    acc->start_burst_capture(config);
+    TEST_ASSERT_EQUAL(LSM303DLHCAccelerometer::BCS_IDLE, acc->get_burst_capture_state());
+    TEST_ASSERT_EQUAL(LSM303DLHCAccelerometer::LOW_POWER_MODE, acc->get_power_mode());
+    TEST_ASSERT_EQUAL(LSM303DLHCAccelerometer::ODR_10HZ, acc->get_output_data_rate());
+    TEST_ASSERT_EQUAL(LSM303DLHCAccelerometer::FIFO_DISABLE, acc->get_fifo_mode());
+
+    // emulate wakeup interrupt
+    n = acc->process_burst_capture(samples, LSM303DLHCAccelerometer::FIFO_SIZE);
+    TEST_ASSERT_EQUAL(0, n);
+    TEST_ASSERT_EQUAL(LSM303DLHCAccelerometer::BCS_CAPTURE, acc->get_burst_capture_state());
+    TEST_ASSERT_EQUAL(LSM303DLHCAccelerometer::NORMAL_POWER_MODE, acc->get_power_mode());
+    TEST_ASSERT_EQUAL(LSM303DLHCAccelerometer::ODR_100HZ, acc->get_output_data_rate());
+    TEST_ASSERT_EQUAL(LSM303DLHCAccelerometer::FIFO_ENABLE, acc->get_fifo_mode());
+
+    // capture data until capture duration is expired
+    int total = 0;
+    for (int i = 0; i < 4 && acc->get_burst_capture_state() == LSM303DLHCAccelerometer::BCS_CAPTURE; i++) {
+        ThisThread::sleep_for(200ms);
+        n = acc->process_burst_capture(samples, LSM303DLHCAccelerometer::FIFO_SIZE);
+        TEST_ASSERT_FLOAT_WITHIN(1.0f, 9.8f, abs_acc_val(samples[0]) * acc->get_sensitivity());
+        total += n;
+    }
+    TEST_ASSERT_INT_WITHIN(5, 60, total);
+    TEST_ASSERT_EQUAL(LSM303DLHCAccelerometer::BCS_IDLE, acc->get_burst_capture_state());
+    TEST_ASSERT_EQUAL(LSM303DLHCAccelerometer::LOW_POWER_MODE, acc->get_power_mode());
+
+    acc->stop_burst_capture();
+    TEST_ASSERT_EQUAL(LSM303DLHCAccelerometer::BCS_DISABLED, acc->get_burst_capture_state());
+
+    // stop during capture: idle configuration should be restored
+    acc->start_burst_capture(config);
+    acc->process_burst_capture(samples, LSM303DLHCAccelerometer::FIFO_SIZE);
+    TEST_ASSERT_EQUAL(LSM303DLHCAccelerometer::BCS_CAPTURE, acc->get_burst_capture_state());
+    acc->stop_burst_capture();
+    TEST_ASSERT_EQUAL(LSM303DLHCAccelerometer::BCS_DISABLED, acc->get_burst_capture_state());
+    TEST_ASSERT_EQUAL(LSM303DLHCAccelerometer::LOW_POWER_MODE, acc->get_power_mode());
+    TEST_ASSERT_EQUAL(LSM303DLHCAccelerometer::ODR_10HZ, acc->get_output_data_rate());
+    TEST_ASSERT_EQUAL(LSM303DLHCAccelerometer::FIFO_DISABLE, acc->get_fifo_mode());
+}
+
+/**
+ * Test output data rate governor with stationary sensor.
+ */
+void test_odr_governor()
+{
+    int16_t samples[LSM303DLHCAccelerometer::FIFO_SIZE][3];
+
+    acc->set_output_data_rate(LSM303DLHCAccelerometer::ODR_100HZ);
+    acc->set_fifo_mode(LSM303DLHCAccelerometer::FIFO_ENABLE);
+    acc->clear_fifo();
+
+    LSM303DLHCAccelerometer::ODRGovernorConfig config;
+    config.min_odr = LSM303DLHCAccelerometer::ODR_25HZ;
+    config.max_odr = LSM303DLHCAccelerometer::ODR_400HZ;
+    config.up_threshold = 4.0f;
+    config.down_threshold = 0.5f;
+    config.window = 100;
+    config.hold_windows = 2;
+    acc->start_odr_governor(config);
+    TEST_ASSERT_EQUAL(LSM303DLHCAccelerometer::ODRG_ENABLE, acc->get_odr_governor_mode());
+
+    // output data rate shouldn't be changed while FIFO isn't drained completely
+    for (int i = 0; i < 10; i++) {
+        ThisThread::sleep_for(100ms);
+        acc->read_fifo_data_16(samples, 2);
+    }
+    TEST_ASSERT_EQUAL(LSM303DLHCAccelerometer::ODR_100HZ, acc->get_output_data_rate());
+
+    // quiet signal should decrease output data rate to minimum
+    for (int i = 0; i < 40; i++) {
+        ThisThread::sleep_for(100ms);
+        acc->read_fifo_data_16(samples, LSM303DLHCAccelerometer::FIFO_SIZE);
+    }
+    acc->stop_odr_governor();
+
+    TEST_ASSERT_EQUAL(LSM303DLHCAccelerometer::ODR_25HZ, acc->get_output_data_rate());
+    TEST_ASSERT_LESS_THAN(config.down_threshold, acc->get_odr_governor_energy());
+}
+
+/**
+ * Test automatic full scale ranging.
+ */
+void test_auto_range()
+{
+    float samples[LSM303DLHCAccelerometer::FIFO_SIZE][3];
+    LSM303DLHCAccelerometer::BlockInfo info;
+
+    acc->set_output_data_rate(LSM303DLHCAccelerometer::ODR_100HZ);
+    acc->set_full_scale(LSM303DLHCAccelerometer::FULL_SCALE_16G);
+    acc->set_fifo_mode(LSM303DLHCAccelerometer::FIFO_ENABLE);
+    acc->clear_fifo();
+    acc->set_auto_range_mode(LSM303DLHCAccelerometer::AR_ENABLE);
+    TEST_ASSERT_EQUAL(LSM303DLHCAccelerometer::AR_ENABLE, acc->get_auto_range_mode());
+
+    // gravity only should decrease full scale, but all blocks should be scaled correctly
+    for (int i = 0; i < 30; i++) {
+        ThisThread::sleep_for(50ms);
+        int n = acc->read_fifo_data(samples, LSM303DLHCAccelerometer::FIFO_SIZE, &info);
+        TEST_ASSERT_FALSE(info.overrun);
+        for (int j = 0; j < n; j++) {
+            TEST_ASSERT_FLOAT_WITHIN(1.5f, 9.8f, abs_acc_val(samples[j]));
+        }
+    }
+    acc->set_auto_range_mode(LSM303DLHCAccelerometer::AR_DISABLE);
+
+    // 1g is about 50% of the 2g scale, so hysteresis keeps 4g scale
+    TEST_ASSERT_EQUAL(LSM303DLHCAccelerometer::FULL_SCALE_4G, acc->get_full_scale());
+}
+
+/**
+ * Test configuration saving and restoring.
+ */
+void test_config_snapshot()
+{
+    LSM303DLHCAccelerometer::ConfigSnapshot config;
+
+    acc->set_output_data_rate(LSM303DLHCAccelerometer::ODR_200HZ);
+    acc->set_full_scale(LSM303DLHCAccelerometer::FULL_SCALE_8G);
+    acc->set_fifo_watermark(12);
+    acc->set_fifo_mode(LSM303DLHCAccelerometer::FIFO_ENABLE);
+    acc->set_high_pass_filter_mode(LSM303DLHCAccelerometer::HPF_CF2);
+    float sensitivity = acc->get_sensitivity();
+    acc->save_config(&config);
+
+    // reset sensor and restore configuration
+    acc->init(false);
+    acc->restore_config(config);
+
+    TEST_ASSERT_EQUAL(LSM303DLHCAccelerometer::ODR_200HZ, acc->get_output_data_rate());
+    TEST_ASSERT_EQUAL(LSM303DLHCAccelerometer::FULL_SCALE_8G, acc->get_full_scale());
+    TEST_ASSERT_EQUAL(12, acc->get_fifo_watermark());
+    TEST_ASSERT_EQUAL(LSM303DLHCAccelerometer::FIFO_ENABLE, acc->get_fifo_mode());
+    TEST_ASSERT_EQUAL(LSM303DLHCAccelerometer::HPF_CF2, acc->get_high_pass_filter_mode());
+    TEST_ASSERT_EQUAL_FLOAT(sensitivity, acc->get_sensitivity());
+}
+
+/**
+ * Test staged configuration.
+ */
+void test_staged_config()
+{
+    float a_vec[3];
+
+    float prev_sensitivity = acc->get_sensitivity();
+    acc->begin_config();
+    // ODR is validated during commit, so power mode can be set after it
+    acc->set_output_data_rate(LSM303DLHCAccelerometer::ODR_1620HZ);
+    acc->set_power_mode(LSM303DLHCAccelerometer::LOW_POWER_MODE);
+    acc->set_high_resolution_output_mode(LSM303DLHCAccelerometer::HRO_DISABLED);
+    acc->set_full_scale(LSM303DLHCAccelerometer::FULL_SCALE_4G);
+    acc->set_fifo_watermark(8);
+    acc->set_fifo_mode(LSM303DLHCAccelerometer::FIFO_ENABLE);
+    // staged full scale doesn't affect active sensitivity
+    TEST_ASSERT_EQUAL_FLOAT(prev_sensitivity, acc->get_sensitivity());
+    acc->commit_config();
+    TEST_ASSERT_EQUAL_FLOAT(LSM303DLHCAccelerometer::get_full_scale_sensitivity(LSM303DLHCAccelerometer::FULL_SCALE_4G), acc->get_sensitivity());
+
+    TEST_ASSERT_EQUAL(LSM303DLHCAccelerometer::LOW_POWER_MODE, acc->get_power_mode());
+    TEST_ASSERT_EQUAL(LSM303DLHCAccelerometer::ODR_1620HZ, acc->get_output_data_rate());
+    TEST_ASSERT_EQUAL(LSM303DLHCAccelerometer::HRO_DISABLED, acc->get_high_resolution_output_mode());
+    TEST_ASSERT_EQUAL(LSM303DLHCAccelerometer::FULL_SCALE_4G, acc->get_full_scale());
+    TEST_ASSERT_EQUAL(8, acc->get_fifo_watermark());
+    TEST_ASSERT_EQUAL(LSM303DLHCAccelerometer::FIFO_ENABLE, acc->get_fifo_mode());
+
+    // check that canceled configuration isn't applied
+    acc->begin_config();
+    acc->set_full_scale(LSM303DLHCAccelerometer::FULL_SCALE_16G);
+    acc->cancel_config();
+    TEST_ASSERT_EQUAL(LSM303DLHCAccelerometer::FULL_SCALE_4G, acc->get_full_scale());
+    TEST_ASSERT_EQUAL_FLOAT(LSM303DLHCAccelerometer::get_full_scale_sensitivity(LSM303DLHCAccelerometer::FULL_SCALE_4G), acc->get_sensitivity());
+
+    ThisThread::sleep_for(10ms);
+    acc->read_data(a_vec);
+    TEST_ASSERT_FLOAT_WITHIN(1.0f, 9.8f, abs_acc_val(a_vec));
+}
+
+/**
+ * Test compile time configuration.
+ */
+void test_static_config()
+{
+    typedef AccelerometerStaticConfig<LSM303DLHCAccelerometer::LOW_POWER_MODE, LSM303DLHCAccelerometer::ODR_1620HZ, LSM303DLHCAccelerometer::FULL_SCALE_8G> LowPowerConfig;
+    typedef AccelerometerStaticConfig<LSM303DLHCAccelerometer::NORMAL_POWER_MODE, LSM303DLHCAccelerometer::ODR_100HZ, LSM303DLHCAccelerometer::FULL_SCALE_4G,
+            LSM303DLHCAccelerometer::HRO_ENABLED, LSM303DLHCAccelerometer::HPF_OFF, LSM303DLHCAccelerometer::FIFO_ENABLE, 16>
+            FIFOConfig;
+    // check compile time calculations
+    static_assert(LowPowerConfig::ctrl_reg1() == 0x8F, "Invalid CTRL_REG1_A value");
+    static_assert(LowPowerConfig::ctrl_reg4() == 0x20, "Invalid CTRL_REG4_A value");
+    static_assert(FIFOConfig::fifo_ctrl_reg() == 0x90, "Invalid FIFO_CTRL_REG_A value");
+    float a_vec[3];
+
+    acc->apply_static_config<LowPowerConfig>();
+    TEST_ASSERT_EQUAL(LSM303DLHCAccelerometer::LOW_POWER_MODE, acc->get_power_mode());
+    TEST_ASSERT_EQUAL(LSM303DLHCAccelerometer::ODR_1620HZ, acc->get_output_data_rate());
+    TEST_ASSERT_EQUAL(LSM303DLHCAccelerometer::HRO_DISABLED, acc->get_high_resolution_output_mode());
+    TEST_ASSERT_EQUAL(LSM303DLHCAccelerometer::FULL_SCALE_8G, acc->get_full_scale());
+    TEST_ASSERT_EQUAL_FLOAT(LowPowerConfig::sensitivity(), acc->get_sensitivity());
+
+    acc->apply_static_config<FIFOConfig>();
+    TEST_ASSERT_EQUAL(LSM303DLHCAccelerometer::NORMAL_POWER_MODE, acc->get_power_mode());
+    TEST_ASSERT_EQUAL(LSM303DLHCAccelerometer::ODR_100HZ, acc->get_output_data_rate());
+    TEST_ASSERT_EQUAL(LSM303DLHCAccelerometer::FIFO_ENABLE, acc->get_fifo_mode());
+    TEST_ASSERT_EQUAL(16, acc->get_fifo_watermark());
+
+    ThisThread::sleep_for(20ms);
+    acc->read_data(a_vec);
+    TEST_ASSERT_FLOAT_WITHIN(1.0f, 9.8f, abs_acc_val(a_vec));
+}
+
+/**
+ * Test fixed point output in mg.
+ */
+void test_fixed_point_output()
+{
+    int16_t data_16[3];
+    int16_t data_mg[3];
+    int16_t fifo_data[LSM303DLHCAccelerometer::FIFO_SIZE][3];
+    LSM303DLHCAccelerometer::BlockInfo info;
+
+    // mg value should be exact multiple of the raw value
+    acc->set_full_scale(LSM303DLHCAccelerometer::FULL_SCALE_16G);
+    TEST_ASSERT_EQUAL(12, LSM303DLHCAccelerometer::get_full_scale_sensitivity_mg(LSM303DLHCAccelerometer::FULL_SCALE_16G));
+    acc->read_data_mg(data_mg);
+    TEST_ASSERT_EQUAL(0, data_mg[0] % 12);
+    float g = sqrtf((float)data_mg[0] * data_mg[0] + (float)data_mg[1] * data_mg[1] + (float)data_mg[2] * data_mg[2]);
+    TEST_ASSERT_FLOAT_WITHIN(200.0f, 1000.0f, g);
+
+    acc->set_full_scale(LSM303DLHCAccelerometer::FULL_SCALE_2G);
+    acc->set_fifo_mode(LSM303DLHCAccelerometer::FIFO_ENABLE);
+    ThisThread::sleep_for(100ms);
+    int n = acc->read_fifo_data_mg(fifo_data, LSM303DLHCAccelerometer::FIFO_SIZE, &info);
+    TEST_ASSERT_TRUE(n > 0);
+    TEST_ASSERT_EQUAL(n, info.samples);
+    acc->read_data_16(data_16);
+    for (int i = 0; i < 3; i++) {
+        TEST_ASSERT_INT_WITHIN(100, data_16[i], fifo_data[n - 1][i]);
+    }
+}
+
+/**
+ * Test FIFO reading with sample spans.
+ */
+void test_fifo_block_span()
+{
+    float fifo_data[LSM303DLHCAccelerometer::FIFO_SIZE][3];
+    SampleSpan<float> buffer(fifo_data);
+    LSM303DLHCAccelerometer::BlockInfo info;
+
+    acc->set_full_scale(LSM303DLHCAccelerometer::FULL_SCALE_2G);
+    acc->set_fifo_mode(LSM303DLHCAccelerometer::FIFO_ENABLE);
+    ThisThread::sleep_for(100ms);
+
+    // samples should be returned as view of the caller buffer
+    SampleSpan<float> samples = acc->read_fifo_block(buffer, &info);
+    TEST_ASSERT_FALSE(samples.empty());
+    TEST_ASSERT_EQUAL_PTR(buffer.data, samples.data);
+    TEST_ASSERT_EQUAL(info.samples, samples.size);
+    for (float *sample : samples) {
+        float g = sqrtf(sample[0] * sample[0] + sample[1] * sample[1] + sample[2] * sample[2]);
+        TEST_ASSERT_FLOAT_WITHIN(2.0f, LSM303DLHCAccelerometer::GRAVITY_OF_EARTH, g);
+    }
+
+    // raw and mg views of the same memory
+    ThisThread::sleep_for(100ms);
+    SampleSpan<int16_t> raw_samples = acc->read_fifo_block(SampleSpan<int16_t>((int16_t(*)[3])fifo_data, LSM303DLHCAccelerometer::FIFO_SIZE));
+    TEST_ASSERT_FALSE(raw_samples.empty());
+    int16_t last_raw[3];
+    memcpy(last_raw, raw_samples[raw_samples.size - 1], sizeof(last_raw));
+    ThisThread::sleep_for(100ms);
+    SampleSpan<MilliUnits> mg_samples = acc->read_fifo_block(SampleSpan<MilliUnits>((MilliUnits(*)[3])fifo_data, 4));
+    TEST_ASSERT_TRUE(mg_samples.size <= 4);
+    TEST_ASSERT_FALSE(mg_samples.empty());
+    for (int i = 0; i < 3; i++) {
+        TEST_ASSERT_INT_WITHIN(100, last_raw[i], mg_samples[0][i].value);
+    }
+}
+
+/**
+ * User sample type for read_data_as test.
+ */
+struct GravityUnits {
+    float value;
+};
+
+namespace lsm303dlhc {
+template <>
+struct SampleTraits<GravityUnits> {
+    static constexpr GravityUnits convert(int16_t raw, float sensitivity, int32_t milli_scale)
+    {
+        return GravityUnits { raw * sensitivity / LSM303DLHCAccelerometer::GRAVITY_OF_EARTH };
+    }
+};
+}
+
+/**
+ * Test data reading with sample type traits.
+ */
+void test_read_data_as()
+{
+    int16_t data_16[3];
+    float data[3];
+    float data_fs[3];
+    MilliUnits data_mg[3];
+    GravityUnits data_g[3];
+
+    acc->set_full_scale(LSM303DLHCAccelerometer::FULL_SCALE_4G);
+    acc->read_data_as(data_16);
+    acc->read_data_as(data);
+    acc->read_data_as<float, LSM303DLHCAccelerometer::FULL_SCALE_4G>(data_fs);
+    acc->read_data_as<MilliUnits, LSM303DLHCAccelerometer::FULL_SCALE_4G>(data_mg);
+    acc->read_data_as(data_g);
+    float sensitivity = acc->get_sensitivity();
+    for (int i = 0; i < 3; i++) {
+        TEST_ASSERT_FLOAT_WITHIN(1.0f, data_16[i] * sensitivity, data[i]);
+        TEST_ASSERT_FLOAT_WITHIN(1.0f, data[i], data_fs[i]);
+        TEST_ASSERT_INT_WITHIN(100, (int)(data[i] / LSM303DLHCAccelerometer::GRAVITY_OF_EARTH * 1000), data_mg[i].value);
+        TEST_ASSERT_FLOAT_WITHIN(0.1f, data[i] / LSM303DLHCAccelerometer::GRAVITY_OF_EARTH, data_g[i].value);
+    }
+}
+
+/**
+ * Test mounting orientation of the converted data.
+ */
+void test_axis_orientation()
+{
+    typedef AxisOrientation<AXIS_PY, AXIS_NX, AXIS_PZ> RotatedOrientation;
+    int16_t data_16[3];
+    int16_t data_rot[3];
+    int16_t data_rot_fs[3];
+    int16_t data_rot_mg[3];
+    float data_rot_f[3];
+    int16_t data_offset[3];
+    const float offset[3] = { 5.0f, 0.0f, 0.0f };
+    const float g = LSM303DLHCAccelerometer::GRAVITY_OF_EARTH;
+
+    acc->set_full_scale(LSM303DLHCAccelerometer::FULL_SCALE_2G);
+    float sensitivity = acc->get_sensitivity();
+    acc->read_data_16(data_16);
+    acc->set_orientation<RotatedOrientation>();
+    acc->read_data_as(data_rot);
+    acc->read_data_as<int16_t, LSM303DLHCAccelerometer::FULL_SCALE_2G>(data_rot_fs);
+    acc->read_data_mg(data_rot_mg);
+    acc->read_data(data_rot_f);
+    TEST_ASSERT_INT_WITHIN(100, data_16[1], data_rot[0]);
+    TEST_ASSERT_INT_WITHIN(100, -data_16[0], data_rot[1]);
+    TEST_ASSERT_INT_WITHIN(100, data_16[2], data_rot[2]);
+    for (int i = 0; i < 3; i++) {
+        TEST_ASSERT_INT_WITHIN(100, data_rot[i], data_rot_fs[i]);
+        TEST_ASSERT_FLOAT_WITHIN(1.0f, data_rot[i] * sensitivity, data_rot_f[i]);
+        TEST_ASSERT_INT_WITHIN(100, (int)(data_rot_f[i] / g * 1000), data_rot_mg[i]);
+    }
+
+    // the offset is subtracted in board axes
+    acc->set_offset(offset);
+    acc->read_data_as(data_offset);
+    TEST_ASSERT_INT_WITHIN(100, data_rot[0] - (int)(offset[0] / sensitivity), data_offset[0]);
+    TEST_ASSERT_INT_WITHIN(100, data_rot[1], data_offset[1]);
+
+    acc->set_offset(nullptr);
+    acc->set_orientation<IdentityOrientation>();
+}
+
+/**
+ * Test six-position calibration.
+ */
+void test_six_position_calibration()
+{
+    float data[2][3];
+    float fifo_data[LSM303DLHCAccelerometer::FIFO_SIZE][3];
+    LSM303DLHCAccelerometer::Calibration cal;
+    AccelerometerCalibrator calibrator;
+    AccelerometerCalibrator::Position position;
+    const float g = LSM303DLHCAccelerometer::GRAVITY_OF_EARTH;
+
+    // measure current position of the stationary device
+    TEST_ASSERT_EQUAL(AccelerometerCalibrator::POSITION_X_UP, calibrator.get_missing_position());
+    TEST_ASSERT_EQUAL(0, calibrator.measure_position(acc, 32, 0.2f, &position));
+    TEST_ASSERT_TRUE(calibrator.has_position(position));
+    TEST_ASSERT_EQUAL(LSM303DLHCAccelerometer::FIFO_DISABLE, acc->get_fifo_mode());
+    TEST_ASSERT_NOT_EQUAL(0, calibrator.compute(&cal));
+
+    // add synthetic positions with scale 1.1, X/Y misalignment and bias
+    const float test_bias[3] = { 0.2f, -0.3f, 0.4f };
+    calibrator.reset();
+    for (int p = 0; p < AccelerometerCalibrator::POSITIONS; p++) {
+        float a[3] = { 0.0f, 0.0f, 0.0f };
+        a[p / 2] = p % 2 ? -g : g;
+        float m[3] = { 1.1f * a[0] + 0.05f * a[1], 1.1f * a[1], 1.1f * a[2] };
+        for (int i = 0; i < 3; i++) {
+            m[i] += test_bias[i];
+        }
+        TEST_ASSERT_EQUAL(p, calibrator.add_position(m));
+    }
+    const float tilted[3] = { g, g, 0.0f };
+    TEST_ASSERT_EQUAL(AccelerometerCalibrator::POSITION_NONE, calibrator.add_position(tilted));
+    TEST_ASSERT_EQUAL(AccelerometerCalibrator::POSITION_NONE, calibrator.get_missing_position());
+    float fit_error;
+    TEST_ASSERT_EQUAL(0, calibrator.compute(&cal, &fit_error));
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 0.0f, fit_error);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 1.0f / 1.1f, cal.matrix[0][0]);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, -0.05f / (1.1f * 1.1f), cal.matrix[0][1]);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 0.0f, cal.matrix[1][0]);
+    for (int i = 0; i < 3; i++) {
+        TEST_ASSERT_FLOAT_WITHIN(0.001f, test_bias[i], cal.offset[i]);
+    }
+
+    // check that calibration is applied by single sample and FIFO reading
+    const LSM303DLHCAccelerometer::Calibration double_scale = {
+        { 0.0f, 0.0f, 0.0f },
+        { { 2.0f, 0.0f, 0.0f }, { 0.0f, 2.0f, 0.0f }, { 0.0f, 0.0f, 2.0f } }
+    };
+    TEST_ASSERT_FALSE(acc->get_calibration(&cal));
+    acc->read_data(data[0]);
+    acc->set_calibration(&double_scale);
+    TEST_ASSERT_TRUE(acc->get_calibration(&cal));
+    TEST_ASSERT_EQUAL_FLOAT(2.0f, cal.matrix[1][1]);
+    acc->read_data(data[1]);
+    for (int i = 0; i < 3; i++) {
+        TEST_ASSERT_FLOAT_WITHIN(1.0f, 2.0f * data[0][i], data[1][i]);
+    }
+    acc->set_fifo_mode(LSM303DLHCAccelerometer::FIFO_ENABLE);
+    ThisThread::sleep_for(100ms);
+    int n = acc->read_fifo_data(fifo_data, LSM303DLHCAccelerometer::FIFO_SIZE);
+    TEST_ASSERT_TRUE(n > 0);
+    for (int i = 0; i < 3; i++) {
+        TEST_ASSERT_FLOAT_WITHIN(1.0f, 2.0f * data[0][i], fifo_data[n - 1][i]);
+    }
+    acc->set_calibration(nullptr);
+    TEST_ASSERT_FALSE(acc->get_calibration(&cal));
+}
+
+/**
+ * Test persisted configuration and calibration.
+ */
+void test_persistent_state()
+{
+    LSM303DLHCMagnetometer mag(MBED_CONF_LSM303DLHC_DRIVER_TEST_I2C_SDA, MBED_CONF_LSM303DLHC_DRIVER_TEST_I2C_SCL);
+    TEST_ASSERT_EQUAL(0, mag.init());
+    HeapBlockDevice bd(4096, 1, 1, 512);
+    TEST_ASSERT_EQUAL(0, bd.init());
+    float offset[3];
+    LSM303DLHCAccelerometer::Calibration cal;
+
+    // configure and calibrate sensors
+    const float test_offset[3] = { 0.1f, -0.2f, 0.3f };
+    const LSM303DLHCAccelerometer::Calibration test_cal = {
+        { 0.2f, 0.1f, -0.3f },
+        { { 1.01f, 0.02f, 0.0f }, { 0.0f, 0.99f, 0.0f }, { 0.0f, -0.01f, 1.02f } }
+    };
+    acc->set_full_scale(LSM303DLHCAccelerometer::FULL_SCALE_8G);
+    acc->set_output_data_rate(LSM303DLHCAccelerometer::ODR_100HZ);
+    acc->set_fifo_mode(LSM303DLHCAccelerometer::FIFO_ENABLE);
+    acc->set_offset(test_offset);
+    acc->set_calibration(&test_cal);
+    mag.set_full_scale(LSM303DLHCMagnetometer::FULL_SCALE_4_0_G);
+    mag.set_output_data_rate(LSM303DLHCMagnetometer::ODR_75_HZ);
+
+    PersistentState state;
+    state.capture(acc, &mag);
+    TEST_ASSERT_EQUAL(PersistentState::SECTION_ACCELEROMETER | PersistentState::SECTION_MAGNETOMETER, state.get_sections());
+    TEST_ASSERT_EQUAL(0, state.save_block_device(&bd, 0));
+
+    // reset sensors and restore state
+    acc->init();
+    acc->set_offset(nullptr);
+    acc->set_calibration(nullptr);
+    mag.init();
+    PersistentState loaded_state;
+    TEST_ASSERT_EQUAL(0, loaded_state.load_block_device(&bd, 0));
+    AccelerometerThermalCompensator compensator(acc, &mag);
+    TEST_ASSERT_EQUAL(MBED_ERROR_ITEM_NOT_FOUND, loaded_state.apply(acc, &mag, &compensator));
+    TEST_ASSERT_EQUAL(0, loaded_state.apply(acc, &mag));
+    TEST_ASSERT_EQUAL(LSM303DLHCAccelerometer::FULL_SCALE_8G, acc->get_full_scale());
+    TEST_ASSERT_EQUAL(LSM303DLHCAccelerometer::ODR_100HZ, acc->get_output_data_rate());
+    TEST_ASSERT_EQUAL(LSM303DLHCAccelerometer::FIFO_ENABLE, acc->get_fifo_mode());
+    TEST_ASSERT_EQUAL_FLOAT(LSM303DLHCAccelerometer::get_full_scale_sensitivity(LSM303DLHCAccelerometer::FULL_SCALE_8G), acc->get_sensitivity());
+    TEST_ASSERT_TRUE(acc->get_offset(offset));
+    TEST_ASSERT_EQUAL_FLOAT(test_offset[2], offset[2]);
+    TEST_ASSERT_TRUE(acc->get_calibration(&cal));
+    TEST_ASSERT_EQUAL_FLOAT(test_cal.matrix[0][1], cal.matrix[0][1]);
+    TEST_ASSERT_EQUAL_FLOAT(test_cal.offset[2], cal.offset[2]);
+    TEST_ASSERT_EQUAL(LSM303DLHCMagnetometer::FULL_SCALE_4_0_G, mag.get_full_scale());
+    TEST_ASSERT_EQUAL(LSM303DLHCMagnetometer::ODR_75_HZ, mag.get_output_data_rate());
+
+    // corrupted blob should be rejected
+    uint8_t value;
+    TEST_ASSERT_EQUAL(0, bd.read(&value, 16, 1));
+    value ^= 0x01;
+    TEST_ASSERT_EQUAL(0, bd.program(&value, 16, 1));
+    TEST_ASSERT_EQUAL(MBED_ERROR_INVALID_DATA_DETECTED, loaded_state.load_block_device(&bd, 0));
+
+    acc->set_offset(nullptr);
+    acc->set_calibration(nullptr);
+    bd.deinit();
+}
+
+/**
+ * Test persisted state round trip through file and KVStore.
+ */
+void test_persistent_state_storage()
+{
+    HeapBlockDevice bd(64 * 512, 1, 1, 512);
+    TEST_ASSERT_EQUAL(0, bd.init());
+    TEST_ASSERT_EQUAL(0, LittleFileSystem::format(&bd));
+    LittleFileSystem fs("fs");
+    TEST_ASSERT_EQUAL(0, fs.mount(&bd));
+    float offset[3];
+    const float test_offset[3] = { 0.4f, -0.5f, 0.6f };
+
+    acc->set_offset(test_offset);
+    PersistentState state;
+    state.capture(acc, nullptr);
+    const PersistentState::Blob &blob = state.get_blob();
+
+    // file round trip
+    PersistentState file_state;
+    TEST_ASSERT_EQUAL(MBED_ERROR_ITEM_NOT_FOUND, file_state.load_file("/fs/missing.bin"));
+    TEST_ASSERT_EQUAL(0, state.save_file("/fs/lsm303dlhc.bin"));
+    TEST_ASSERT_EQUAL(0, file_state.load_file("/fs/lsm303dlhc.bin"));
+    TEST_ASSERT_EQUAL_MEMORY(&blob, &file_state.get_blob(), sizeof(blob));
+
+#if MBED_CONF_LSM303DLHC_DRIVER_PERSISTENT_STATE_KVSTORE
+    // KVStore round trip
+    PersistentState kv_state;
+    TEST_ASSERT_EQUAL(0, state.save_kv("/kv/lsm303dlhc_test"));
+    TEST_ASSERT_EQUAL(0, kv_state.load_kv("/kv/lsm303dlhc_test"));
+    TEST_ASSERT_EQUAL_MEMORY(&blob, &kv_state.get_blob(), sizeof(blob));
+    kv_remove("/kv/lsm303dlhc_test");
+#endif
+
+    // loaded state restores the offset
+    acc->set_offset(nullptr);
+    TEST_ASSERT_EQUAL(0, file_state.apply(acc, nullptr));
+    TEST_ASSERT_TRUE(acc->get_offset(offset));
+    for (int i = 0; i < 3; i++) {
+        TEST_ASSERT_EQUAL_FLOAT(test_offset[i], offset[i]);
+    }
+
+    acc->set_offset(nullptr);
+    fs.unmount();
+    bd.deinit();
+}
+
+/**
+ * Test accelerometer thermal compensation.
+ */
+void test_thermal_compensation()
+{
+    LSM303DLHCMagnetometer mag(MBED_CONF_LSM303DLHC_DRIVER_TEST_I2C_SDA, MBED_CONF_LSM303DLHC_DRIVER_TEST_I2C_SCL);
+    TEST_ASSERT_EQUAL(0, mag.init());
+    float data[4][3];
+    float offset[3];
+    float bias[3];
+    float table[AccelerometerThermalCompensator::TABLE_SIZE][3];
+
+    // check offset compensation
+    const float test_offset[3] = { 1.0f, -2.0f, 3.0f };
+    TEST_ASSERT_FALSE(acc->get_offset(offset));
+    acc->set_offset(test_offset);
+    TEST_ASSERT_TRUE(acc->get_offset(offset));
+    TEST_ASSERT_EQUAL_FLOAT(-2.0f, offset[1]);
+    acc->read_data(data[0]);
+    acc->set_offset(nullptr);
+    acc->read_data(data[1]);
+    for (int i = 0; i < 3; i++) {
+        TEST_ASSERT_FLOAT_WITHIN(0.5f, test_offset[i], data[1][i] - data[0][i]);
+    }
+    TEST_ASSERT_FALSE(acc->get_offset(offset));
+
+    // constant table bias
+    AccelerometerThermalCompensator compensator(acc, &mag);
+    for (int i = 0; i < AccelerometerThermalCompensator::TABLE_SIZE; i++) {
+        for (int j = 0; j < 3; j++) {
+            table[i][j] = j == 2 ? 0.5f : 0.0f;
+        }
+    }
+    compensator.set_table(table);
+    compensator.update();
+    TEST_ASSERT_FLOAT_WITHIN(50.0f, 25.0f, compensator.get_temperature());
+    compensator.get_bias(bias);
+    TEST_ASSERT_EQUAL_FLOAT(0.5f, bias[2]);
+    TEST_ASSERT_TRUE(acc->get_offset(offset));
+    TEST_ASSERT_EQUAL_FLOAT(0.5f, offset[2]);
+
+    // learning of the stationary device
+    for (int i = 0; i < 4; i++) {
+        ThisThread::sleep_for(20ms);
+        acc->read_data(data[i]);
+    }
+    TEST_ASSERT_EQUAL(0, compensator.learn(data, 4));
+    TEST_ASSERT_TRUE(compensator.get_reference(offset));
+    TEST_ASSERT_EQUAL(0, compensator.learn(data, 4));
+    data[1][0] += 5.0f;
+    TEST_ASSERT_NOT_EQUAL(0, compensator.learn(data, 4));
+    TEST_ASSERT_NOT_EQUAL(0, compensator.learn(data, 0));
+    acc->set_offset(nullptr);
+}
+
 /**
  * High pass filter test.
  */
@@ -248,6 +1141,25 @@ Case cases[] = {
     AccCase(test_full_scale),
     AccCase(test_simple_iterrupt_usage),
     AccCase(test_fifo_interrupt_usage),
+    AccCase(test_fifo_overrun_accounting),
+    AccCase(test_fifo_full_drain_without_loss),
+    AccCase(test_fifo_timestamps),
+    AccCase(test_stream_reconfiguration),
+    AccCase(test_adaptive_watermark),
+    AccCase(test_burst_capture),
+    AccCase(test_odr_governor),
+    AccCase(test_auto_range),
+    AccCase(test_config_snapshot),
+    AccCase(test_staged_config),
+    AccCase(test_static_config),
+    AccCase(test_fixed_point_output),
+    AccCase(test_fifo_block_span),
+    AccCase(test_read_data_as),
+    AccCase(test_axis_orientation),
+    AccCase(test_six_position_calibration),
+    AccCase(test_thermal_compensation),
+    AccCase(test_persistent_state),
+    AccCase(test_persistent_state_storage),
     AccCase(test_high_pass_filter)
 };
 Specification specification(test_setup_handler, cases, test_teardown_handler);
@@ -257,7 +1169,7 @@ int main()
 {
     // host handshake
     // note: should be invoked here or in the test_setup_handler
-    GREENTEA_SETUP(40, "default_auto");
+    GREENTEA_SETUP(60, "default_auto");
     // run tests
     return !Harness::run(specification);
 }
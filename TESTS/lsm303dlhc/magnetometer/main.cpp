@@ -107,6 +107,37 @@ void test_magnetometer()
     }
 }
 
+/**
+ * Test automatic full scale ranging.
+ */
+void test_auto_range()
+{
+    int16_t m_data_16[3];
+    float sensitivity[3];
+    float m_data[3];
+
+    mag->set_output_data_rate(LSM303DLHCMagnetometer::ODR_75_HZ);
+    mag->set_full_scale(LSM303DLHCMagnetometer::FULL_SCALE_8_1_G);
+    mag->set_auto_range_mode(LSM303DLHCMagnetometer::AR_ENABLE);
+    TEST_ASSERT_EQUAL(LSM303DLHCMagnetometer::AR_ENABLE, mag->get_auto_range_mode());
+
+    // Earth magnetic field should decrease full scale
+    for (int i = 0; i < 150; i++) {
+        ThisThread::sleep_for(15ms);
+        mag->read_data_16(m_data_16, sensitivity);
+        TEST_ASSERT_NOT_EQUAL(-4096, m_data_16[0]);
+        TEST_ASSERT_NOT_EQUAL(-4096, m_data_16[1]);
+        TEST_ASSERT_NOT_EQUAL(-4096, m_data_16[2]);
+    }
+    mag->set_auto_range_mode(LSM303DLHCMagnetometer::AR_DISABLE);
+    TEST_ASSERT_TRUE(mag->get_full_scale() < LSM303DLHCMagnetometer::FULL_SCALE_8_1_G);
+
+    ThisThread::sleep_for(15ms);
+    mag->read_data(m_data);
+    float m = abs_mag_val(m_data);
+    TEST_ASSERT_TRUE(0.1f < m && m < 1.0f);
+}
+
 struct interrupt_counter_t {
     int samples_count;
     int invokation_count;
@@ -166,6 +197,441 @@ void test_magnetometer_interrupt()
     TEST_ASSERT(m_abs > 0.01);
 }
 
+/**
+ * Test DRDY interrupt driven acquisition.
+ */
+void test_drdy_acquisition()
+{
+    InterruptIn drdy_pin(MBED_CONF_LSM303DLHC_DRIVER_TEST_DRDY);
+    const int n_samples = 10;
+    LSM303DLHCMagnetometer::Sample samples[n_samples];
+
+    mag->set_output_data_rate(LSM303DLHCMagnetometer::ODR_30_HZ);
+    // keep unread sample, so DRDY is high at start
+    ThisThread::sleep_for(100ms);
+    us_timestamp_t start_time = ticker_read_us(get_us_ticker_data());
+    mag->start_drdy_acquisition(&drdy_pin, mbed_event_queue(), samples, n_samples);
+    ThisThread::sleep_for(500ms);
+    int n = mag->stop_drdy_acquisition();
+
+    TEST_ASSERT_EQUAL(n_samples, n);
+    TEST_ASSERT_EQUAL(0, mag->get_drdy_missed_samples());
+    // sample that has been generated before start should be discarded
+    TEST_ASSERT_TRUE(samples[0].timestamp > start_time);
+    for (int i = 1; i < n; i++) {
+        // sample period should be about 33 ms
+        int period = (int)(samples[i].timestamp - samples[i - 1].timestamp);
+        TEST_ASSERT_INT_WITHIN(5000, 33333, period);
+        TEST_ASSERT_NOT_EQUAL(0, samples[i].sensitivity[0]);
+    }
+}
+
+/**
+ * Test data reading with status.
+ */
+void test_read_new_data()
+{
+    int16_t m_data_16[3];
+    int16_t m_prev_data_16[3];
+    uint8_t status;
+
+    mag->set_output_data_rate(LSM303DLHCMagnetometer::ODR_15_HZ);
+    ThisThread::sleep_for(100ms);
+
+    TEST_ASSERT_EQUAL(1, mag->read_new_data_16(m_prev_data_16, &status));
+    TEST_ASSERT_TRUE(status & LSM303DLHCMagnetometer::STATUS_DRDY);
+    // the next conversion isn't finished yet
+    TEST_ASSERT_EQUAL(0, mag->read_new_data_16(m_data_16, &status));
+    TEST_ASSERT_FALSE(status & LSM303DLHCMagnetometer::STATUS_DRDY);
+    TEST_ASSERT_EQUAL_INT16_ARRAY(m_prev_data_16, m_data_16, 3);
+
+    ThisThread::sleep_for(100ms);
+    TEST_ASSERT_EQUAL(1, mag->read_new_data_16(m_data_16));
+}
+
+/**
+ * Test duty cycle measurement window and its estimation.
+ */
+void test_duty_cycle()
+{
+    LSM303DLHCMagnetometer::DutyCycleConfig config = { 1000, 4 };
+    LSM303DLHCMagnetometer::DutyCycleEstimation estimation;
+    LSM303DLHCMagnetometer::DutyCycleEstimation estimation_2;
+    float m[3];
+
+    mag->set_output_data_rate(LSM303DLHCMagnetometer::ODR_75_HZ);
+    mag->set_duty_cycle_config(config);
+    Timer window_timer;
+    window_timer.start();
+    TEST_ASSERT_EQUAL(0, mag->read_duty_cycle_window(m));
+    window_timer.stop();
+    TEST_ASSERT_FLOAT_WITHIN(0.5f, 0.5f, abs_mag_val(m));
+    // the first sample after wake up is discarded, so the window takes at least 5 sample periods
+    TEST_ASSERT_TRUE(window_timer.elapsed_time() >= 60ms);
+    TEST_ASSERT_EQUAL(LSM303DLHCMagnetometer::M_DISABLE, mag->get_magnetometer_mode());
+
+    // more conversions reduce noise, but increase current
+    mag->get_duty_cycle_estimation(&estimation);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 5.0f / 75.0f, estimation.duty_cycle);
+    config.conversions = 16;
+    LSM303DLHCMagnetometer::estimate_duty_cycle(config, LSM303DLHCMagnetometer::ODR_75_HZ, mag->get_full_scale(), &estimation_2);
+    TEST_ASSERT_TRUE(estimation_2.current > estimation.current);
+    TEST_ASSERT_FLOAT_WITHIN(0.0001f, estimation.xy_noise / 2, estimation_2.xy_noise);
+    TEST_ASSERT_FLOAT_WITHIN(0.0001f, estimation.z_noise / 2, estimation_2.z_noise);
+}
+
+/**
+ * Test that continuous mode works without hangs and redundant re-arms.
+ */
+void test_hang_watchdog()
+{
+    float m_data[3];
+    LSM303DLHCMagnetometer::HangWatchdogStatistics stats;
+
+    mag->set_output_data_rate(LSM303DLHCMagnetometer::ODR_75_HZ);
+    TEST_ASSERT_EQUAL(LSM303DLHCMagnetometer::HWD_ENABLE, mag->get_hang_watchdog_mode());
+    mag->reset_hang_watchdog_statistics();
+
+    int changes = 0;
+    float prev_x = 0.0f;
+    for (int i = 0; i < 100; i++) {
+        ThisThread::sleep_for(20ms);
+        mag->read_data(m_data);
+        if (m_data[0] != prev_x) {
+            changes++;
+        }
+        prev_x = m_data[0];
+    }
+    mag->get_hang_watchdog_statistics(&stats);
+
+    // data should be updated and continuous mode should be re-armed only in case of hang
+    TEST_ASSERT_TRUE(changes > 50);
+    TEST_ASSERT_EQUAL(stats.data_timeouts + stats.drdy_timeouts, stats.rearms);
+    TEST_ASSERT_TRUE(stats.rearms < 5);
+}
+
+/**
+ * Test single conversion mode.
+ */
+void test_single_conversion()
+{
+    LSM303DLHCMagnetometer::Sample sample;
+    LSM303DLHCMagnetometer::Sample cached_sample;
+
+    mag->set_magnetometer_mode(LSM303DLHCMagnetometer::M_DISABLE);
+    mag->set_single_conversion_min_period(500);
+
+    TEST_ASSERT_EQUAL(1, mag->read_single_conversion(&sample));
+    float m = sample.data[0] * sample.sensitivity[0];
+    TEST_ASSERT_TRUE(fabsf(m) < 2.0f);
+
+    // the second conversion should be limited
+    TEST_ASSERT_EQUAL(0, mag->read_single_conversion(&cached_sample));
+    TEST_ASSERT_EQUAL(sample.timestamp, cached_sample.timestamp);
+    ThisThread::sleep_for(500ms);
+    TEST_ASSERT_EQUAL(1, mag->read_single_conversion(&cached_sample));
+    mag->set_single_conversion_min_period(0);
+}
+
+/**
+ * Test hard/soft-iron calibration with synthetic samples.
+ */
+void test_calibrator()
+{
+    MagnetometerCalibrator calibrator;
+    LSM303DLHCMagnetometer::Calibration cal;
+    const float offset[3] = { 0.12f, -0.20f, 0.05f };
+    const float axes[3] = { 0.60f, 0.40f, 0.50f };
+    float fit_error;
+
+    // samples of the ellipsoid with hard-iron offset and soft-iron distortion
+    for (int i = 0; i < 12; i++) {
+        for (int j = 1; j < 12; j++) {
+            float phi = 2 * 3.1415927f * i / 12;
+            float theta = 3.1415927f * j / 12;
+            float m[3];
+            m[0] = offset[0] + axes[0] * sinf(theta) * cosf(phi);
+            m[1] = offset[1] + axes[1] * sinf(theta) * sinf(phi);
+            m[2] = offset[2] + axes[2] * cosf(theta);
+            calibrator.add_sample(m);
+        }
+    }
+    TEST_ASSERT_EQUAL(132, calibrator.get_samples());
+    TEST_ASSERT_EQUAL_FLOAT(1.0f, calibrator.get_coverage());
+    TEST_ASSERT_EQUAL(0, calibrator.compute(&cal, &fit_error));
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 0.0f, fit_error);
+    for (int i = 0; i < 3; i++) {
+        TEST_ASSERT_FLOAT_WITHIN(0.001f, offset[i], cal.offset[i]);
+    }
+
+    // calibrated samples should lie on the sphere
+    mag->set_calibration(&cal);
+    LSM303DLHCMagnetometer::Sample sample;
+    float m[3];
+    for (int i = 0; i < 3; i++) {
+        sample.data[i] = 0;
+        sample.sensitivity[i] = 0.001f;
+    }
+    sample.data[0] = (int16_t)((offset[0] + axes[0]) * 1000);
+    sample.data[1] = (int16_t)(offset[1] * 1000);
+    sample.data[2] = (int16_t)(offset[2] * 1000);
+    mag->convert_sample(sample, m);
+    float r1 = abs_mag_val(m);
+    sample.data[0] = (int16_t)(offset[0] * 1000);
+    sample.data[1] = (int16_t)((offset[1] + axes[1]) * 1000);
+    mag->convert_sample(sample, m);
+    float r2 = abs_mag_val(m);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, r1, r2);
+    mag->set_calibration(nullptr);
+    TEST_ASSERT_FALSE(mag->get_calibration(&cal));
+
+    // coverage of the half of ellipsoid shouldn't depend on sample order
+    MagnetometerCalibrator reverse_calibrator;
+    calibrator.reset();
+    for (int k = 0; k < 66; k++) {
+        for (int reverse = 0; reverse < 2; reverse++) {
+            int i = reverse ? 5 - k / 11 : k / 11;
+            int j = reverse ? 11 - k % 11 : k % 11 + 1;
+            float phi = 3.1415927f * i / 6;
+            float theta = 3.1415927f * j / 12;
+            m[0] = offset[0] + axes[0] * sinf(theta) * cosf(phi);
+            m[1] = offset[1] + axes[1] * sinf(theta) * sinf(phi);
+            m[2] = offset[2] + axes[2] * cosf(theta);
+            (reverse ? reverse_calibrator : calibrator).add_sample(m);
+        }
+    }
+    TEST_ASSERT_TRUE(calibrator.get_coverage() < 1.0f);
+    TEST_ASSERT_EQUAL_FLOAT(calibrator.get_coverage(), reverse_calibrator.get_coverage());
+}
+
+/**
+ * Test block conversion.
+ */
+void test_block_conversion()
+{
+    const int n = 7;
+    float data[n][3];
+    int16_t(*data_16)[3] = (int16_t(*)[3])data;
+    int16_t raw[n][3];
+    float expected[n][3];
+    LSM303DLHCMagnetometer::Sample sample;
+    LSM303DLHCMagnetometer::Calibration cal = {
+        { 0.1f, -0.2f, 0.05f },
+        { { 1.1f, 0.1f, 0.0f }, { 0.1f, 0.9f, 0.05f }, { 0.0f, 0.05f, 1.0f } }
+    };
+
+    mag->set_calibration(&cal);
+    mag->read_data_16(sample.data, sample.sensitivity);
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < 3; j++) {
+            raw[i][j] = (int16_t)(i * 100 - j * 250);
+            sample.data[j] = raw[i][j];
+        }
+        mag->convert_sample(sample, expected[i]);
+    }
+
+    // in place conversion
+    memcpy(data_16, raw, sizeof(raw));
+    mag->convert_block(data_16, data, n);
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < 3; j++) {
+            TEST_ASSERT_FLOAT_WITHIN(0.0001f, expected[i][j], data[i][j]);
+        }
+    }
+    mag->set_calibration(nullptr);
+
+    // without calibration vectorized conversion should match scalar conversion and known sensitivity
+    mag->read_data_16(sample.data, sample.sensitivity);
+    memcpy(raw[n - 1], sample.data, sizeof(sample.data));
+    for (int i = 0; i < n; i++) {
+        memcpy(sample.data, raw[i], sizeof(sample.data));
+        mag->convert_sample(sample, expected[i]);
+        for (int j = 0; j < 3; j++) {
+            TEST_ASSERT_FLOAT_WITHIN(0.0001f, raw[i][j] * sample.sensitivity[j], expected[i][j]);
+        }
+    }
+    memcpy(data_16, raw, sizeof(raw));
+    mag->convert_block(data_16, data, n);
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < 3; j++) {
+            TEST_ASSERT_FLOAT_WITHIN(0.0001f, expected[i][j], data[i][j]);
+        }
+    }
+}
+
+/**
+ * Test fixed point output in mG.
+ */
+void test_fixed_point_output()
+{
+    int16_t data_16[4][3];
+    int16_t data_mg[4][3];
+    float data[3];
+
+    mag->read_data_mg(data_mg[0]);
+    mag->read_data(data);
+    for (int i = 0; i < 3; i++) {
+        TEST_ASSERT_INT_WITHIN(50, (int)(data[i] * 1000), data_mg[0][i]);
+    }
+
+    // block conversion
+    for (int i = 0; i < 4; i++) {
+        for (int j = 0; j < 3; j++) {
+            data_16[i][j] = (int16_t)(i * 500 - 1000);
+        }
+    }
+    mag->set_full_scale(LSM303DLHCMagnetometer::FULL_SCALE_1_3_G);
+    mag->convert_block_mg(data_16, data_mg, 4);
+    // 1100 LSB/gauss for X and Y, 980 LSB/gauss for Z
+    TEST_ASSERT_EQUAL(-909, data_mg[0][0]);
+    TEST_ASSERT_EQUAL(-1020, data_mg[0][2]);
+    TEST_ASSERT_EQUAL(0, data_mg[2][1]);
+    TEST_ASSERT_EQUAL(455, data_mg[3][1]);
+}
+
+/**
+ * Test data reading with sample type traits.
+ */
+void test_read_data_as()
+{
+    int16_t data_16[3];
+    float data[3];
+    float data_fs[3];
+    MilliUnits data_mg[3];
+
+    mag->set_full_scale(LSM303DLHCMagnetometer::FULL_SCALE_1_9_G);
+    mag->read_data_as(data_16);
+    mag->read_data_as(data);
+    mag->read_data_as<float, LSM303DLHCMagnetometer::FULL_SCALE_1_9_G>(data_fs);
+    mag->read_data_as<MilliUnits, LSM303DLHCMagnetometer::FULL_SCALE_1_9_G>(data_mg);
+    TEST_ASSERT_FLOAT_WITHIN(0.05f, data_16[0] / 885.0f, data[0]);
+    TEST_ASSERT_FLOAT_WITHIN(0.05f, data_16[2] / 760.0f, data[2]);
+    for (int i = 0; i < 3; i++) {
+        TEST_ASSERT_FLOAT_WITHIN(0.05f, data[i], data_fs[i]);
+        TEST_ASSERT_INT_WITHIN(50, (int)(data[i] * 1000), data_mg[i].value);
+    }
+}
+
+/**
+ * Test mounting orientation of the converted data.
+ */
+void test_axis_orientation()
+{
+    typedef AxisOrientation<AXIS_PY, AXIS_NX, AXIS_PZ> RotatedOrientation;
+    int16_t data_16[3];
+    int16_t data_rot[3];
+    int16_t data_rot_fs[3];
+    int16_t data_rot_mg[3];
+    float data_rot_f[3];
+    int16_t block_16[1][3] = { { 100, 200, 300 } };
+    float block[1][3];
+
+    mag->set_full_scale(LSM303DLHCMagnetometer::FULL_SCALE_1_3_G);
+    mag->read_data_16(data_16);
+    mag->set_orientation<RotatedOrientation>();
+    mag->read_data_as(data_rot);
+    mag->read_data_as<int16_t, LSM303DLHCMagnetometer::FULL_SCALE_1_3_G>(data_rot_fs);
+    mag->read_data_mg(data_rot_mg);
+    mag->read_data(data_rot_f);
+    mag->convert_block(block_16, block, 1);
+    TEST_ASSERT_INT_WITHIN(20, data_16[1], data_rot[0]);
+    TEST_ASSERT_INT_WITHIN(20, -data_16[0], data_rot[1]);
+    TEST_ASSERT_INT_WITHIN(20, data_16[2], data_rot[2]);
+    for (int i = 0; i < 3; i++) {
+        TEST_ASSERT_INT_WITHIN(20, data_rot[i], data_rot_fs[i]);
+        TEST_ASSERT_INT_WITHIN(20, (int)(data_rot_f[i] * 1000), data_rot_mg[i]);
+    }
+    // 1100 LSB/gauss for X and Y, 980 LSB/gauss for Z
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 200 / 1100.0f, block[0][0]);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, -100 / 1100.0f, block[0][1]);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 300 / 980.0f, block[0][2]);
+
+    mag->set_orientation<IdentityOrientation>();
+}
+
+/**
+ * Test temperature compensation calibrator and driver settings.
+ */
+void test_temperature_compensation()
+{
+    MagnetometerTemperatureCalibrator calibrator;
+    LSM303DLHCMagnetometer::TemperatureCompensation tc;
+    const float m_ref[3] = { 0.20f, -0.10f, 0.40f };
+    // offset drift is orthogonal to the field, so it's distinguishable from gain drift
+    const float k_o[3] = { 0.002f, 0.004f, 0.0f };
+    const float k_g = 0.001f;
+
+    // synthetic samples of the stationary device
+    for (int t = 15; t <= 35; t++) {
+        float dt = t - 25.0f;
+        float m[3];
+        for (int i = 0; i < 3; i++) {
+            m[i] = m_ref[i] * (1 + k_g * dt) + k_o[i] * dt;
+        }
+        calibrator.add_sample(m, t);
+    }
+    TEST_ASSERT_EQUAL(21, calibrator.get_samples());
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 20.0f, calibrator.get_temperature_range());
+    TEST_ASSERT_NOT_EQUAL(0, calibrator.compute(&tc, 30.0f));
+    TEST_ASSERT_EQUAL(0, calibrator.compute(&tc));
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 25.0f, tc.reference_temperature);
+    for (int i = 0; i < 3; i++) {
+        TEST_ASSERT_FLOAT_WITHIN(0.0001f, k_g, tc.gain_coefficients[i]);
+        TEST_ASSERT_FLOAT_WITHIN(0.0001f, k_o[i], tc.offset_coefficients[i]);
+    }
+
+    // driver settings
+    LSM303DLHCMagnetometer::TemperatureCompensation tc_out;
+    TEST_ASSERT_FALSE(mag->get_temperature_compensation(&tc_out));
+    mag->set_temperature_compensation(&tc);
+    TEST_ASSERT_TRUE(mag->get_temperature_compensation(&tc_out));
+    TEST_ASSERT_EQUAL_FLOAT(tc.reference_temperature, tc_out.reference_temperature);
+    float m[3];
+    mag->read_data(m);
+    TEST_ASSERT_FLOAT_WITHIN(50.0f, 25.0f, mag->get_compensation_temperature());
+    mag->set_temperature_compensation(nullptr);
+    TEST_ASSERT_FALSE(mag->get_temperature_compensation(&tc_out));
+}
+
+/**
+ * Test configuration saving and restoring.
+ */
+void test_config_snapshot()
+{
+    LSM303DLHCMagnetometer::ConfigSnapshot config;
+
+    mag->set_output_data_rate(LSM303DLHCMagnetometer::ODR_75_HZ);
+    mag->set_full_scale(LSM303DLHCMagnetometer::FULL_SCALE_4_0_G);
+    float sensitivity = mag->get_sensitivity(2);
+    mag->save_config(&config);
+
+    // reset sensor and restore configuration
+    mag->init(false);
+    mag->restore_config(config);
+
+    TEST_ASSERT_EQUAL(LSM303DLHCMagnetometer::M_ENABLE, mag->get_magnetometer_mode());
+    TEST_ASSERT_EQUAL(LSM303DLHCMagnetometer::ODR_75_HZ, mag->get_output_data_rate());
+    TEST_ASSERT_EQUAL(LSM303DLHCMagnetometer::FULL_SCALE_4_0_G, mag->get_full_scale());
+    TEST_ASSERT_EQUAL_FLOAT(sensitivity, mag->get_sensitivity(2));
+}
+
+/**
+ * Test compile time configuration.
+ */
+void test_static_config()
+{
+    typedef MagnetometerStaticConfig<LSM303DLHCMagnetometer::ODR_30_HZ, LSM303DLHCMagnetometer::FULL_SCALE_2_5_G> MagConfig;
+    static_assert(MagConfig::cra_reg() == 0x94, "Invalid CRA_REG_M value");
+
+    mag->apply_static_config<MagConfig>();
+
+    TEST_ASSERT_EQUAL(LSM303DLHCMagnetometer::M_ENABLE, mag->get_magnetometer_mode());
+    TEST_ASSERT_EQUAL(LSM303DLHCMagnetometer::ODR_30_HZ, mag->get_output_data_rate());
+    TEST_ASSERT_EQUAL(LSM303DLHCMagnetometer::FULL_SCALE_2_5_G, mag->get_full_scale());
+    TEST_ASSERT_EQUAL(LSM303DLHCMagnetometer::TS_ENABLE, mag->get_temperature_sensor_mode());
+    TEST_ASSERT_EQUAL_FLOAT(MagConfig::z_sensitivity(), mag->get_sensitivity(2));
+}
+
 // test cases description
 #define MagCase(test_fun) Case(#test_fun, case_setup_handler, test_fun, greentea_case_teardown_handler, greentea_case_failure_continue_handler)
 Case cases[] = {
@@ -173,7 +639,21 @@ Case cases[] = {
     MagCase(test_init_state_disabled),
     MagCase(test_temp_sensor),
     MagCase(test_magnetometer),
-    MagCase(test_magnetometer_interrupt)
+    MagCase(test_auto_range),
+    MagCase(test_magnetometer_interrupt),
+    MagCase(test_drdy_acquisition),
+    MagCase(test_read_new_data),
+    MagCase(test_duty_cycle),
+    MagCase(test_hang_watchdog),
+    MagCase(test_single_conversion),
+    MagCase(test_calibrator),
+    MagCase(test_block_conversion),
+    MagCase(test_fixed_point_output),
+    MagCase(test_read_data_as),
+    MagCase(test_axis_orientation),
+    MagCase(test_temperature_compensation),
+    MagCase(test_config_snapshot),
+    MagCase(test_static_config)
 };
 Specification specification(test_setup_handler, cases, test_teardown_handler);
 
@@ -0,0 +1,68 @@
+/**
+ * Example of the LSM303DLHC usage with STM32F3Discovery board.
+ *
+ * Example of the guided six-position accelerometer calibration.
+ *
+ * Pin map:
+ *
+ * - PC_4 - UART TX (stdout/stderr)
+ * - PC_5 - UART RX (stdin)
+ * - PB_7 - I2C SDA of the LSM303DLHC
+ * - PB_6 - I2C SCL of the LSM303DLHC
+ */
+#include "lsm303dlhc_driver.h"
+#include "math.h"
+#include "mbed.h"
+
+static const char *const position_names[AccelerometerCalibrator::POSITIONS] = {
+    "X axis up", "X axis down", "Y axis up", "Y axis down", "Z axis up", "Z axis down"
+};
+
+int main()
+{
+    // accelerometer initialization
+    I2C acc_i2c(PB_7, PB_6);
+    acc_i2c.frequency(400000);
+    LSM303DLHCAccelerometer accelerometer(&acc_i2c);
+    int err_code = accelerometer.init();
+    if (err_code) {
+        MBED_ERROR(MBED_MAKE_ERROR(MBED_MODULE_APPLICATION, err_code), "accelerometer initialization error");
+    }
+    accelerometer.set_output_data_rate(LSM303DLHCAccelerometer::ODR_100HZ);
+    accelerometer.set_high_resolution_output_mode(LSM303DLHCAccelerometer::HRO_ENABLED);
+
+    printf("-- start accelerometer calibration --\n");
+    AccelerometerCalibrator calibrator;
+    AccelerometerCalibrator::Position position;
+    while ((position = calibrator.get_missing_position()) != AccelerometerCalibrator::POSITION_NONE) {
+        printf("place device with %s and hold it still\n", position_names[position]);
+        ThisThread::sleep_for(3s);
+        AccelerometerCalibrator::Position measured_position;
+        err_code = calibrator.measure_position(&accelerometer, 256, 0.2f, &measured_position);
+        if (err_code) {
+            printf("device moves or isn't aligned, try again\n");
+        } else {
+            printf("measured: %s\n", position_names[measured_position]);
+        }
+    }
+
+    LSM303DLHCAccelerometer::Calibration cal;
+    float fit_error;
+    err_code = calibrator.compute(&cal, &fit_error);
+    if (err_code) {
+        MBED_ERROR(MBED_MAKE_ERROR(MBED_MODULE_APPLICATION, err_code), "calibration error");
+    }
+    printf("bias: %+.4f %+.4f %+.4f m/s^2; fit error: %.4f m/s^2\n", cal.offset[0], cal.offset[1], cal.offset[2], fit_error);
+    for (int i = 0; i < 3; i++) {
+        printf("matrix: %+.5f %+.5f %+.5f\n", cal.matrix[i][0], cal.matrix[i][1], cal.matrix[i][2]);
+    }
+    accelerometer.set_calibration(&cal);
+
+    float data[3];
+    while (true) {
+        accelerometer.read_data(data);
+        float g = sqrtf(data[0] * data[0] + data[1] * data[1] + data[2] * data[2]);
+        printf("x: %+.4f; y: %+.4f; z: %+.4f; |g|: %.4f\n", data[0], data[1], data[2], g);
+        ThisThread::sleep_for(500ms);
+    }
+}
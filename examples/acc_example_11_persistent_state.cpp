@@ -0,0 +1,80 @@
+/**
+ * Example of the LSM303DLHC usage with STM32F3Discovery board.
+ *
+ * Example of the configuration and calibration restoring with KVStore at boot.
+ * The "lsm303dlhc-driver.persistent_state_kvstore" option should be enabled in the mbed_app.json.
+ *
+ * Pin map:
+ *
+ * - PC_4 - UART TX (stdout/stderr)
+ * - PC_5 - UART RX (stdin)
+ * - PB_7 - I2C SDA of the LSM303DLHC
+ * - PB_6 - I2C SCL of the LSM303DLHC
+ */
+#include "lsm303dlhc_driver.h"
+#include "lsm303dlhc_persistent_state.h"
+#include "mbed.h"
+
+#if !MBED_CONF_LSM303DLHC_DRIVER_PERSISTENT_STATE_KVSTORE
+#error "lsm303dlhc-driver.persistent_state_kvstore option is required"
+#endif
+
+using lsm303dlhc::PersistentState;
+
+static const char *const state_key = "/kv/lsm303dlhc";
+
+int main()
+{
+    I2C i2c(PB_7, PB_6);
+    i2c.frequency(400000);
+    LSM303DLHCAccelerometer accelerometer(&i2c);
+    LSM303DLHCMagnetometer magnetometer(&i2c);
+
+    Timer boot_timer;
+    boot_timer.start();
+    int err_code = PersistentState::restore_kv(state_key, &accelerometer, &magnetometer);
+    if (err_code) {
+        printf("saved state isn't found (error: 0x%08X), configure and calibrate sensors\n", err_code);
+        err_code = accelerometer.init();
+        if (err_code) {
+            MBED_ERROR(MBED_MAKE_ERROR(MBED_MODULE_APPLICATION, err_code), "accelerometer initialization error");
+        }
+        err_code = magnetometer.init();
+        if (err_code) {
+            MBED_ERROR(MBED_MAKE_ERROR(MBED_MODULE_APPLICATION, err_code), "magnetometer initialization error");
+        }
+        accelerometer.set_output_data_rate(LSM303DLHCAccelerometer::ODR_100HZ);
+        accelerometer.set_full_scale(LSM303DLHCAccelerometer::FULL_SCALE_4G);
+        magnetometer.set_output_data_rate(LSM303DLHCMagnetometer::ODR_75_HZ);
+
+        // run six-position calibration
+        AccelerometerCalibrator calibrator;
+        AccelerometerCalibrator::Position position;
+        while ((position = calibrator.get_missing_position()) != AccelerometerCalibrator::POSITION_NONE) {
+            printf("place device in position %d and hold it still\n", position);
+            ThisThread::sleep_for(3s);
+            calibrator.measure_position(&accelerometer);
+        }
+        LSM303DLHCAccelerometer::Calibration cal;
+        if (calibrator.compute(&cal) == MBED_SUCCESS) {
+            accelerometer.set_calibration(&cal);
+        }
+
+        PersistentState state;
+        state.capture(&accelerometer, &magnetometer);
+        err_code = state.save_kv(state_key);
+        printf("state saving: %s\n", err_code ? "failed" : "done");
+    } else {
+        printf("state is restored in %lld us\n", (long long)boot_timer.elapsed_time().count());
+    }
+
+    float acc_data[3];
+    float mag_data[3];
+    while (true) {
+        accelerometer.read_data(acc_data);
+        magnetometer.read_data(mag_data);
+        printf("acc: %+.3f %+.3f %+.3f m/s^2; mag: %+.3f %+.3f %+.3f G\n",
+            acc_data[0], acc_data[1], acc_data[2], mag_data[0], mag_data[1], mag_data[2]);
+        ThisThread::sleep_for(500ms);
+    }
+}
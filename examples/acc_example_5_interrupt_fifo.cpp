@@ -24,10 +24,14 @@ struct accel_interrupt_processor_t {
     {
         led_ptr->write(1);
 
-        float axes_data[3];
-        for (int i = 0; i < block_size; i++) {
-            accel_ptr->read_data(axes_data);
-            printf("%4d. x = %+6.2f m/s^2; y = %+6.2f m/s^2; z = %+6.2f m/s^2\n", count, axes_data[0], axes_data[1], axes_data[2]);
+        float axes_data[LSM303DLHCAccelerometer::FIFO_SIZE][3];
+        LSM303DLHCAccelerometer::BlockInfo block_info;
+        int n = accel_ptr->read_fifo_data(axes_data, LSM303DLHCAccelerometer::FIFO_SIZE, &block_info);
+        if (block_info.lost_samples > 0) {
+            printf("FIFO overrun: ~%d samples are lost\n", block_info.lost_samples);
+        }
+        for (int i = 0; i < n; i++) {
+            printf("%4d. x = %+6.2f m/s^2; y = %+6.2f m/s^2; z = %+6.2f m/s^2\n", count, axes_data[i][0], axes_data[i][1], axes_data[i][2]);
             count++;
         }
 
@@ -0,0 +1,70 @@
+/**
+ * Example of the LSM303DLHC usage with STM32F3Discovery board.
+ *
+ * Example of the FIFO sample timestamps reconstruction.
+ *
+ * Pin map:
+ *
+ * - PC_4 - UART TX (stdout/stderr)
+ * - PC_5 - UART RX (stdin)
+ * - PB_7 - I2C SDA of the LSM303DLHC
+ * - PB_6 - I2C SCL of the LSM303DLHC
+ * - PE_4 - INT1 pin of the LSM303DLHC
+ */
+#include "lsm303dlhc_driver.h"
+#include "mbed.h"
+
+class AccBlockPrinter {
+public:
+    AccBlockPrinter(LSM303DLHCAccelerometer *accel_ptr, EventQueue *queue_ptr)
+        : _accel_ptr(accel_ptr)
+        , _queue_ptr(queue_ptr)
+    {
+    }
+
+    void process_interrupt()
+    {
+        // save edge time in the ISR and process data in the thread context
+        _accel_ptr->mark_watermark_interrupt();
+        _queue_ptr->call(this, &AccBlockPrinter::read_and_print);
+    }
+
+    void read_and_print()
+    {
+        LSM303DLHCAccelerometer::BlockInfo block_info;
+        int n = _accel_ptr->read_fifo_data(_data, LSM303DLHCAccelerometer::FIFO_SIZE, &block_info);
+        if (n <= 0) {
+            return;
+        }
+        printf("block: samples = %2d; first = %10llu us; last = %10llu us; estimated ODR = %.3f Hz\n",
+            n, block_info.timestamp, block_info.get_sample_timestamp(n - 1), _accel_ptr->get_estimated_output_data_rate_hz());
+    }
+
+private:
+    LSM303DLHCAccelerometer *_accel_ptr;
+    EventQueue *_queue_ptr;
+    float _data[LSM303DLHCAccelerometer::FIFO_SIZE][3];
+};
+
+int main()
+{
+    // accelerometer initialization
+    I2C acc_i2c(PB_7, PB_6);
+    acc_i2c.frequency(400000);
+    LSM303DLHCAccelerometer accelerometer(&acc_i2c);
+    int err_code = accelerometer.init();
+    if (err_code) {
+        MBED_ERROR(MBED_MAKE_ERROR(MBED_MODULE_APPLICATION, err_code), "accelerometer initialization error");
+    }
+
+    printf("-- start accelerometer test --\n");
+    InterruptIn int1(PE_4);
+    EventQueue queue;
+    AccBlockPrinter acc_block_printer(&accelerometer, &queue);
+    int1.rise(callback(&acc_block_printer, &AccBlockPrinter::process_interrupt));
+    accelerometer.set_output_data_rate(LSM303DLHCAccelerometer::ODR_400HZ);
+    accelerometer.set_fifo_watermark(24);
+    accelerometer.set_fifo_mode(LSM303DLHCAccelerometer::FIFO_ENABLE);
+    accelerometer.set_data_ready_interrupt_mode(LSM303DLHCAccelerometer::DRDY_ENABLE);
+    queue.dispatch_forever();
+}
@@ -0,0 +1,83 @@
+/**
+ * Example of the LSM303DLHC usage with STM32F3Discovery board.
+ *
+ * Example of the motion-triggered burst capture.
+ *
+ * Pin map:
+ *
+ * - PC_4 - UART TX (stdout/stderr)
+ * - PC_5 - UART RX (stdin)
+ * - PB_7 - I2C SDA of the LSM303DLHC
+ * - PB_6 - I2C SCL of the LSM303DLHC
+ * - PE_4 - INT1 pin of the LSM303DLHC
+ */
+#include "lsm303dlhc_driver.h"
+#include "mbed.h"
+
+class BurstCaptureProcessor {
+public:
+    BurstCaptureProcessor(LSM303DLHCAccelerometer *accel_ptr, EventQueue *queue_ptr)
+        : _accel_ptr(accel_ptr)
+        , _queue_ptr(queue_ptr)
+        , _led(LED2)
+    {
+    }
+
+    void process_interrupt()
+    {
+        _accel_ptr->mark_watermark_interrupt();
+        _queue_ptr->call(this, &BurstCaptureProcessor::process);
+    }
+
+    void process()
+    {
+        LSM303DLHCAccelerometer::BurstCaptureState prev_state = _accel_ptr->get_burst_capture_state();
+        int n = _accel_ptr->process_burst_capture(_data, LSM303DLHCAccelerometer::FIFO_SIZE);
+        LSM303DLHCAccelerometer::BurstCaptureState state = _accel_ptr->get_burst_capture_state();
+
+        if (n > 0) {
+            printf("captured %2d samples: x = %+6d; y = %+6d; z = %+6d\n", n, _data[0][0], _data[0][1], _data[0][2]);
+        }
+        if (prev_state != state) {
+            printf("-- %s --\n", state == LSM303DLHCAccelerometer::BCS_CAPTURE ? "capture" : "idle");
+        }
+        _led = state == LSM303DLHCAccelerometer::BCS_CAPTURE;
+    }
+
+private:
+    LSM303DLHCAccelerometer *_accel_ptr;
+    EventQueue *_queue_ptr;
+    DigitalOut _led;
+    int16_t _data[LSM303DLHCAccelerometer::FIFO_SIZE][3];
+};
+
+int main()
+{
+    // accelerometer initialization
+    I2C acc_i2c(PB_7, PB_6);
+    acc_i2c.frequency(400000);
+    LSM303DLHCAccelerometer accelerometer(&acc_i2c);
+    int err_code = accelerometer.init();
+    if (err_code) {
+        MBED_ERROR(MBED_MAKE_ERROR(MBED_MODULE_APPLICATION, err_code), "accelerometer initialization error");
+    }
+
+    printf("-- start accelerometer test --\n");
+    InterruptIn int1(PE_4);
+    EventQueue queue;
+    BurstCaptureProcessor processor(&accelerometer, &queue);
+    int1.rise(callback(&processor, &BurstCaptureProcessor::process_interrupt));
+
+    LSM303DLHCAccelerometer::BurstCaptureConfig config;
+    config.idle_odr = LSM303DLHCAccelerometer::ODR_10HZ;
+    config.capture_odr = LSM303DLHCAccelerometer::ODR_400HZ;
+    config.full_scale = LSM303DLHCAccelerometer::FULL_SCALE_8G;
+    config.watermark = 24;
+    config.wakeup_threshold = 2.0f;
+    config.capture_duration = 5000;
+    config.quiescent_threshold = 0.5f;
+    config.quiescent_duration = 500;
+    accelerometer.start_burst_capture(config);
+
+    queue.dispatch_forever();
+}
@@ -0,0 +1,77 @@
+/**
+ * Example of the LSM303DLHC usage with STM32F3Discovery board.
+ *
+ * Benchmark of the floating point and fixed point conversion of the FIFO blocks.
+ * On targets without FPU the fixed point conversion (read_fifo_data_mg) avoids software float emulation.
+ */
+#include "lsm303dlhc_driver.h"
+#include "mbed.h"
+
+/**
+ * Pin map:
+ *
+ * - LSM303DLHC_I2C_SDA_PIN - I2C SDA of the LSM303DLHC
+ * - LSM303DLHC_I2C_SCL_PIN - I2C SCL of the LSM303DLHC
+ */
+#define LSM303DLHC_I2C_SDA_PIN PB_7
+#define LSM303DLHC_I2C_SCL_PIN PB_6
+
+#define BLOCK_SIZE 32
+#define ITERATIONS 1000
+
+static int16_t raw_block[BLOCK_SIZE][3];
+static float float_block[BLOCK_SIZE][3];
+static int16_t fixed_block[BLOCK_SIZE][3];
+
+/**
+ * Measure conversion time in CPU cycles per sample.
+ */
+template <typename F>
+float measure_cycles_per_sample(F convert)
+{
+    Timer t;
+    t.start();
+    for (int i = 0; i < ITERATIONS; i++) {
+        convert();
+    }
+    t.stop();
+    float cycles = (float)t.elapsed_time().count() * (SystemCoreClock / 1000000);
+    return cycles / (ITERATIONS * BLOCK_SIZE);
+}
+
+int main()
+{
+    // accelerometer initialization
+    LSM303DLHCAccelerometer accelerometer(LSM303DLHC_I2C_SDA_PIN, LSM303DLHC_I2C_SCL_PIN);
+    int err_code = accelerometer.init();
+    if (err_code) {
+        MBED_ERROR(MBED_MAKE_ERROR(MBED_MODULE_APPLICATION, err_code), "accelerometer initialization error");
+    }
+    accelerometer.set_full_scale(LSM303DLHCAccelerometer::FULL_SCALE_4G);
+
+    // fill block with real samples
+    for (int i = 0; i < BLOCK_SIZE; i++) {
+        accelerometer.read_data_16(raw_block[i]);
+    }
+
+    // the same conversions as read_fifo_data and read_fifo_data_mg use
+    const float sensitivity = accelerometer.get_sensitivity();
+    const float float_sensitivity[3] = { sensitivity, sensitivity, sensitivity };
+    const int32_t mg_scale = LSM303DLHCAccelerometer::get_full_scale_sensitivity_mg(LSM303DLHCAccelerometer::FULL_SCALE_4G) << 16;
+    const int32_t fixed_scale[3] = { mg_scale, mg_scale, mg_scale };
+
+    float float_cycles = measure_cycles_per_sample([&]() {
+        convert_raw_block(raw_block, float_block, BLOCK_SIZE, float_sensitivity);
+    });
+    float fixed_cycles = measure_cycles_per_sample([&]() {
+        convert_raw_block_fixed(raw_block, fixed_block, BLOCK_SIZE, fixed_scale);
+    });
+
+    printf("float conversion: %.1f cycles/sample\n", float_cycles);
+    printf("fixed point conversion: %.1f cycles/sample\n", fixed_cycles);
+    printf("x = %+7.3f m/s^2 (%+6d mg)\n", float_block[0][0], fixed_block[0][0]);
+
+    while (true) {
+        ThisThread::sleep_for(1s);
+    }
+}
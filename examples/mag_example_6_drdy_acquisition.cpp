@@ -0,0 +1,63 @@
+/**
+ * Example of the LSM303DLHC usage with STM32F3Discovery board.
+ *
+ * Example of the DRDY interrupt driven acquisition.
+ */
+#include "lsm303dlhc_driver.h"
+#include "mbed.h"
+
+/**
+ * Pin map:
+ *
+ * - LSM303DLHC_I2C_SDA_PIN - I2C SDA of the LSM303DLHC
+ * - LSM303DLHC_I2C_SCL_PIN - I2C SCL of the LSM303DLHC
+ * - LSM303DLHC_DRDY - DRDY pin of the LSM303DLHC
+ */
+#define LSM303DLHC_I2C_SDA_PIN PB_7
+#define LSM303DLHC_I2C_SCL_PIN PB_6
+#define LSM303DLHC_DRDY PE_2
+
+class MagDataPrinter {
+public:
+    MagDataPrinter()
+        : count(0)
+        , prev_timestamp(0)
+    {
+    }
+
+    void print(const LSM303DLHCMagnetometer::Sample &sample)
+    {
+        float axes_data[3];
+        for (int i = 0; i < 3; i++) {
+            axes_data[i] = sample.data[i] * sample.sensitivity[i];
+        }
+        int period = prev_timestamp ? (int)(sample.timestamp - prev_timestamp) : 0;
+        prev_timestamp = sample.timestamp;
+        printf("%4d. x = %+6.3f G; y = %+6.3f G; z = %+6.3f G; period = %6d us\n", count, axes_data[0], axes_data[1], axes_data[2], period);
+        count++;
+    }
+
+private:
+    int count;
+    us_timestamp_t prev_timestamp;
+};
+
+int main()
+{
+    // magnetometer initialization
+    I2C mag_i2c(LSM303DLHC_I2C_SDA_PIN, LSM303DLHC_I2C_SCL_PIN);
+    mag_i2c.frequency(400000);
+    LSM303DLHCMagnetometer magnetometer(&mag_i2c);
+    int err_code = magnetometer.init();
+    if (err_code) {
+        MBED_ERROR(MBED_MAKE_ERROR(MBED_MODULE_APPLICATION, err_code), "magnetometer initialization error");
+    }
+    magnetometer.set_output_data_rate(LSM303DLHCMagnetometer::ODR_15_HZ);
+
+    // read each sample on DRDY edge
+    InterruptIn drdy(LSM303DLHC_DRDY);
+    EventQueue queue;
+    MagDataPrinter mag_data_printer;
+    magnetometer.start_drdy_acquisition(&drdy, &queue, callback(&mag_data_printer, &MagDataPrinter::print));
+    queue.dispatch_forever();
+}
@@ -0,0 +1,43 @@
+/**
+ * Example of the LSM303DLHC usage with STM32F3Discovery board.
+ *
+ * Example of the periodic single conversions with minimal power consumption.
+ */
+#include "lsm303dlhc_driver.h"
+#include "mbed.h"
+
+/**
+ * Pin map:
+ *
+ * - LSM303DLHC_I2C_SDA_PIN - I2C SDA of the LSM303DLHC
+ * - LSM303DLHC_I2C_SCL_PIN - I2C SCL of the LSM303DLHC
+ */
+#define LSM303DLHC_I2C_SDA_PIN PB_7
+#define LSM303DLHC_I2C_SCL_PIN PB_6
+
+void print_sample(const LSM303DLHCMagnetometer::Sample &sample)
+{
+    float axes_data[3];
+    for (int i = 0; i < 3; i++) {
+        axes_data[i] = sample.data[i] * sample.sensitivity[i];
+    }
+    printf("x = %+6.3f G; y = %+6.3f G; z = %+6.3f G\n", axes_data[0], axes_data[1], axes_data[2]);
+}
+
+int main()
+{
+    // magnetometer initialization
+    I2C mag_i2c(LSM303DLHC_I2C_SDA_PIN, LSM303DLHC_I2C_SCL_PIN);
+    mag_i2c.frequency(400000);
+    LSM303DLHCMagnetometer magnetometer(&mag_i2c);
+    // keep sensor in the idle mode between conversions
+    int err_code = magnetometer.init(false);
+    if (err_code) {
+        MBED_ERROR(MBED_MAKE_ERROR(MBED_MODULE_APPLICATION, err_code), "magnetometer initialization error");
+    }
+
+    // run conversion with 2 Hz frequency
+    EventQueue queue;
+    magnetometer.start_single_conversion_schedule(&queue, 500, print_sample);
+    queue.dispatch_forever();
+}
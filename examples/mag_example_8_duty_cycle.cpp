@@ -0,0 +1,46 @@
+/**
+ * Example of the LSM303DLHC usage with STM32F3Discovery board.
+ *
+ * Example of the duty cycle mode: magnetometer sleeps between measurement windows.
+ */
+#include "lsm303dlhc_driver.h"
+#include "mbed.h"
+
+/**
+ * Pin map:
+ *
+ * - LSM303DLHC_I2C_SDA_PIN - I2C SDA of the LSM303DLHC
+ * - LSM303DLHC_I2C_SCL_PIN - I2C SCL of the LSM303DLHC
+ */
+#define LSM303DLHC_I2C_SDA_PIN PB_7
+#define LSM303DLHC_I2C_SCL_PIN PB_6
+
+void print_data(const float *data)
+{
+    printf("x = %+6.3f G; y = %+6.3f G; z = %+6.3f G\n", data[0], data[1], data[2]);
+}
+
+int main()
+{
+    // magnetometer initialization
+    I2C mag_i2c(LSM303DLHC_I2C_SDA_PIN, LSM303DLHC_I2C_SCL_PIN);
+    mag_i2c.frequency(400000);
+    LSM303DLHCMagnetometer magnetometer(&mag_i2c);
+    int err_code = magnetometer.init(false);
+    if (err_code) {
+        MBED_ERROR(MBED_MAKE_ERROR(MBED_MODULE_APPLICATION, err_code), "magnetometer initialization error");
+    }
+    magnetometer.set_output_data_rate(LSM303DLHCMagnetometer::ODR_75_HZ);
+
+    // average 4 conversions every second
+    LSM303DLHCMagnetometer::DutyCycleConfig config = { 1000, 4 };
+    LSM303DLHCMagnetometer::DutyCycleEstimation estimation;
+    magnetometer.set_duty_cycle_config(config);
+    magnetometer.get_duty_cycle_estimation(&estimation);
+    printf("duty cycle = %.4f; current = %.1f uA; noise xy = %.5f G; noise z = %.5f G\n",
+        estimation.duty_cycle, estimation.current, estimation.xy_noise, estimation.z_noise);
+
+    EventQueue queue;
+    magnetometer.start_duty_cycle_schedule(&queue, print_data);
+    queue.dispatch_forever();
+}
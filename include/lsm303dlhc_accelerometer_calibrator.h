@@ -0,0 +1,110 @@
+#ifndef LSM303DLHC_ACCELEROMETER_CALIBRATOR_H
+#define LSM303DLHC_ACCELEROMETER_CALIBRATOR_H
+
+#include "lsm303dlhc_accelerometer_driver.h"
+#include "mbed.h"
+
+namespace lsm303dlhc {
+
+/**
+ * Six-position accelerometer calibrator.
+ *
+ * The measured value is modeled as \f$a = K g + o\f$, where \f$g\f$ is gravity vector, \f$K\f$ is scale and
+ * cross-axis misalignment matrix and \f$o\f$ is bias. The device is placed with each axis up and down,
+ * so the matrix column \f$i\f$ is half-difference of the opposite positions of the axis \f$i\f$ divided
+ * by gravity and the bias is mean of all positions. The result is LSM303DLHCAccelerometer::Calibration with
+ * \f$W = K^{-1}\f$.
+ *
+ * Usage:
+ * 1. place device in position that is returned by get_missing_position;
+ * 2. invoke measure_position to average stationary samples from FIFO;
+ * 3. repeat until get_missing_position returns POSITION_NONE;
+ * 4. invoke compute and pass calibration to LSM303DLHCAccelerometer::set_calibration.
+ */
+class AccelerometerCalibrator : NonCopyable<AccelerometerCalibrator> {
+public:
+    /**
+     * Device position: axis that is directed up.
+     */
+    enum Position {
+        POSITION_NONE = -1,
+        POSITION_X_UP = 0,
+        POSITION_X_DOWN = 1,
+        POSITION_Y_UP = 2,
+        POSITION_Y_DOWN = 3,
+        POSITION_Z_UP = 4,
+        POSITION_Z_DOWN = 5
+    };
+
+    /**
+     * Number of positions.
+     */
+    static const int POSITIONS = 6;
+
+    AccelerometerCalibrator();
+
+    virtual ~AccelerometerCalibrator();
+
+    /**
+     * Remove all measured positions.
+     */
+    void reset();
+
+    /**
+     * Add averaged stationary sample.
+     *
+     * The position is detected by the dominant axis of the sample. The sample of the already measured position
+     * replaces the previous one.
+     *
+     * @param data sample in m/s^2 (x, y, z) without calibration and offset
+     * @return detected position or POSITION_NONE, if any axis isn't aligned with gravity
+     */
+    Position add_position(const float data[3]);
+
+    /**
+     * Measure current position.
+     *
+     * The raw samples are read from accelerometer FIFO and averaged. The FIFO mode is restored after
+     * measurement, but FIFO content is lost. The accelerometer should be enabled.
+     *
+     * @param acc accelerometer
+     * @param samples number of samples to average
+     * @param motion_threshold maximal standard deviation of the samples in m/s^2
+     * @param position optional detected position
+     * @return 0 on success, otherwise non-zero error code (device moves, isn't aligned or accelerometer doesn't produce data)
+     */
+    int measure_position(LSM303DLHCAccelerometer *acc, int samples = 64, float motion_threshold = 0.2f, Position *position = nullptr);
+
+    /**
+     * Check if position has been measured.
+     *
+     * @param position
+     * @return
+     */
+    bool has_position(Position position);
+
+    /**
+     * Get next position that should be measured.
+     *
+     * @return position or POSITION_NONE, if all positions have been measured
+     */
+    Position get_missing_position();
+
+    /**
+     * Calculate calibration.
+     *
+     * @param cal calibration
+     * @param fit_error optional RMS of the calibrated position errors in m/s^2
+     * @return 0 on success, otherwise non-zero error code (not all positions are measured or they are degenerate)
+     */
+    int compute(LSM303DLHCAccelerometer::Calibration *cal, float *fit_error = nullptr);
+
+private:
+    // measured positions mask
+    uint8_t _positions;
+    // averaged samples of positions
+    float _data[POSITIONS][3];
+};
+}
+
+#endif // LSM303DLHC_ACCELEROMETER_CALIBRATOR_H
@@ -1,6 +1,9 @@
 #ifndef LSM303DLHC_ACCELEROMETER_DRIVER_H
 #define LSM303DLHC_ACCELEROMETER_DRIVER_H
 
+#include "lsm303dlhc_axis_orientation.h"
+#include "lsm303dlhc_sample_span.h"
+#include "lsm303dlhc_sample_traits.h"
 #include "lsm303dlhc_utils.h"
 #include "mbed.h"
 
@@ -155,6 +158,40 @@ public:
      */
     float get_output_data_rate_hz();
 
+    /**
+     * Get output data rate in Hz.
+     *
+     * @param odr
+     * @return
+     */
+    static constexpr float get_output_data_rate_hz(OutputDataRate odr)
+    {
+        switch (odr) {
+        case ODR_1HZ:
+            return 1.0f;
+        case ODR_10HZ:
+            return 10.0f;
+        case ODR_25HZ:
+            return 25.0f;
+        case ODR_50HZ:
+            return 50.0f;
+        case ODR_100HZ:
+            return 100.0f;
+        case ODR_200HZ:
+            return 200.0f;
+        case ODR_400HZ:
+            return 400.0f;
+        case ODR_1620HZ:
+            return 1620.0f;
+        case ODR_1344HZ:
+            return 1344.0f;
+        case ODR_5376HZ:
+            return 5376.0f;
+        default:
+            return 0.0f;
+        }
+    }
+
     enum FullScale {
         FULL_SCALE_2G = 0x00,
         FULL_SCALE_4G = 0x10,
@@ -179,7 +216,7 @@ public:
      */
     FullScale get_full_scale();
 
-    static const float GRAVITY_OF_EARTH;
+    static constexpr float GRAVITY_OF_EARTH = 9.80665f;
 
     /**
      * Get sensor sensitivity in (m/s^2)/LSB.
@@ -188,6 +225,50 @@ public:
      */
     float get_sensitivity();
 
+    /**
+     * Get sensitivity in (m/s^2)/LSB of the full scale mode.
+     *
+     * @param fs
+     * @return
+     */
+    static constexpr float get_full_scale_sensitivity(FullScale fs)
+    {
+        switch (fs) {
+        case FULL_SCALE_2G:
+            return 0.001f * GRAVITY_OF_EARTH;
+        case FULL_SCALE_4G:
+            return 0.002f * GRAVITY_OF_EARTH;
+        case FULL_SCALE_8G:
+            return 0.004f * GRAVITY_OF_EARTH;
+        case FULL_SCALE_16G:
+            return 0.012f * GRAVITY_OF_EARTH;
+        default:
+            return 0.0f;
+        }
+    }
+
+    /**
+     * Get sensitivity in mg/LSB of the full scale mode.
+     *
+     * @param fs
+     * @return
+     */
+    static constexpr int get_full_scale_sensitivity_mg(FullScale fs)
+    {
+        switch (fs) {
+        case FULL_SCALE_2G:
+            return 1;
+        case FULL_SCALE_4G:
+            return 2;
+        case FULL_SCALE_8G:
+            return 4;
+        case FULL_SCALE_16G:
+            return 12;
+        default:
+            return 0;
+        }
+    }
+
     enum HighPassFilterMode {
         HPF_OFF = 0xFF, /* Switch off filter */
         HPF_CF0 = 0x00, /* Set cutoff 0 */
@@ -226,6 +307,32 @@ public:
      */
     float get_high_pass_filter_cut_off_frequency();
 
+    /**
+     * Calculate cut off frequency of the high pass filter for specified mode and output data rate.
+     *
+     * The values of the expression \f$-ln(1 - \fraq{3}{25 2^{HP_C}}) \fraq{1}{2 \pi}\f$ are precalculated,
+     * so it can be evaluated at compile time.
+     *
+     * @param hpf
+     * @param odr
+     * @return
+     */
+    static constexpr float get_high_pass_filter_cut_off_frequency(HighPassFilterMode hpf, OutputDataRate odr)
+    {
+        switch (hpf) {
+        case HPF_CF0:
+            return 2.0345313e-02f * get_output_data_rate_hz(odr);
+        case HPF_CF1:
+            return 9.8477764e-03f * get_output_data_rate_hz(odr);
+        case HPF_CF2:
+            return 4.8477334e-03f * get_output_data_rate_hz(odr);
+        case HPF_CF3:
+            return 2.4054102e-03f * get_output_data_rate_hz(odr);
+        default:
+            return 0.0f;
+        }
+    }
+
     enum FIFOMode {
         FIFO_ENABLE = 1,
         FIFO_DISABLE = 0
@@ -285,6 +392,28 @@ public:
      */
     DatadaReadyInterruptMode get_data_ready_interrupt_mode();
 
+    enum OverrunInterruptMode {
+        OVRN_ENABLE = 1,
+        OVRN_DISABLE = 0
+    };
+
+    /**
+     * Enable/disable FIFO overrun interrupt on pin INT1.
+     *
+     * The interrupt is independent from the data ready/watermark interrupt, so it can be routed
+     * to the same pin to detect a late consumer.
+     *
+     * @param ovrn_mode
+     */
+    void set_overrun_interrupt_mode(OverrunInterruptMode ovrn_mode);
+
+    /**
+     * Check if FIFO overrun interrupt is disabled/enabled.
+     *
+     * @return
+     */
+    OverrunInterruptMode get_overrun_interrupt_mode();
+
     enum HighResolutionOutputMode {
         HRO_ENABLED = 1,
         HRO_DISABLED = 0
@@ -314,26 +443,682 @@ public:
      * The data will be placed into \p data array in order: x, y, z.
      * The values is converted into m/s^2 units.
      *
-     * @note the data can have offset
-     *
-     * @todo
-     * Add possibility to add user offset for a calibration.
+     * The calibration set by set_calibration and offset set by set_offset are applied.
      *
      * @param data
      */
     void read_data(float data[3]);
 
+    /**
+     * Set offset in m/s^2 that is subtracted from the data by read_data, read_fifo_data and reconfigure_stream methods.
+     *
+     * The offset doesn't depend on full scale, so it remains valid after full scale change.
+     * It's subtracted after calibration and orientation, so it's set in board axes and can be used
+     * for additional drift compensation.
+     *
+     * @param offset offset (x, y, z) or nullptr to disable offset compensation
+     */
+    void set_offset(const float offset[3]);
+
+    /**
+     * Get current offset.
+     *
+     * @param offset
+     * @return true if offset compensation is enabled, otherwise false
+     */
+    bool get_offset(float offset[3]);
+
+    /**
+     * Bias, scale and cross-axis misalignment calibration.
+     *
+     * The calibrated value is calculated as: \f$a_{cal} = W (a - o)\f$, where \f$o\f$ is bias in m/s^2 and
+     * \f$W\f$ is scale and misalignment correction matrix. The calibration can be calculated
+     * by AccelerometerCalibrator.
+     */
+    struct Calibration {
+        float offset[3];
+        float matrix[3][3];
+    };
+
+    /**
+     * Set calibration that is applied by read_data, read_fifo_data and reconfigure_stream methods.
+     *
+     * Sensitivity, calibration and offset are fused into one affine transformation,
+     * so FIFO blocks are still converted in one pass. The calibration doesn't depend on full scale.
+     *
+     * @param cal calibration or @c nullptr to disable calibration
+     */
+    void set_calibration(const Calibration *cal);
+
+    /**
+     * Get current calibration.
+     *
+     * @param cal
+     * @return @c true if calibration is set, otherwise @c false
+     */
+    bool get_calibration(Calibration *cal);
+
+    /**
+     * Set mounting orientation that is applied by read_data, read_data_mg, read_data_as, read_fifo_data,
+     * read_fifo_data_mg and reconfigure_stream methods.
+     *
+     * The orientation is applied after calibration, so the calibration remains in sensor axes and
+     * AccelerometerCalibrator results don't depend on it. The raw data of read_data_16 and read_fifo_data_16
+     * is kept in sensor axes.
+     *
+     * @code
+     * accelerometer.set_orientation<AxisOrientation<AXIS_PY, AXIS_NX, AXIS_PZ>>();
+     * @endcode
+     *
+     * @tparam Orientation mounting orientation (see AxisOrientation)
+     */
+    template <class Orientation>
+    void set_orientation()
+    {
+        const int8_t matrix[3][3] = {
+            { Orientation::matrix(0, 0), Orientation::matrix(0, 1), Orientation::matrix(0, 2) },
+            { Orientation::matrix(1, 0), Orientation::matrix(1, 1), Orientation::matrix(1, 2) },
+            { Orientation::matrix(2, 0), Orientation::matrix(2, 1), Orientation::matrix(2, 2) }
+        };
+        _set_orientation(matrix);
+    }
+
     /**
      * Read raw accelerometer data.
      *
      * The data will be placed into \p data array in order: x, y, z.
      * The values represent signed integers. To get m/s^2 units, the values should be multiply
      * by the value that is returned by method LSM303DLHCAccelerometer::get_sensitivity.
+     * The values are in sensor axes, as the orientation set by set_orientation isn't applied.
      *
      * @param data
      */
     void read_data_16(int16_t data[3]);
 
+    /**
+     * Read current accelerometer data in mg.
+     *
+     * The conversion uses only integer arithmetic, so it's suitable for targets without FPU.
+     * The offset set by set_offset is subtracted with mg resolution and the orientation set by set_orientation is applied.
+     *
+     * @note the calibration set by set_calibration isn't applied
+     *
+     * @param data
+     */
+    void read_data_mg(int16_t data[3]);
+
+    /**
+     * Read current accelerometer data as sample type \p T.
+     *
+     * The sample is converted by SampleTraits<T>, so it can be raw value (int16_t), m/s^2 (float),
+     * mg (MilliUnits) or user type.
+     *
+     * The calibration, offset and orientation are applied as by read_data, but the result is rounded
+     * to LSB before conversion. They are skipped, if they aren't set, so the sample is converted directly.
+     *
+     * @tparam T sample type
+     * @param data sample (x, y, z)
+     */
+    template <typename T>
+    void read_data_as(T data[3])
+    {
+        int16_t data_16[3];
+        read_data_16(data_16);
+        _correct_data_16(data_16, _sensitivity);
+        for (int i = 0; i < 3; i++) {
+            data[i] = SampleTraits<T>::convert(data_16[i], _sensitivity, _sensitivity_mg << 16);
+        }
+    }
+
+    /**
+     * Read current accelerometer data as sample type \p T with compile time full scale.
+     *
+     * The sensitivity is folded into constants, so the conversion doesn't use cached sensitivity.
+     * The sensor should be configured with full scale \p FS and automatic ranging should be disabled.
+     *
+     * @code
+     * float data[3];
+     * accelerometer.read_data_as<float, LSM303DLHCAccelerometer::FULL_SCALE_2G>(data);
+     * @endcode
+     *
+     * The calibration, offset and orientation are applied as by read_data_as<T>.
+     *
+     * @tparam T sample type
+     * @tparam FS full scale
+     * @param data sample (x, y, z)
+     */
+    template <typename T, FullScale FS>
+    void read_data_as(T data[3])
+    {
+        static_assert(get_full_scale_sensitivity_mg(FS) > 0, "Invalid full scale");
+        constexpr float sensitivity = get_full_scale_sensitivity(FS);
+        constexpr int32_t milli_scale = get_full_scale_sensitivity_mg(FS) << 16;
+        MBED_ASSERT(!_ar_enabled && _full_scale == FS);
+
+        int16_t data_16[3];
+        read_data_16(data_16);
+        _correct_data_16(data_16, sensitivity);
+        for (int i = 0; i < 3; i++) {
+            data[i] = SampleTraits<T>::convert(data_16[i], sensitivity, milli_scale);
+        }
+    }
+
+    /**
+     * Description of a block of samples that is read from FIFO.
+     */
+    struct BlockInfo {
+        // number of samples in the block
+        int samples;
+        // FIFO has been full (OVRN_FIFO) before the block reading, so samples could be overwritten
+        bool overrun;
+        // estimated number of samples that have been lost before the first sample of the block,
+        // it's zero if full FIFO has been drained before the next sample
+        int lost_samples;
+        // reconstructed timestamp of the first sample in microseconds
+        us_timestamp_t timestamp;
+        // estimated sample period in microseconds
+        float sample_period;
+        // sensitivity ((m/s^2)/LSB) of the configuration that the samples have been produced with
+        float sensitivity;
+        // number of samples of the previous configuration that are left in FIFO by reconfigure_stream,
+        // but cannot be separated from the samples of new configuration, so they will be mis-scaled
+        int untagged_samples;
+
+        /**
+         * Get reconstructed timestamp of the sample.
+         *
+         * @param i sample index in the block
+         * @return timestamp in microseconds
+         */
+        us_timestamp_t get_sample_timestamp(int i) const
+        {
+            return timestamp + (us_timestamp_t)(i * sample_period + 0.5f);
+        }
+    };
+
+    /**
+     * Cumulative sample loss statistics.
+     */
+    struct LossStatistics {
+        // number of checked FIFO drains and single sample reads
+        uint32_t reads;
+        // number of read samples
+        uint32_t samples;
+        // number of reads with lost samples (STATUS_REG_A ZYXOR or full FIFO that has been drained too late)
+        uint32_t overruns;
+        // number of FIFO drains with full FIFO (FIFO_SRC_REG_A OVRN_FIFO)
+        uint32_t full_reads;
+        // estimated number of lost samples
+        uint32_t lost_samples;
+    };
+
+    /**
+     * Read all available samples from FIFO.
+     *
+     * The data will be placed into \p data array in order: x, y, z.
+     * The values is converted into m/s^2 units.
+     *
+     * @param data samples buffer
+     * @param size maximal number of samples that can be placed into \p data
+     * @param info optional block description
+     * @return number of read samples
+     */
+    int read_fifo_data(float data[][3], int size, BlockInfo *info = nullptr);
+
+    /**
+     * Read all available raw samples from FIFO.
+     *
+     * Before the reading FIFO_SRC_REG_A is checked, so the full FIFO is detected and counted.
+     * The full FIFO doesn't mean that samples are lost, so the number of lost samples is estimated
+     * using time between FIFO drains and current output data rate.
+     *
+     * @param data samples buffer
+     * @param size maximal number of samples that can be placed into \p data
+     * @param info optional block description
+     * @return number of read samples
+     */
+    int read_fifo_data_16(int16_t data[][3], int size, BlockInfo *info = nullptr);
+
+    /**
+     * Read all available samples from FIFO in mg.
+     *
+     * It works like read_fifo_data, but the samples are converted with integer arithmetic.
+     * The calibration set by set_calibration isn't applied.
+     *
+     * @param data samples buffer
+     * @param size maximal number of samples that can be placed into \p data
+     * @param info optional block description
+     * @return number of read samples
+     */
+    int read_fifo_data_mg(int16_t data[][3], int size, BlockInfo *info = nullptr);
+
+    /**
+     * Read all available raw samples from FIFO into caller-owned buffer.
+     *
+     * The FIFO content is read directly into the \p buffer memory and is decoded in place,
+     * so there are no intermediate copies.
+     *
+     * @param buffer samples buffer
+     * @param info optional block description
+     * @return view of the read samples at the beginning of the \p buffer
+     */
+    SampleSpan<int16_t> read_fifo_block(const SampleSpan<int16_t> &buffer, BlockInfo *info = nullptr);
+
+    /**
+     * Read all available samples in m/s^2 from FIFO into caller-owned buffer.
+     *
+     * The raw samples are read into the beginning of the \p buffer memory and are converted in place.
+     *
+     * @param buffer samples buffer
+     * @param info optional block description
+     * @return view of the read samples at the beginning of the \p buffer
+     */
+    SampleSpan<float> read_fifo_block(const SampleSpan<float> &buffer, BlockInfo *info = nullptr);
+
+    /**
+     * Read all available samples in mg from FIFO into caller-owned buffer.
+     *
+     * @param buffer samples buffer
+     * @param info optional block description
+     * @return view of the read samples at the beginning of the \p buffer
+     */
+    SampleSpan<MilliUnits> read_fifo_block(const SampleSpan<MilliUnits> &buffer, BlockInfo *info = nullptr);
+
+    /**
+     * Start staged configuration.
+     *
+     * After this method invocation the setters set_power_mode, set_output_data_rate, set_full_scale,
+     * set_high_pass_filter_mode, set_fifo_mode, set_fifo_watermark, set_data_ready_interrupt_mode,
+     * set_overrun_interrupt_mode, set_high_resolution_output_mode and corresponding getters work with
+     * cached CTRL_REG1_A - CTRL_REG6_A and FIFO_CTRL_REG_A values, and don't access the bus.
+     * The changes are written by commit_config.
+     *
+     * The cached values are loaded with 2 bus transactions.
+     *
+     * @note
+     * Other methods access sensor directly, so they shouldn't be used until commit.
+     */
+    void begin_config();
+
+    /**
+     * Write staged configuration.
+     *
+     * Power mode and output data rate combination is validated once, then FIFO_CTRL_REG_A (if it's changed)
+     * and modified control registers are written with one burst write. The sensitivity and sample period
+     * are updated after the write, so get_sensitivity returns value of the active full scale until commit.
+     */
+    void commit_config();
+
+    /**
+     * Drop staged configuration.
+     */
+    void cancel_config();
+
+    /**
+     * Snapshot of the accelerometer configuration registers.
+     *
+     * The array contains values of the registers CTRL_REG1_A - TIME_WINDOW_A, indexed by (register address - CTRL_REG1_A).
+     * Values of the output, status and source registers aren't saved.
+     */
+    struct ConfigSnapshot {
+        uint8_t regs[TIME_WINDOW_A - CTRL_REG1_A + 1];
+    };
+
+    /**
+     * Save current sensor configuration.
+     *
+     * The configuration registers are read with burst reads of the contiguous register groups
+     * (6 bus transactions). Source registers aren't touched, so latched interrupts aren't cleared.
+     *
+     * @param config
+     */
+    void save_config(ConfigSnapshot *config);
+
+    /**
+     * Restore sensor configuration that is saved by save_config.
+     *
+     * The configuration registers are written with burst writes (6 bus transactions). The control registers are
+     * written last, so the sensor starts data generation with complete configuration.
+     * It's faster alternative of the init and setters invocation after sensor power down.
+     *
+     * @note
+     * Burst capture mode, output data rate governor and automatic full scale ranging are stopped.
+     *
+     * @param config
+     */
+    void restore_config(const ConfigSnapshot &config);
+
+    /**
+     * Apply compile time configuration.
+     *
+     * The register image, sensitivity and output data rate of the configuration are calculated at compile time,
+     * and illegal mode combinations are rejected by compiler. The control registers are written with one burst write.
+     * The configuration should be described by AccelerometerStaticConfig template:
+     *
+     * @code
+     * typedef AccelerometerStaticConfig<LSM303DLHCAccelerometer::NORMAL_POWER_MODE, LSM303DLHCAccelerometer::ODR_400HZ, LSM303DLHCAccelerometer::FULL_SCALE_4G> AccConfig;
+     * accelerometer.apply_static_config<AccConfig>();
+     * @endcode
+     *
+     * @note
+     * Burst capture mode, output data rate governor and automatic full scale ranging are stopped.
+     *
+     * @tparam Config configuration descriptor
+     */
+    template <class Config>
+    void apply_static_config()
+    {
+        const uint8_t ctrl_regs[CTRL_REG6_A - CTRL_REG1_A + 1] = {
+            Config::ctrl_reg1(), Config::ctrl_reg2(), Config::ctrl_reg3(),
+            Config::ctrl_reg4(), Config::ctrl_reg5(), Config::ctrl_reg6()
+        };
+        _apply_register_image(ctrl_regs, Config::fifo_ctrl_reg(), Config::output_data_rate_hz());
+    }
+
+    /**
+     * Stream configuration that can be changed by reconfigure_stream.
+     */
+    struct StreamConfig {
+        OutputDataRate odr;
+        FullScale full_scale;
+        HighResolutionOutputMode hro;
+    };
+
+    /**
+     * Get current stream configuration.
+     *
+     * @param config
+     */
+    void get_stream_config(StreamConfig *config);
+
+    /**
+     * Change output data rate, full scale and high resolution mode while FIFO streaming.
+     *
+     * Unlike separate set_output_data_rate/set_full_scale/set_high_resolution_output_mode calls,
+     * the FIFO content that has been produced with previous configuration isn't lost or mis-scaled:
+     * it's drained into \p data and \p info describes it with sensitivity of the previous configuration.
+     * The sensor is powered down before the FIFO level reading, so no sample can be produced between the reading
+     * and the control registers update, that is done with one burst write. So only samples of the previous configuration
+     * are drained. If they don't fit into \p data, the next read_fifo_data_16 call returns the rest of them as separate
+     * block with previous sensitivity. Up to two such blocks (for example, block of the automatic ranging and block
+     * of the previous configuration) are tracked, otherwise the rest of the previous configuration samples is reported
+     * by BlockInfo::untagged_samples.
+     *
+     * @note
+     * The power mode isn't changed, so \p config.odr should be valid for current power mode.
+     *
+     * @param config new configuration
+     * @param data buffer for samples of the previous configuration
+     * @param size maximal number of samples that can be placed into \p data. To prevent sample loss,
+     *             it should be at least FIFO_SIZE
+     * @param info optional description of the drained block
+     * @return number of drained samples
+     */
+    int reconfigure_stream(const StreamConfig &config, int16_t data[][3], int size, BlockInfo *info = nullptr);
+
+    /**
+     * Version of the reconfigure_stream that converts drained samples into m/s^2 units.
+     *
+     * @param config new configuration
+     * @param data buffer for samples of the previous configuration
+     * @param size maximal number of samples that can be placed into \p data
+     * @param info optional description of the drained block
+     * @return number of drained samples
+     */
+    int reconfigure_stream(const StreamConfig &config, float data[][3], int size, BlockInfo *info = nullptr);
+
+    enum AdaptiveWatermarkMode {
+        AWM_ENABLE = 1,
+        AWM_DISABLE = 0
+    };
+
+    /**
+     * Enable/disable adaptive FIFO watermark.
+     *
+     * If adaptive watermark is enabled, read_fifo_data_16 tunes watermark between 1 and 31 after each
+     * FIFO drain. The watermark is limited by:
+     *
+     * - latency target, i.e. maximal time between generation of the first sample of a block and its delivery;
+     * - FIFO headroom, that should be enough to keep samples that are generated during interrupt service
+     *   (measured using mark_watermark_interrupt) and block processing (see report_block_processing_time);
+     * - overrun history, each overrun decreases watermark additionally.
+     *
+     * So at low output data rate watermark is small to keep low latency, and at high output data rate
+     * it's large to minimize number of interrupts.
+     *
+     * @param mode
+     * @param latency_target latency target in microseconds. Zero value means maximal interrupt coalescing.
+     */
+    void set_adaptive_watermark_mode(AdaptiveWatermarkMode mode, uint32_t latency_target = 0);
+
+    /**
+     * Check if adaptive FIFO watermark is enabled/disabled.
+     *
+     * @return
+     */
+    AdaptiveWatermarkMode get_adaptive_watermark_mode();
+
+    /**
+     * Report time that consumer spends to process a block.
+     *
+     * It's used by adaptive FIFO watermark.
+     *
+     * @param processing_time time in microseconds
+     */
+    void report_block_processing_time(uint32_t processing_time);
+
+    /**
+     * Get duration of the last reconfigure_stream transition window.
+     *
+     * @return time in microseconds
+     */
+    uint32_t get_reconfiguration_time_us();
+
+    /**
+     * Register FIFO watermark interrupt edge.
+     *
+     * The method only saves current time, so it can be invoked from the INT1 rising edge ISR.
+     * The edge time is used by the next read_fifo_data_16 call to reconstruct sample timestamps
+     * and to estimate actual output data rate. Without it, the sample timestamps are based on the FIFO
+     * drain time.
+     */
+    void mark_watermark_interrupt();
+
+    /**
+     * Get output data rate in Hz that is estimated using watermark interrupt edges.
+     *
+     * Internal sensor oscillator can differ from the nominal output data rate up to several percents.
+     * If there are no estimations, the nominal value is returned.
+     *
+     * @return
+     */
+    float get_estimated_output_data_rate_hz();
+
+    /**
+     * Reset output data rate estimation.
+     */
+    void reset_output_data_rate_estimation();
+
+    /**
+     * Get cumulative sample loss statistics.
+     *
+     * @param stats
+     */
+    void get_loss_statistics(LossStatistics *stats);
+
+    /**
+     * Reset sample loss statistics.
+     */
+    void reset_loss_statistics();
+
+    /**
+     * FIFO size in samples.
+     */
+    static const int FIFO_SIZE = 32;
+
+    enum BurstCaptureState {
+        BCS_DISABLED = 0, // burst capture mode is disabled
+        BCS_IDLE = 1, // sensor works in the low power mode and waits for motion
+        BCS_CAPTURE = 2 // sensor streams data with high output data rate through FIFO
+    };
+
+    /**
+     * Burst capture mode settings.
+     */
+    struct BurstCaptureConfig {
+        // output data rate in the idle state, it should be valid for the low power mode
+        OutputDataRate idle_odr;
+        // output data rate in the capture state,
+        // if it's valid for the normal mode, the high resolution normal mode is used, otherwise low power mode
+        OutputDataRate capture_odr;
+        FullScale full_scale;
+        // FIFO watermark in the capture state
+        int watermark;
+        // wakeup threshold of the high-pass filtered acceleration in m/s^2
+        float wakeup_threshold;
+        // maximal capture duration in milliseconds, zero value disables the limit
+        uint32_t capture_duration;
+        // maximal acceleration range in m/s^2 of the quiescent samples
+        float quiescent_threshold;
+        // quiescent time in milliseconds to stop capture, zero value disables quiescence detection
+        uint32_t quiescent_duration;
+    };
+
+    /**
+     * Start burst capture mode.
+     *
+     * In this mode the accelerometer waits in the low power mode with wake-on-motion interrupt (INT1 pin)
+     * and switches to high output data rate with FIFO streaming (watermark interrupt on INT1 pin) after motion
+     * detection. When capture duration is expired or quiescence is detected the sensor returns to idle state.
+     *
+     * All register values are precomputed, so state transition takes at most 4 bus transactions.
+     *
+     * After each INT1 rising edge the method process_burst_capture should be invoked.
+     *
+     * @note
+     * Burst capture mode overrides FIFO, interrupt, power and output data rate settings.
+     *
+     * @param config
+     */
+    void start_burst_capture(const BurstCaptureConfig &config);
+
+    /**
+     * Stop burst capture mode.
+     *
+     * Sensor returns to the idle configuration (low power mode and disabled FIFO) with disabled interrupts,
+     * even if it's stopped during capture.
+     */
+    void stop_burst_capture();
+
+    /**
+     * Get current burst capture state.
+     *
+     * @return
+     */
+    BurstCaptureState get_burst_capture_state();
+
+    enum ODRGovernorMode {
+        ODRG_ENABLE = 1,
+        ODRG_DISABLE = 0
+    };
+
+    /**
+     * Output data rate governor settings.
+     */
+    struct ODRGovernorConfig {
+        // minimal output data rate, it should be valid for current power mode
+        OutputDataRate min_odr;
+        // maximal output data rate, it should be valid for current power mode
+        OutputDataRate max_odr;
+        // signal energy (sum of axis variances) in (m/s^2)^2 to increase output data rate
+        float up_threshold;
+        // signal energy (sum of axis variances) in (m/s^2)^2 to decrease output data rate,
+        // it should be less than up_threshold
+        float down_threshold;
+        // energy estimation window in milliseconds
+        uint32_t window;
+        // number of consecutive quiet windows to decrease output data rate
+        int hold_windows;
+    };
+
+    /**
+     * Start activity-driven output data rate governor.
+     *
+     * The governor estimates signal energy over FIFO blocks that are read by read_fifo_data_16 and
+     * steps output data rate up or down by one value with hysteresis. The output data rate is changed
+     * only right after complete FIFO drain, and full scale isn't changed, so the samples aren't mis-scaled
+     * and timestamps aren't reconstructed with wrong sample period. If the FIFO isn't drained completely,
+     * the estimation window is extended.
+     *
+     * @param config
+     */
+    void start_odr_governor(const ODRGovernorConfig &config);
+
+    /**
+     * Stop output data rate governor.
+     *
+     * Current output data rate isn't changed.
+     */
+    void stop_odr_governor();
+
+    /**
+     * Check if output data rate governor is enabled/disabled.
+     *
+     * @return
+     */
+    ODRGovernorMode get_odr_governor_mode();
+
+    /**
+     * Get signal energy of the last complete governor window.
+     *
+     * @return energy in (m/s^2)^2
+     */
+    float get_odr_governor_energy();
+
+    enum AutoRangeMode {
+        AR_ENABLE = 1,
+        AR_DISABLE = 0
+    };
+
+    /**
+     * Enable/disable automatic full scale ranging.
+     *
+     * If it's enabled, the blocks that are read by read_fifo_data_16 are checked for saturation.
+     * If a sample exceeds 90% of the current full scale, the full scale is increased by one step. If all samples of
+     * 4 consecutive blocks fit into 45% of the lower full scale, the full scale is decreased by one step.
+     *
+     * The samples that have been generated before full scale change are returned by separate blocks,
+     * so BlockInfo::sensitivity is always valid for all block samples.
+     *
+     * @note
+     * The mode works only with FIFO reading.
+     *
+     * @param mode
+     * @param min_fs minimal full scale
+     * @param max_fs maximal full scale
+     */
+    void set_auto_range_mode(AutoRangeMode mode, FullScale min_fs = FULL_SCALE_2G, FullScale max_fs = FULL_SCALE_16G);
+
+    /**
+     * Check if automatic full scale ranging is enabled/disabled.
+     *
+     * @return
+     */
+    AutoRangeMode get_auto_range_mode();
+
+    /**
+     * Process INT1 interrupt in the burst capture mode.
+     *
+     * In the idle state it switches sensor to the capture state.
+     * In the capture state it drains FIFO and switches sensor to the idle state if the capture is finished.
+     *
+     * @param data samples buffer
+     * @param size maximal number of samples that can be placed into \p data
+     * @param info optional block description
+     * @return number of captured samples
+     */
+    int process_burst_capture(int16_t data[][3], int size, BlockInfo *info = nullptr);
+
 private:
     I2CDevice _i2c_device;
 
@@ -342,8 +1127,279 @@ private:
     // TODO: check different mems to be sure that value of the "WHO_AM_I_ADDR" register is stable.
     static const int _DEVICE_ID = 0x33;
 
+    // current full scale, unit/lsb and mg/lsb are derived from it
+    FullScale _full_scale;
     // current unit/lsb
     float _sensitivity;
+    // current mg/lsb
+    int _sensitivity_mg;
+    // user offset in m/s^2 and mg
+    bool _offset_enabled;
+    float _offset[3];
+    int16_t _offset_mg[3];
+    // calibration
+    bool _cal_enabled;
+    Calibration _cal;
+    // mounting orientation, the matrix is identity if orientation isn't set
+    bool _orientation_enabled;
+    int8_t _orientation[3][3];
+
+    /**
+     * Set rotation matrix from sensor axes to board axes.
+     *
+     * @param matrix
+     */
+    void _set_orientation(const int8_t matrix[3][3]);
+
+    /**
+     * Update offset in mg.
+     *
+     * The mg offset is rotated to sensor axes, so it can be subtracted before rotation of the integer samples.
+     */
+    void _update_offset_mg();
+
+    /**
+     * Apply calibration, offset and orientation to the raw sample with LSB resolution.
+     *
+     * @param data raw sample in sensor axes, it's replaced by corrected sample in board axes
+     * @param sensitivity sensitivity of the sample
+     */
+    void _correct_data_16(int16_t data[3], float sensitivity);
+
+    /**
+     * Update cached full scale and sensitivity values.
+     *
+     * @param fs full scale
+     */
+    void _set_full_scale(FullScale fs);
+
+    /**
+     * Convert sensitivity into mg/LSB.
+     *
+     * @param sensitivity sensitivity in (m/s^2)/LSB
+     * @return
+     */
+    static int _sensitivity_to_mg(float sensitivity);
+    // cached FIFO state to avoid register reading during data reading
+    bool _fifo_enabled;
+
+    // cached FIFO watermark
+    int _fifo_watermark;
+
+    // sample loss accounting
+    LossStatistics _loss_stats;
+    us_timestamp_t _last_read_time;
+
+    // timestamp reconstruction and output data rate estimation
+    volatile us_timestamp_t _wtm_edge_time;
+    us_timestamp_t _prev_wtm_edge_time;
+    int _prev_block_samples;
+    // number of samples that have been left in FIFO after the previous block reading
+    int _prev_block_left_samples;
+    int _period_measurements;
+    float _nominal_sample_period;
+    float _sample_period;
+
+    // duration of the last stream reconfiguration
+    uint32_t _reconfiguration_time;
+
+    // adaptive watermark state
+    bool _awm_enabled;
+    uint32_t _awm_latency_target;
+    uint32_t _awm_service_latency;
+    uint32_t _awm_processing_time;
+    uint32_t _awm_reported_processing_time;
+    int _awm_overrun_backoff;
+    int _awm_clean_blocks;
+
+    // burst capture state and precomputed register values
+    BurstCaptureState _bc_state;
+    uint8_t _bc_idle_ctrl_regs[6];
+    uint8_t _bc_capture_ctrl_regs[6];
+    uint8_t _bc_capture_fifo_ctrl;
+    float _bc_idle_sample_period;
+    float _bc_capture_sample_period;
+    int _bc_max_samples;
+    int _bc_quiescent_samples;
+    int16_t _bc_quiescent_threshold;
+    int _bc_captured_samples;
+    int _bc_quiet_samples;
+
+    // output data rate governor state
+    bool _odrg_enabled;
+    ODRGovernorConfig _odrg_config;
+    const OutputDataRate *_odrg_ladder;
+    int _odrg_min_index;
+    int _odrg_max_index;
+    int _odrg_index;
+    int _odrg_window_samples;
+    int _odrg_quiet_windows;
+    float _odrg_energy;
+    // window accumulators of the shifted samples
+    int _odrg_samples;
+    int16_t _odrg_shift[3];
+    int32_t _odrg_sum[3];
+    int64_t _odrg_sum_sq[3];
+
+    // automatic full scale ranging state
+    bool _ar_enabled;
+    FullScale _ar_min_fs;
+    FullScale _ar_max_fs;
+    // threshold in LSB to increase/decrease full scale
+    int16_t _ar_up_threshold;
+    int16_t _ar_down_threshold;
+    int _ar_quiet_blocks;
+    // number of samples in the FIFO with previous full scale and their sensitivity
+    int _ar_pending_samples;
+    float _ar_pending_sensitivity;
+    // number of samples of the previous stream configuration that follow the pending samples
+    int _ar_next_pending_samples;
+    float _ar_next_pending_sensitivity;
+
+    /**
+     * Update automatic full scale ranging with new block.
+     *
+     * @param data block samples
+     * @param n number of samples
+     */
+    void _update_auto_range(const int16_t data[][3], int n);
+
+    /**
+     * Calculate automatic full scale ranging thresholds for current full scale.
+     *
+     * @param fs current full scale
+     */
+    void _ar_update_thresholds(FullScale fs);
+
+    /**
+     * Update output data rate governor with new block.
+     *
+     * @param data block samples
+     * @param n number of samples
+     * @param left_samples number of samples that are left in FIFO after the block reading
+     */
+    void _update_odr_governor(const int16_t data[][3], int n, int left_samples);
+
+    /**
+     * Apply output data rate of the governor ladder.
+     *
+     * @param index ladder index
+     */
+    void _odrg_apply(int index);
+
+    /**
+     * Switch burst capture state machine to idle state.
+     */
+    void _bc_enter_idle();
+
+    /**
+     * Switch burst capture state machine to capture state.
+     */
+    void _bc_enter_capture();
+
+    /**
+     * Update FIFO watermark according adaptive watermark state.
+     *
+     * @param overrun FIFO overrun flag of the last block
+     * @param service_latency time between watermark interrupt and FIFO drain
+     */
+    void _update_adaptive_watermark(bool overrun, uint32_t service_latency);
+
+    /**
+     * Update nominal sample period.
+     *
+     * @param odr_hz current output data rate
+     */
+    void _update_sample_period(float odr_hz);
+
+
+    // staged configuration: CTRL_REG1_A - CTRL_REG6_A and FIFO_CTRL_REG_A values
+    bool _staging;
+    uint8_t _staged_regs[7];
+    uint8_t _staged_dirty;
+    OutputDataRate _staged_odr;
+    bool _staged_clear_data;
+
+    /**
+     * Read configuration register taking into account staged configuration.
+     *
+     * @param reg register address
+     * @param mask mask
+     * @return masked register value
+     */
+    uint8_t _read_config_register(uint8_t reg, uint8_t mask);
+
+    /**
+     * Update configuration register taking into account staged configuration.
+     *
+     * @param reg register address
+     * @param val value to set
+     * @param mask value mask
+     */
+    void _update_config_register(uint8_t reg, uint8_t val, uint8_t mask);
+
+    /**
+     * Get index of the register in the staged configuration.
+     *
+     * @param reg register address
+     * @return
+     */
+    int _staged_index(uint8_t reg);
+
+    /**
+     * Check that output data rate is valid for power mode.
+     *
+     * @param power_mode
+     * @param odr
+     */
+    static void _validate_odr(PowerMode power_mode, OutputDataRate odr);
+
+    /**
+     * Get output data rate from CTRL_REG1_A value.
+     *
+     * @param ctrl_reg1 CTRL_REG1_A value
+     * @return
+     */
+    static OutputDataRate _decode_odr(uint8_t ctrl_reg1);
+
+
+    /**
+     * Convert raw samples that are placed at the beginning of the \p data buffer in place.
+     *
+     * @param data buffer with raw samples
+     * @param n number of samples
+     * @param sensitivity
+     */
+    void _convert_block(float data[][3], int n, float sensitivity);
+
+    /**
+     * Write CTRL_REG1_A - CTRL_REG6_A and FIFO_CTRL_REG_A registers and update cached values.
+     *
+     * @param ctrl_regs CTRL_REG1_A - CTRL_REG6_A values
+     * @param fifo_ctrl FIFO_CTRL_REG_A value
+     * @param odr_hz output data rate of the register configuration
+     */
+    void _apply_register_image(const uint8_t ctrl_regs[], uint8_t fifo_ctrl, float odr_hz);
+
+    /**
+     * Reconstruct block timestamps and update output data rate estimation.
+     *
+     * @param info block description with filled samples and overrun fields
+     * @param drain_time time when FIFO_SRC_REG_A was read
+     * @param left_samples number of samples that are left in FIFO after the block reading
+     * @return time of the watermark interrupt edge or zero if it isn't registered
+     */
+    us_timestamp_t _process_block_timestamps(BlockInfo *info, us_timestamp_t drain_time, int left_samples);
+
+    /**
+     * Update loss statistics and estimate number of lost samples.
+     *
+     * @param samples number of read samples
+     * @param capacity number of samples that sensor can keep (FIFO size or 1)
+     * @param overrun overrun flag
+     * @return estimated number of lost samples
+     */
+    int _account_read(int samples, int capacity, bool overrun);
 
     /**
      * Reboot memory content.
@@ -0,0 +1,112 @@
+#ifndef LSM303DLHC_AXIS_ORIENTATION_H
+#define LSM303DLHC_AXIS_ORIENTATION_H
+
+#include "mbed.h"
+
+namespace lsm303dlhc {
+
+/**
+ * Sensor axis with direction.
+ */
+enum Axis {
+    AXIS_PX = 1, // +X
+    AXIS_PY = 2, // +Y
+    AXIS_PZ = 3, // +Z
+    AXIS_NX = -1, // -X
+    AXIS_NY = -2, // -Y
+    AXIS_NZ = -3 // -Z
+};
+
+/**
+ * Get index of the axis.
+ *
+ * @param axis
+ * @return 0 for X, 1 for Y, 2 for Z
+ */
+constexpr int axis_index(Axis axis)
+{
+    return (axis < 0 ? -axis : axis) - 1;
+}
+
+/**
+ * Get direction of the axis.
+ *
+ * @param axis
+ * @return 1 or -1
+ */
+constexpr int axis_sign(Axis axis)
+{
+    return axis < 0 ? -1 : 1;
+}
+
+/**
+ * Compile time mounting orientation.
+ *
+ * The template parameters are sensor axes that correspond to the board X, Y and Z axes.
+ * Only 24 axis-aligned rotations are allowed, so reflections and repeated axes cause compilation error.
+ * For example, the sensor that is rotated by 90 degrees around Z axis:
+ *
+ * @code
+ * typedef AxisOrientation<AXIS_PY, AXIS_NX, AXIS_PZ> BoardOrientation;
+ * accelerometer.set_orientation<BoardOrientation>();
+ * magnetometer.set_orientation<BoardOrientation>();
+ * @endcode
+ *
+ * The drivers apply the rotation after calibration, so the calibration remains in sensor axes.
+ * The rotation matrix is fused into conversion matrix of the float outputs, so it doesn't require additional pass.
+ * Arbitrary mounting rotation can be described by matrix of the calibration or convert_raw_block_affine function.
+ *
+ * @tparam X sensor axis of the board X axis
+ * @tparam Y sensor axis of the board Y axis
+ * @tparam Z sensor axis of the board Z axis
+ */
+template <Axis X, Axis Y, Axis Z>
+struct AxisOrientation {
+    static_assert(axis_index(X) != axis_index(Y) && axis_index(X) != axis_index(Z) && axis_index(Y) != axis_index(Z), "Axes should be different");
+    // cyclic shifts of (X, Y, Z) are even permutations, so the rotation has even permutation with even number of
+    // negative axes or odd permutation with odd number of negative axes
+    static_assert(((axis_index(Y) - axis_index(X) + 3) % 3 == 1 ? 1 : -1) * axis_sign(X) * axis_sign(Y) * axis_sign(Z) == 1,
+        "Orientation should be rotation, not reflection");
+
+    /**
+     * Get sensor axis index of the board axis.
+     *
+     * @param i board axis index
+     * @return
+     */
+    static constexpr int source(int i)
+    {
+        return axis_index(i == 0 ? X : i == 1 ? Y : Z);
+    }
+
+    /**
+     * Get sign of the board axis relatively to the sensor axis.
+     *
+     * @param i board axis index
+     * @return 1 or -1
+     */
+    static constexpr int sign(int i)
+    {
+        return axis_sign(i == 0 ? X : i == 1 ? Y : Z);
+    }
+
+    /**
+     * Get element of the rotation matrix from sensor axes to board axes.
+     *
+     * @param i board axis index
+     * @param j sensor axis index
+     * @return
+     */
+    static constexpr int matrix(int i, int j)
+    {
+        return source(i) == j ? sign(i) : 0;
+    }
+};
+
+/**
+ * Sensor orientation that matches board orientation.
+ */
+typedef AxisOrientation<AXIS_PX, AXIS_PY, AXIS_PZ> IdentityOrientation;
+}
+
+#endif // LSM303DLHC_AXIS_ORIENTATION_H
@@ -0,0 +1,76 @@
+#ifndef LSM303DLHC_CONVERSION_H
+#define LSM303DLHC_CONVERSION_H
+
+#include "mbed.h"
+
+namespace lsm303dlhc {
+
+/**
+ * Convert block of raw samples into physical units with per-axis sensitivity and offset.
+ *
+ * \f$data_i = raw_i s_i - o_i\f$
+ *
+ * The conversion is done in one pass. If compiler supports GCC vector extensions, 4 samples are processed
+ * per iteration, otherwise a scalar loop is used.
+ *
+ * The \p data buffer can overlap \p raw buffer if they start at the same address,
+ * so FIFO blocks can be converted in place.
+ *
+ * @param raw raw samples (x, y, z)
+ * @param data output samples (x, y, z)
+ * @param n number of samples
+ * @param sensitivity per-axis sensitivity
+ * @param offset optional per-axis offset
+ */
+void convert_raw_block(const int16_t raw[][3], float data[][3], int n, const float sensitivity[3], const float offset[3] = nullptr);
+
+/**
+ * Convert block of raw samples into physical units with affine transformation.
+ *
+ * \f$data = A raw - b\f$
+ *
+ * The matrix \p matrix should include sensitivity, so sensitivity, calibration and compensation
+ * are fused into one pass.
+ *
+ * The \p data buffer can overlap \p raw buffer if they start at the same address.
+ *
+ * @param raw raw samples (x, y, z)
+ * @param data output samples (x, y, z)
+ * @param n number of samples
+ * @param matrix transformation matrix
+ * @param offset offset
+ */
+void convert_raw_block_affine(const int16_t raw[][3], float data[][3], int n, const float matrix[3][3], const float offset[3]);
+
+/**
+ * Convert block of raw samples into integer units with per-axis Q16 scale and offset.
+ *
+ * \f$data_i = round(raw_i scale_i / 2^{16}) - o_i\f$
+ *
+ * The conversion uses only integer multiplication and shifts, so it's suitable for targets without FPU.
+ * The \p raw and \p data buffers can be the same.
+ *
+ * @param raw raw samples (x, y, z)
+ * @param data output samples (x, y, z)
+ * @param n number of samples
+ * @param scale per-axis scale in Q16 format (output units per LSB multiplied by 2^16)
+ * @param offset optional per-axis offset in output units
+ */
+void convert_raw_block_fixed(const int16_t raw[][3], int16_t data[][3], int n, const int32_t scale[3], const int16_t offset[3] = nullptr);
+
+/**
+ * Rotate block of integer samples in place with axis-aligned rotation matrix.
+ *
+ * \f$data = R data\f$
+ *
+ * The matrix elements should be -1, 0 or 1 with one nonzero element per row (see AxisOrientation::matrix),
+ * so the rotation only permutes axes and changes signs.
+ *
+ * @param data samples (x, y, z)
+ * @param n number of samples
+ * @param matrix rotation matrix
+ */
+void rotate_block(int16_t data[][3], int n, const int8_t matrix[3][3]);
+}
+
+#endif // LSM303DLHC_CONVERSION_H
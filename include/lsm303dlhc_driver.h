@@ -1,10 +1,37 @@
 #ifndef LSM303DLHC_DRIVER_H
 #define LSM303DLHC_DRIVER_H
 
+#include "lsm303dlhc_accelerometer_calibrator.h"
 #include "lsm303dlhc_accelerometer_driver.h"
+#include "lsm303dlhc_conversion.h"
+#include "lsm303dlhc_magnetometer_calibrator.h"
 #include "lsm303dlhc_magnetometer_driver.h"
+#include "lsm303dlhc_static_config.h"
+#include "lsm303dlhc_thermal_compensator.h"
 
 using lsm303dlhc::LSM303DLHCAccelerometer;
 using lsm303dlhc::LSM303DLHCMagnetometer;
+using lsm303dlhc::AccelerometerStaticConfig;
+using lsm303dlhc::MagnetometerStaticConfig;
+using lsm303dlhc::AccelerometerCalibrator;
+using lsm303dlhc::MagnetometerCalibrator;
+using lsm303dlhc::MagnetometerTemperatureCalibrator;
+using lsm303dlhc::AccelerometerThermalCompensator;
+using lsm303dlhc::convert_raw_block;
+using lsm303dlhc::convert_raw_block_affine;
+using lsm303dlhc::convert_raw_block_fixed;
+using lsm303dlhc::rotate_block;
+using lsm303dlhc::MilliUnits;
+using lsm303dlhc::SampleTraits;
+using lsm303dlhc::SampleSpan;
+using lsm303dlhc::AxisOrientation;
+using lsm303dlhc::IdentityOrientation;
+using lsm303dlhc::Axis;
+using lsm303dlhc::AXIS_PX;
+using lsm303dlhc::AXIS_PY;
+using lsm303dlhc::AXIS_PZ;
+using lsm303dlhc::AXIS_NX;
+using lsm303dlhc::AXIS_NY;
+using lsm303dlhc::AXIS_NZ;
 
 #endif // LSM303DLHC_DRIVER_H
@@ -0,0 +1,179 @@
+#ifndef LSM303DLHC_MAGNETOMETER_CALIBRATOR_H
+#define LSM303DLHC_MAGNETOMETER_CALIBRATOR_H
+
+#include "lsm303dlhc_magnetometer_driver.h"
+#include "mbed.h"
+
+namespace lsm303dlhc {
+
+/**
+ * Streaming hard/soft-iron magnetometer calibrator.
+ *
+ * The calibrator fits ellipsoid \f$a x^2 + b y^2 + c z^2 + 2 d x y + 2 e x z + 2 f y z + 2 g x + 2 h y + 2 i z = 1\f$
+ * to the samples with least squares method. Only normal equations are accumulated,
+ * so memory usage doesn't depend on number of samples.
+ *
+ * Usage:
+ * 1. add samples with add_sample, while device is rotated in all directions;
+ * 2. check that get_coverage is close to 1;
+ * 3. invoke compute to get calibration and fit error;
+ * 4. pass calibration to LSM303DLHCMagnetometer::set_calibration.
+ */
+class MagnetometerCalibrator : NonCopyable<MagnetometerCalibrator> {
+public:
+    MagnetometerCalibrator();
+
+    virtual ~MagnetometerCalibrator();
+
+    /**
+     * Remove all accumulated samples.
+     */
+    void reset();
+
+    /**
+     * Add sample in gauss.
+     *
+     * @param data sample (x, y, z)
+     */
+    void add_sample(const float data[3]);
+
+    /**
+     * Add raw sample.
+     *
+     * @param data raw sample (x, y, z)
+     * @param sensitivity sensitivity of the sample axes (x, y, z)
+     */
+    void add_sample_16(const int16_t data[3], const float sensitivity[3]);
+
+    /**
+     * Get number of accumulated samples.
+     *
+     * @return
+     */
+    int get_samples();
+
+    /**
+     * Get part of the directions that are covered by samples.
+     *
+     * The sphere is divided into 24 sectors by octant and dominant axis of the sample relatively to the
+     * approximate ellipsoid center (bounding box center of all samples). The sectors are evaluated for
+     * evenly decimated subset of the samples (at most 128 samples) against the final center, so the result
+     * doesn't depend on sample order.
+     *
+     * @return value in range [0, 1]
+     */
+    float get_coverage();
+
+    /**
+     * Calculate calibration.
+     *
+     * The soft-iron matrix is symmetric and preserves average field magnitude.
+     *
+     * @param cal calibration
+     * @param fit_error optional RMS of the normalized algebraic residual (zero for perfect ellipsoid)
+     * @return 0 on success, otherwise non-zero error code (not enough samples or samples don't form ellipsoid)
+     */
+    int compute(LSM303DLHCMagnetometer::Calibration *cal, float *fit_error = nullptr);
+
+    /**
+     * Minimal number of samples that is required for calculation.
+     */
+    static const int MIN_SAMPLES = 9;
+
+private:
+    static const int _N_PARAMS = 9;
+    static const int _N_SECTORS = 24;
+    static const int _N_COVERAGE_SAMPLES = 128;
+
+    int _samples;
+    // upper triangle of the D^T D matrix
+    float _dtd[_N_PARAMS * (_N_PARAMS + 1) / 2];
+    // D^T 1 vector
+    float _dt1[_N_PARAMS];
+    // bounding box to estimate ellipsoid center for coverage
+    float _min[3];
+    float _max[3];
+    // every _coverage_stride-th sample for coverage estimation
+    float _coverage_data[_N_COVERAGE_SAMPLES][3];
+    int _coverage_count;
+    int _coverage_stride;
+
+    /**
+     * Get index of the D^T D element.
+     *
+     * @param i
+     * @param j
+     * @return
+     */
+    static int _dtd_index(int i, int j);
+};
+
+/**
+ * Magnetometer temperature compensation calibrator.
+ *
+ * The calibrator learns LSM303DLHCMagnetometer::TemperatureCompensation coefficients from samples of the
+ * stationary device at different temperatures with linear regression. As the field magnitude doesn't depend
+ * on temperature, the magnitude drift is treated as gain drift and the rest per-axis drift as offset drift.
+ *
+ * The samples should be read without temperature compensation. Offset drift along the field direction
+ * cannot be distinguished from gain drift in one orientation, so it's better to collect samples in several
+ * orientations that don't correlate with temperature.
+ */
+class MagnetometerTemperatureCalibrator : NonCopyable<MagnetometerTemperatureCalibrator> {
+public:
+    MagnetometerTemperatureCalibrator();
+
+    virtual ~MagnetometerTemperatureCalibrator();
+
+    /**
+     * Remove all accumulated samples.
+     */
+    void reset();
+
+    /**
+     * Add sample.
+     *
+     * @param data sample in gauss (x, y, z)
+     * @param temperature temperature in celsius
+     */
+    void add_sample(const float data[3], float temperature);
+
+    /**
+     * Get number of accumulated samples.
+     *
+     * @return
+     */
+    int get_samples();
+
+    /**
+     * Get temperature range of the accumulated samples.
+     *
+     * @return
+     */
+    float get_temperature_range();
+
+    /**
+     * Calculate compensation coefficients.
+     *
+     * The mean temperature of the samples is used as reference temperature.
+     *
+     * @param tc
+     * @param min_temperature_range minimal temperature range of the samples in celsius
+     * @return 0 on success, otherwise non-zero error code
+     */
+    int compute(LSM303DLHCMagnetometer::TemperatureCompensation *tc, float min_temperature_range = 5.0f);
+
+private:
+    int _samples;
+    float _t_min;
+    float _t_max;
+    // sums of temperatures, squared temperatures, samples, samples multiplied by temperature;
+    // the fourth sample component is field magnitude
+    float _sum_t;
+    float _sum_t2;
+    float _sum_m[4];
+    float _sum_tm[4];
+};
+}
+
+#endif // LSM303DLHC_MAGNETOMETER_CALIBRATOR_H
@@ -1,6 +1,9 @@
 #ifndef LSM303DLHC_MAGNETOMETER_DRIVER_H
 #define LSM303DLHC_MAGNETOMETER_DRIVER_H
 
+#include "lsm303dlhc_axis_orientation.h"
+#include "lsm303dlhc_sample_span.h"
+#include "lsm303dlhc_sample_traits.h"
 #include "lsm303dlhc_utils.h"
 #include "mbed.h"
 
@@ -167,6 +170,36 @@ public:
      */
     float get_output_data_rate_hz();
 
+    /**
+     * Get output data rate in HZ.
+     *
+     * @param odr
+     * @return
+     */
+    static constexpr float get_output_data_rate_hz(OutputDataRate odr)
+    {
+        switch (odr) {
+        case ODR_0_75_HZ:
+            return 0.75f;
+        case ODR_1_5_HZ:
+            return 1.5f;
+        case ODR_3_0_HZ:
+            return 3.0f;
+        case ODR_7_5_HZ:
+            return 7.5f;
+        case ODR_15_HZ:
+            return 15.0f;
+        case ODR_30_HZ:
+            return 30.0f;
+        case ODR_75_HZ:
+            return 75.0f;
+        case ODR_220_HZ:
+            return 220.0f;
+        default:
+            return 0.0f;
+        }
+    }
+
     enum MagnetometerMode {
         M_DISABLE = 0,
         M_ENABLE = 1
@@ -221,6 +254,62 @@ public:
      */
     float get_sensitivity(int axis_no);
 
+    /**
+     * Get X and Y axes sensitivity in gauss/LSB of the full scale mode.
+     *
+     * @param fs
+     * @return
+     */
+    static constexpr float get_full_scale_xy_sensitivity(FullScale fs)
+    {
+        switch (fs) {
+        case FULL_SCALE_1_3_G:
+            return 1.0f / 1100.0f;
+        case FULL_SCALE_1_9_G:
+            return 1.0f / 885.0f;
+        case FULL_SCALE_2_5_G:
+            return 1.0f / 670.0f;
+        case FULL_SCALE_4_0_G:
+            return 1.0f / 450.0f;
+        case FULL_SCALE_4_7_GA:
+            return 1.0f / 400.0f;
+        case FULL_SCALE_5_6_G:
+            return 1.0f / 330.0f;
+        case FULL_SCALE_8_1_G:
+            return 1.0f / 230.0f;
+        default:
+            return 0.0f;
+        }
+    }
+
+    /**
+     * Get Z axis sensitivity in gauss/LSB of the full scale mode.
+     *
+     * @param fs
+     * @return
+     */
+    static constexpr float get_full_scale_z_sensitivity(FullScale fs)
+    {
+        switch (fs) {
+        case FULL_SCALE_1_3_G:
+            return 1.0f / 980.0f;
+        case FULL_SCALE_1_9_G:
+            return 1.0f / 760.0f;
+        case FULL_SCALE_2_5_G:
+            return 1.0f / 600.0f;
+        case FULL_SCALE_4_0_G:
+            return 1.0f / 400.0f;
+        case FULL_SCALE_4_7_GA:
+            return 1.0f / 355.0f;
+        case FULL_SCALE_5_6_G:
+            return 1.0f / 295.0f;
+        case FULL_SCALE_8_1_G:
+            return 1.0f / 205.0f;
+        default:
+            return 0.0f;
+        }
+    }
+
     /**
      * Read current accelerometer data.
      *
@@ -228,10 +317,7 @@ public:
      * The values is converted into gauss units.
      *
      * @note
-     * The data can have offset.
-     *
-     * @todo
-     * Add possibility to add user offset for a calibration.
+     * The data can have offset, if calibration isn't set by set_calibration.
      *
      * @param data
      */
@@ -243,11 +329,604 @@ public:
      * The data will be placed into \p data array in order: x, y, z.
      * The values represent signed integers. To get gauss units, the values should be multiply
      * by the value that is returned by method LSM303DHLCMagnetometer::get_sensitivity.
+     * The values are in sensor axes, as the orientation set by set_orientation isn't applied.
      *
      * @param data
      */
     void read_data_16(int16_t data[3]);
 
+    /**
+     * Read raw magnetometer data with sensitivity of the sample.
+     *
+     * The sensitivity can differ from the get_sensitivity result if full scale has been changed by
+     * automatic ranging, but sensor hasn't finished conversion with new full scale yet.
+     *
+     * @param data sample (x, y, z)
+     * @param sensitivity sensitivity of the sample axes (x, y, z)
+     */
+    void read_data_16(int16_t data[3], float sensitivity[3]);
+
+    /**
+     * SR_REG_M flags.
+     */
+    enum StatusFlags {
+        STATUS_DRDY = 0x01, // new set of measurements is available
+        STATUS_LOCK = 0x02 // data output registers are locked
+    };
+
+    /**
+     * Read magnetometer data together with status register in one bus transaction.
+     *
+     * The values is converted into gauss units.
+     *
+     * @param data sample (x, y, z)
+     * @param status optional StatusFlags of the sample
+     * @return 1 if new data is available, 0 if sample is the same as previous one
+     */
+    int read_new_data(float data[3], uint8_t *status = nullptr);
+
+    /**
+     * Read raw magnetometer data together with status register in one bus transaction.
+     *
+     * @param data sample (x, y, z)
+     * @param status optional StatusFlags of the sample
+     * @return 1 if new data is available, 0 if sample is the same as previous one
+     */
+    int read_new_data_16(int16_t data[3], uint8_t *status = nullptr);
+
+    /**
+     * Read magnetometer data in milligauss.
+     *
+     * The conversion uses only integer arithmetic, so it's suitable for targets without FPU.
+     * The values are rounded to the nearest milligauss with error less than 1 mG.
+     * The orientation set by set_orientation is applied.
+     *
+     * @note temperature compensation and calibration aren't applied
+     *
+     * @param data sample (x, y, z)
+     */
+    void read_data_mg(int16_t data[3]);
+
+    /**
+     * Read magnetometer data in milligauss together with status register in one bus transaction.
+     *
+     * The orientation set by set_orientation is applied.
+     *
+     * @note temperature compensation and calibration aren't applied
+     *
+     * @param data sample (x, y, z)
+     * @param status optional StatusFlags of the sample
+     * @return 1 if new data is available, 0 if sample is the same as previous one
+     */
+    int read_new_data_mg(int16_t data[3], uint8_t *status = nullptr);
+
+    /**
+     * Read magnetometer data as sample type \p T.
+     *
+     * The sample is converted by SampleTraits<T>, so it can be raw value (int16_t), gauss (float),
+     * milligauss (MilliUnits) or user type.
+     *
+     * The temperature compensation, calibration and orientation are applied as by read_data, but the result
+     * is rounded to LSB before conversion. They are skipped, if they aren't set, so the sample is converted directly.
+     *
+     * @tparam T sample type
+     * @param data sample (x, y, z)
+     */
+    template <typename T>
+    void read_data_as(T data[3])
+    {
+        int16_t data_16[3];
+        float sensitivity[3];
+        int32_t mg_scale[3];
+        _read_frame(data_16, sensitivity, false, mg_scale);
+        _correct_data_16(data_16, sensitivity);
+        for (int i = 0; i < 3; i++) {
+            // the axes can be swapped by orientation, so the sensitivity of the source axis is used
+            const int j = _orientation_source(i);
+            data[i] = SampleTraits<T>::convert(data_16[i], sensitivity[j], mg_scale[j]);
+        }
+    }
+
+    /**
+     * Read magnetometer data as sample type \p T with compile time full scale.
+     *
+     * The sensitivity is folded into constants, so the conversion doesn't use cached sensitivity.
+     * The sensor should be configured with full scale \p FS and automatic ranging should be disabled.
+     *
+     * @code
+     * float data[3];
+     * magnetometer.read_data_as<float, LSM303DLHCMagnetometer::FULL_SCALE_1_3_G>(data);
+     * @endcode
+     *
+     * The temperature compensation, calibration and orientation are applied as by read_data_as<T>.
+     *
+     * @tparam T sample type
+     * @tparam FS full scale
+     * @param data sample (x, y, z)
+     */
+    template <typename T, FullScale FS>
+    void read_data_as(T data[3])
+    {
+        static_assert(get_full_scale_xy_sensitivity(FS) > 0, "Invalid full scale");
+        constexpr float xy_sensitivity = get_full_scale_xy_sensitivity(FS);
+        constexpr float z_sensitivity = get_full_scale_z_sensitivity(FS);
+        constexpr int32_t xy_mg_scale = _sensitivity_to_mg_scale(xy_sensitivity);
+        constexpr int32_t z_mg_scale = _sensitivity_to_mg_scale(z_sensitivity);
+        MBED_ASSERT(!_ar_enabled && _xy_mag_sensitivity == xy_sensitivity);
+
+        int16_t data_16[3];
+        float sensitivity[3];
+        _read_frame(data_16, sensitivity, false);
+        _correct_data_16(data_16, sensitivity);
+        for (int i = 0; i < 3; i++) {
+            if (_orientation_source(i) == 2) {
+                data[i] = SampleTraits<T>::convert(data_16[i], z_sensitivity, z_mg_scale);
+            } else {
+                data[i] = SampleTraits<T>::convert(data_16[i], xy_sensitivity, xy_mg_scale);
+            }
+        }
+    }
+
+    /**
+     * Convert block of raw samples with current sensitivity into milligauss with integer arithmetic.
+     *
+     * The \p data_16 and \p data buffers can be the same. The orientation set by set_orientation is applied.
+     *
+     * @note temperature compensation and calibration aren't applied
+     *
+     * @param data_16 raw samples (x, y, z)
+     * @param data output samples in milligauss (x, y, z)
+     * @param n number of samples
+     */
+    void convert_block_mg(const int16_t data_16[][3], int16_t data[][3], int n);
+
+    enum AutoRangeMode {
+        AR_ENABLE = 1,
+        AR_DISABLE = 0
+    };
+
+    /**
+     * Enable/disable automatic full scale ranging.
+     *
+     * If it's enabled, the samples that are read by read_data_16 are checked for overflow.
+     * If any axis has overflow value (-4096) or exceeds 90% of the current full scale, the full scale is increased
+     * by one step. If all axes of 16 consecutive samples fit into 45% of the lower full scale,
+     * the full scale is decreased by one step.
+     *
+     * @note
+     * The axes with overflow are reported with raw value -4096.
+     *
+     * @param mode
+     * @param min_fs minimal full scale
+     * @param max_fs maximal full scale
+     */
+    void set_auto_range_mode(AutoRangeMode mode, FullScale min_fs = FULL_SCALE_1_3_G, FullScale max_fs = FULL_SCALE_8_1_G);
+
+    /**
+     * Check if automatic full scale ranging is enabled/disabled.
+     *
+     * @return
+     */
+    AutoRangeMode get_auto_range_mode();
+
+    /**
+     * Hard-iron and soft-iron calibration.
+     *
+     * The calibrated value is calculated as: \f$m_{cal} = W (m - o)\f$, where \f$o\f$ is offset in gauss and
+     * \f$W\f$ is soft-iron matrix.
+     */
+    struct Calibration {
+        float offset[3];
+        float matrix[3][3];
+    };
+
+    /**
+     * Set calibration that is applied by read_data, read_new_data, read_data_as, convert_sample and convert_block methods.
+     *
+     * @param cal calibration or @c nullptr to disable calibration
+     */
+    void set_calibration(const Calibration *cal);
+
+    /**
+     * Get current calibration.
+     *
+     * @param cal
+     * @return @c true if calibration is set, otherwise @c false
+     */
+    bool get_calibration(Calibration *cal);
+
+    /**
+     * Set mounting orientation that is applied by read_data, read_new_data, read_data_mg, read_new_data_mg,
+     * read_data_as, convert_sample, convert_block and convert_block_mg methods.
+     *
+     * The orientation is applied after temperature compensation and calibration, so they remain
+     * in sensor axes and MagnetometerCalibrator results don't depend on it. The raw data of read_data_16,
+     * read_new_data_16 and data ready samples is kept in sensor axes.
+     *
+     * @code
+     * magnetometer.set_orientation<AxisOrientation<AXIS_PY, AXIS_NX, AXIS_PZ>>();
+     * @endcode
+     *
+     * @tparam Orientation mounting orientation (see AxisOrientation)
+     */
+    template <class Orientation>
+    void set_orientation()
+    {
+        const int8_t matrix[3][3] = {
+            { Orientation::matrix(0, 0), Orientation::matrix(0, 1), Orientation::matrix(0, 2) },
+            { Orientation::matrix(1, 0), Orientation::matrix(1, 1), Orientation::matrix(1, 2) },
+            { Orientation::matrix(2, 0), Orientation::matrix(2, 1), Orientation::matrix(2, 2) }
+        };
+        _set_orientation(matrix);
+    }
+
+    /**
+     * Temperature compensation coefficients.
+     *
+     * The compensated value is calculated as: \f$m_{comp} = \frac{m - k_o \Delta T}{1 + k_g \Delta T}\f$,
+     * where \f$\Delta T\f$ is difference between current and reference temperature.
+     * The compensation is applied before calibration.
+     */
+    struct TemperatureCompensation {
+        // reference temperature in celsius
+        float reference_temperature;
+        // offset drift in gauss/celsius (x, y, z)
+        float offset_coefficients[3];
+        // relative gain drift in 1/celsius (x, y, z)
+        float gain_coefficients[3];
+    };
+
+    /**
+     * Set temperature compensation that is applied by read_data, read_new_data and convert_sample methods.
+     *
+     * The temperature is read with period \p update_period and cached, so the most samples
+     * don't require additional bus transactions. The temperature sensor should be enabled.
+     *
+     * @param tc compensation coefficients or @c nullptr to disable compensation
+     * @param update_period temperature update period in milliseconds
+     */
+    void set_temperature_compensation(const TemperatureCompensation *tc, uint32_t update_period = 1000);
+
+    /**
+     * Get current temperature compensation.
+     *
+     * @param tc
+     * @return @c true if compensation is set, otherwise @c false
+     */
+    bool get_temperature_compensation(TemperatureCompensation *tc);
+
+    /**
+     * Get temperature update period of the compensation.
+     *
+     * @return period in milliseconds
+     */
+    uint32_t get_temperature_compensation_update_period();
+
+    /**
+     * Get cached temperature that is used for compensation.
+     *
+     * @return temperature in celsius
+     */
+    float get_compensation_temperature();
+
+    /**
+     * Sample of the interrupt driven acquisition.
+     */
+    struct Sample {
+        // raw data (x, y, z)
+        int16_t data[3];
+        // sensitivity of the sample axes (x, y, z)
+        float sensitivity[3];
+        // time of the DRDY rising edge
+        us_timestamp_t timestamp;
+    };
+
+    typedef Callback<void(const Sample &sample)> SampleCallback;
+
+    /**
+     * Convert raw sample into gauss with current calibration.
+     *
+     * @param sample raw sample
+     * @param data calibrated value (x, y, z)
+     */
+    void convert_sample(const Sample &sample, float data[3]);
+
+    /**
+     * Convert block of raw samples with current sensitivity into gauss.
+     *
+     * Sensitivity, temperature compensation, calibration and orientation are fused into one affine transformation,
+     * so the block is converted in one pass. The \p data buffer can overlap \p data_16 buffer
+     * if they start at the same address.
+     *
+     * @param data_16 raw samples (x, y, z)
+     * @param data output samples in gauss (x, y, z)
+     * @param n number of samples
+     */
+    void convert_block(const int16_t data_16[][3], float data[][3], int n);
+
+    /**
+     * Convert block of raw samples with current sensitivity into gauss.
+     *
+     * It works like convert_block with arrays. The \p data view can use the same memory as \p data_16 view.
+     *
+     * @param data_16 raw samples
+     * @param data output buffer
+     * @return view of the converted samples at the beginning of the \p data
+     */
+    SampleSpan<float> convert_block(const SampleSpan<int16_t> &data_16, const SampleSpan<float> &data);
+
+    /**
+     * Start DRDY interrupt driven acquisition.
+     *
+     * The DRDY rising edge timestamp is saved in the interrupt context, then sample is read
+     * with one bus transaction in the \p queue context and is passed to \p sample_cb.
+     * If DRDY is already high at start, the pending sample is read and discarded, as its timestamp is unknown.
+     * The hang watchdog check and the start reading are scheduled in the \p queue, so MBED_ERROR_OUT_OF_MEMORY error
+     * is raised if the queue is full.
+     *
+     * @param drdy_pin DRDY pin
+     * @param queue event queue to read data, as I2C cannot be used in the interrupt context
+     * @param sample_cb sample callback
+     */
+    void start_drdy_acquisition(InterruptIn *drdy_pin, EventQueue *queue, SampleCallback sample_cb);
+
+    /**
+     * Start DRDY interrupt driven acquisition into user buffer.
+     *
+     * It works like start_drdy_acquisition with callback, but samples are saved into \p buffer.
+     * The acquisition is stopped when buffer is full.
+     *
+     * @param drdy_pin DRDY pin
+     * @param queue event queue to read data, as I2C cannot be used in the interrupt context
+     * @param buffer samples buffer
+     * @param size buffer size
+     * @param complete_cb optional callback that is invoked with number of samples when buffer is full
+     */
+    void start_drdy_acquisition(InterruptIn *drdy_pin, EventQueue *queue, Sample buffer[], int size, Callback<void(int)> complete_cb = nullptr);
+
+    /**
+     * Stop DRDY interrupt driven acquisition.
+     *
+     * @return number of samples that have been saved into buffer
+     */
+    int stop_drdy_acquisition();
+
+    /**
+     * Get number of DRDY edges that have been skipped, as previous sample hasn't been processed.
+     *
+     * @return
+     */
+    uint32_t get_drdy_missed_samples();
+
+    /**
+     * Set minimal period between single conversions.
+     *
+     * If read_single_conversion is invoked earlier, the previous sample is returned without bus access.
+     *
+     * @param min_period minimal period in milliseconds, zero value disables limit
+     */
+    void set_single_conversion_min_period(uint32_t min_period);
+
+    /**
+     * Perform single conversion.
+     *
+     * The method clears stale data with dummy read, triggers single conversion (MR_REG_M = 0x01),
+     * waits its completion (DRDY bit of the SR_REG_M) and reads data. After conversion magnetometer stays in the idle mode, so it consumes minimal power
+     * between conversions.
+     *
+     * @note
+     * Continuous mode is stopped by this method.
+     *
+     * @param sample sample with conversion completion time as timestamp
+     * @return 1 if new sample is read, 0 if previous sample is returned due rate limit,
+     *         or negative error code if conversion isn't completed in time.
+     */
+    int read_single_conversion(Sample *sample);
+
+    /**
+     * Start periodic single conversions using event queue.
+     *
+     * Unlike read_single_conversion, the queue thread isn't blocked during conversion:
+     * the completion is polled by separate events.
+     *
+     * @param queue event queue
+     * @param period conversion period in milliseconds
+     * @param sample_cb sample callback
+     */
+    void start_single_conversion_schedule(EventQueue *queue, uint32_t period, SampleCallback sample_cb);
+
+    /**
+     * Stop periodic single conversions.
+     */
+    void stop_single_conversion_schedule();
+
+    /**
+     * Duty cycle mode configuration.
+     */
+    struct DutyCycleConfig {
+        // period between measurement windows in milliseconds
+        uint32_t period;
+        // number of averaged conversions in the measurement window
+        int conversions;
+    };
+
+    /**
+     * Estimated characteristics of the duty cycle mode.
+     */
+    struct DutyCycleEstimation {
+        // part of time when magnetometer performs conversions
+        float duty_cycle;
+        // average magnetometer current in uA
+        float current;
+        // RMS noise of the averaged X and Y axes in gauss
+        float xy_noise;
+        // RMS noise of the averaged Z axis in gauss
+        float z_noise;
+    };
+
+    /**
+     * Set duty cycle mode configuration.
+     *
+     * @param config
+     */
+    void set_duty_cycle_config(const DutyCycleConfig &config);
+
+    /**
+     * Get duty cycle mode configuration.
+     *
+     * @param config
+     */
+    void get_duty_cycle_config(DutyCycleConfig *config);
+
+    /**
+     * Perform duty cycle measurement window.
+     *
+     * The method wakes magnetometer in the continuous mode with current output data rate, discards the first
+     * sample after wake up, averages DutyCycleConfig::conversions samples and puts magnetometer into sleep mode
+     * (MR_REG_M = 0x03).
+     * The calling thread sleeps until the expected end of each conversion, so SR_REG_M is usually checked
+     * once per conversion.
+     * The result is compensated and calibrated like read_data output.
+     *
+     * @param data averaged value in gauss (x, y, z)
+     * @return 0 on success, otherwise non-zero error code
+     */
+    int read_duty_cycle_window(float data[3]);
+
+    /**
+     * Start periodic duty cycle measurement windows using event queue.
+     *
+     * The window is split into wake up and deferred conversion reading steps that are chained with
+     * EventQueue::call_in, so the \p queue isn't blocked during the window.
+     * The window is skipped if the previous one hasn't been finished yet.
+     *
+     * @param queue event queue
+     * @param data_cb callback that gets averaged value in gauss (x, y, z)
+     */
+    void start_duty_cycle_schedule(EventQueue *queue, Callback<void(const float *data)> data_cb);
+
+    /**
+     * Stop periodic duty cycle measurement windows.
+     */
+    void stop_duty_cycle_schedule();
+
+    /**
+     * Estimate duty cycle mode current and noise with current output data rate and full scale.
+     *
+     * @param estimation
+     */
+    void get_duty_cycle_estimation(DutyCycleEstimation *estimation);
+
+    /**
+     * Estimate duty cycle mode current and noise.
+     *
+     * The estimation uses typical datasheet current of the continuous mode and sleep mode, and assumes that
+     * the window takes one extra sample period for the discarded wake up sample. The noise of the single sample is assumed to be
+     * 1.5 LSB RMS, so averaging reduces it by square root of the number of conversions.
+     *
+     * @param config duty cycle configuration
+     * @param odr output data rate of the measurement window
+     * @param fs full scale
+     * @param estimation
+     */
+    static void estimate_duty_cycle(const DutyCycleConfig &config, OutputDataRate odr, FullScale fs, DutyCycleEstimation *estimation);
+
+    enum HangWatchdogMode {
+        HWD_ENABLE = 1,
+        HWD_DISABLE = 0
+    };
+
+    /**
+     * Enable/disable continuous mode hang watchdog.
+     *
+     * Sometime after first read in the continuous mode magnetometer hangs. The watchdog detects it
+     * without additional bus transactions and re-arms continuous mode only if hang is detected:
+     * - if read_data_16 returns the same frame longer than 4 sample periods;
+     * - if read_new_data_16 reports stale data (cleared DRDY flag) longer than 4 sample periods;
+     * - if there are no DRDY edges longer than 4 sample periods in the DRDY acquisition mode.
+     *   If DRDY is stuck in the high state, the data is read to generate new edge, but the sample is discarded,
+     *   as its generation time is unknown.
+     *
+     * The watchdog is enabled by default.
+     *
+     * @param mode
+     */
+    void set_hang_watchdog_mode(HangWatchdogMode mode);
+
+    /**
+     * Check if hang watchdog is enabled/disabled.
+     *
+     * @return
+     */
+    HangWatchdogMode get_hang_watchdog_mode();
+
+    /**
+     * Hang watchdog statistics.
+     */
+    struct HangWatchdogStatistics {
+        // number of reads with the same frame as the previous one
+        uint32_t stale_reads;
+        // number of hangs that are detected by frames repetition
+        uint32_t data_timeouts;
+        // number of hangs that are detected by missed DRDY edges
+        uint32_t drdy_timeouts;
+        // number of continuous mode re-arms
+        uint32_t rearms;
+    };
+
+    /**
+     * Get cumulative hang watchdog statistics.
+     *
+     * @param stats
+     */
+    void get_hang_watchdog_statistics(HangWatchdogStatistics *stats);
+
+    /**
+     * Reset hang watchdog statistics.
+     */
+    void reset_hang_watchdog_statistics();
+
+    /**
+     * Snapshot of the magnetometer configuration registers CRA_REG_M, CRB_REG_M and MR_REG_M.
+     */
+    struct ConfigSnapshot {
+        uint8_t regs[MR_REG_M - CRA_REG_M + 1];
+    };
+
+    /**
+     * Save current sensor configuration with one burst read.
+     *
+     * @param config
+     */
+    void save_config(ConfigSnapshot *config);
+
+    /**
+     * Restore sensor configuration that is saved by save_config with one burst write.
+     *
+     * @param config
+     */
+    void restore_config(const ConfigSnapshot &config);
+
+    /**
+     * Apply compile time configuration.
+     *
+     * The register image of the configuration is calculated at compile time and is written with one burst write.
+     * The configuration should be described by MagnetometerStaticConfig template:
+     *
+     * @code
+     * typedef MagnetometerStaticConfig<LSM303DLHCMagnetometer::ODR_75_HZ, LSM303DLHCMagnetometer::FULL_SCALE_1_9_G> MagConfig;
+     * magnetometer.apply_static_config<MagConfig>();
+     * @endcode
+     *
+     * @tparam Config configuration descriptor
+     */
+    template <class Config>
+    void apply_static_config()
+    {
+        const uint8_t regs[MR_REG_M - CRA_REG_M + 1] = { Config::cra_reg(), Config::crb_reg(), Config::mr_reg() };
+        _apply_register_image(regs, Config::xy_sensitivity(), Config::z_sensitivity());
+    }
+
 private:
     I2CDevice _i2c_device;
 
@@ -266,9 +945,328 @@ private:
 
     float _xy_mag_sensitivity;
     float _z_mag_sensitivity;
-    // Sometime after first read in the continuous mode magnetometer hangs.
-    // To fix it, we need to enable continuous mode again.
-    int8_t _mode_state;
+    // sensitivity in milligauss/LSB in Q16 format
+    int32_t _xy_mg_scale;
+    int32_t _z_mg_scale;
+
+    /**
+     * Convert sensitivity into milligauss/LSB in Q16 format.
+     *
+     * @param sensitivity sensitivity in gauss/LSB
+     * @return
+     */
+    static constexpr int32_t _sensitivity_to_mg_scale(float sensitivity)
+    {
+        return (int32_t)(sensitivity * 1000.0f * 65536.0f + 0.5f);
+    }
+
+    /**
+     * Update cached sensitivity values.
+     *
+     * @param fs
+     */
+    void _update_sensitivity(FullScale fs);
+
+    /**
+     * Write CRA_REG_M - MR_REG_M registers and update cached values.
+     *
+     * @param regs register values
+     * @param xy_sensitivity X and Y axes sensitivity of the register configuration
+     * @param z_sensitivity Z axis sensitivity of the register configuration
+     */
+    void _apply_register_image(const uint8_t regs[], float xy_sensitivity, float z_sensitivity);
+
+    // automatic full scale ranging state
+    bool _ar_enabled;
+    FullScale _ar_min_fs;
+    FullScale _ar_max_fs;
+    FullScale _ar_fs;
+    // threshold in LSB to increase/decrease full scale
+    int16_t _ar_up_threshold;
+    int16_t _ar_down_threshold;
+    int _ar_quiet_samples;
+    // previous sensitivity is used until conversion with new full scale is finished
+    bool _ar_pending;
+    float _ar_pending_xy_sensitivity;
+    float _ar_pending_z_sensitivity;
+    int32_t _ar_pending_xy_mg_scale;
+    int32_t _ar_pending_z_mg_scale;
+
+    /**
+     * Update automatic full scale ranging with new sample.
+     *
+     * @param data
+     */
+    void _update_auto_range(const int16_t data[3]);
+
+    /**
+     * Set full scale of the automatic ranging and calculate its thresholds.
+     *
+     * @param fs
+     */
+    void _ar_apply(FullScale fs);
+
+    // DRDY acquisition state
+    InterruptIn *_drdy_pin;
+    EventQueue *_drdy_queue;
+    SampleCallback _drdy_sample_cb;
+    Sample *_drdy_buffer;
+    int _drdy_buffer_size;
+    int _drdy_buffer_count;
+    Callback<void(int)> _drdy_complete_cb;
+    volatile bool _drdy_pending;
+    // pending sample has been generated before acquisition start, so its timestamp is unknown
+    volatile bool _drdy_discard;
+    volatile us_timestamp_t _drdy_edge_time;
+    volatile uint32_t _drdy_missed;
+
+    /**
+     * Start DRDY acquisition with already configured sample destination.
+     *
+     * @param drdy_pin
+     * @param queue
+     */
+    void _drdy_start(InterruptIn *drdy_pin, EventQueue *queue);
+
+    /**
+     * DRDY rising edge handler (interrupt context).
+     */
+    void _drdy_isr();
+
+    /**
+     * Read and deliver sample (event queue context).
+     */
+    void _drdy_process();
+
+    // single conversion state
+    uint32_t _sc_min_period;
+    bool _sc_valid;
+    Sample _sc_last_sample;
+    EventQueue *_sc_queue;
+    int _sc_event_id;
+    int _sc_poll_event_id;
+    int _sc_polls;
+    SampleCallback _sc_sample_cb;
+
+    /**
+     * Check if single conversion should be skipped due rate limit.
+     *
+     * @param now current time
+     * @return
+     */
+    bool _sc_rate_limited(us_timestamp_t now);
+
+    /**
+     * Clear stale data and trigger single conversion.
+     */
+    void _sc_trigger();
+
+    /**
+     * Read sample if conversion is completed.
+     *
+     * @return true if sample has been read into _sc_last_sample
+     */
+    bool _sc_read_sample();
+
+    /**
+     * Trigger scheduled single conversion (event queue context).
+     */
+    void _sc_process();
+
+    /**
+     * Check scheduled single conversion completion (event queue context).
+     */
+    void _sc_poll();
+
+    // duty cycle mode state
+    DutyCycleConfig _dc_config;
+    EventQueue *_dc_queue;
+    int _dc_event_id;
+    Callback<void(const float *data)> _dc_data_cb;
+    int _dc_poll_event_id;
+    // current window state
+    us_timestamp_t _dc_start_time;
+    float _dc_sample_period;
+    float _dc_xy_sensitivity;
+    float _dc_z_sensitivity;
+    // index of the expected conversion, -1 is discarded wake up conversion
+    int _dc_index;
+    int32_t _dc_sum[3];
+
+    /**
+     * Wake magnetometer up and reset window state.
+     */
+    void _dc_wake();
+
+    /**
+     * Get delay until the expected end of the current conversion.
+     *
+     * @return delay in milliseconds, at least 1 ms
+     */
+    int _dc_delay();
+
+    /**
+     * Read conversion if it's completed.
+     *
+     * @return 1 if conversion has been read, 0 if it isn't completed yet or MBED_ERROR_TIME_OUT
+     */
+    int _dc_read_conversion();
+
+    /**
+     * Put magnetometer into sleep mode and calculate window result.
+     *
+     * @param err window error code
+     * @param data averaged value in gauss (x, y, z)
+     * @return \p err or 0 on success
+     */
+    int _dc_finish(int err, float data[]);
+
+    /**
+     * Start scheduled duty cycle window (event queue context).
+     */
+    void _dc_process();
+
+    /**
+     * Schedule deferred conversion reading of the current window.
+     */
+    void _dc_schedule_poll();
+
+    /**
+     * Read conversion of the scheduled window and finish it after the last one (event queue context).
+     */
+    void _dc_poll();
+
+    // calibration
+    bool _cal_enabled;
+    Calibration _cal;
+    // precalculated W * o
+    float _cal_w_offset[3];
+
+    // mounting orientation, the matrix is identity if orientation isn't set
+    bool _orientation_enabled;
+    int8_t _orientation[3][3];
+
+    /**
+     * Set rotation matrix from sensor axes to board axes.
+     *
+     * @param matrix
+     */
+    void _set_orientation(const int8_t matrix[3][3]);
+
+    /**
+     * Get sensor axis of the board axis.
+     *
+     * @param i board axis index
+     * @return sensor axis index
+     */
+    int _orientation_source(int i) const
+    {
+        return _orientation[i][0] ? 0 : _orientation[i][1] ? 1 : 2;
+    }
+
+    /**
+     * Apply temperature compensation, calibration and orientation to the raw sample with LSB resolution.
+     *
+     * @param data raw sample in sensor axes, it's replaced by corrected sample in board axes
+     * @param sensitivity sensitivity of the sample axes in sensor axes
+     */
+    void _correct_data_16(int16_t data[3], const float sensitivity[3]);
+
+    // temperature compensation
+    bool _tc_enabled;
+    TemperatureCompensation _tc;
+    uint32_t _tc_update_period;
+    us_timestamp_t _tc_update_time;
+    float _tc_temperature;
+    // precalculated per-axis scale and bias of the current temperature
+    float _tc_scale[3];
+    float _tc_bias[3];
+
+    /**
+     * Update cached temperature and compensation coefficients if update period is expired.
+     */
+    void _tc_update();
+
+    /**
+     * Convert raw sample into gauss and apply calibration and orientation.
+     *
+     * @param data_16 raw sample
+     * @param sensitivity sensitivity of the sample axes
+     * @param data output
+     */
+    void _convert(const int16_t data_16[], const float sensitivity[], float data[]);
+
+    /**
+     * Apply temperature compensation, calibration and orientation to the value in gauss.
+     *
+     * @param m value in gauss
+     * @param data output
+     */
+    void _compensate(const float m[], float data[]);
+
+    /**
+     * Read output registers and optionally status register.
+     *
+     * @param data sample
+     * @param sensitivity sample sensitivity
+     * @param with_status read SR_REG_M together with data
+     * @param mg_scale optional sample sensitivity in milligauss/LSB in Q16 format
+     * @return SR_REG_M flags or -1 if status isn't read
+     */
+    int _read_frame(int16_t data[], float sensitivity[], bool with_status, int32_t mg_scale[] = nullptr);
+
+    /**
+     * Convert output registers content to x, y, z values.
+     *
+     * @param raw_data OUT_X_H_M - OUT_Y_L_M values
+     * @param data
+     */
+    static void _decode_data(const uint8_t raw_data[], int16_t data[]);
+
+    // continuous mode hang watchdog state
+    bool _continuous_mode;
+    bool _wd_enabled;
+    // hang timeout in microseconds
+    uint32_t _wd_timeout;
+    int16_t _wd_last_data[3];
+    us_timestamp_t _wd_last_change_time;
+    us_timestamp_t _wd_last_drdy_time;
+    int _wd_drdy_event_id;
+    HangWatchdogStatistics _wd_stats;
+
+    /**
+     * Reset hang watchdog state after magnetometer mode change.
+     *
+     * @param continuous_mode
+     */
+    void _wd_reset(bool continuous_mode);
+
+    /**
+     * Update hang timeout.
+     *
+     * @param odr current output data rate
+     */
+    void _wd_update_timeout(OutputDataRate odr);
+
+    /**
+     * Check new frame for hang.
+     *
+     * @param data
+     * @param status SR_REG_M flags or -1 if they are unknown
+     */
+    void _wd_process(const int16_t data[], int status);
+
+    /**
+     * Check DRDY edges for hang (event queue context).
+     */
+    void _wd_check_drdy();
+
+    /**
+     * Enable continuous mode again.
+     *
+     * @param now current time
+     */
+    void _wd_rearm(us_timestamp_t now);
 };
 }
 
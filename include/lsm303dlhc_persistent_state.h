@@ -0,0 +1,243 @@
+#ifndef LSM303DLHC_PERSISTENT_STATE_H
+#define LSM303DLHC_PERSISTENT_STATE_H
+
+#include "BlockDevice.h"
+#include "lsm303dlhc_accelerometer_driver.h"
+#include "lsm303dlhc_magnetometer_driver.h"
+#include "lsm303dlhc_thermal_compensator.h"
+#include "mbed.h"
+
+namespace lsm303dlhc {
+
+/**
+ * Persisted configuration and calibration of the drivers.
+ *
+ * The state is kept as versioned blob with CRC-32, so it can be saved to non-volatile memory and
+ * restored at boot instead of init, setters and calibration invocation. The blob can be stored with
+ * KVStore, BlockDevice or file (for example, a file of the mounted file system or a plain file on the host).
+ * The KVStore methods are available if "lsm303dlhc-driver.persistent_state_kvstore" option is enabled,
+ * so the KVStore global API isn't required otherwise.
+ *
+ * Usage:
+ *
+ * @code
+ * // boot: restore state or configure and calibrate sensors
+ * if (PersistentState::restore_kv("/kv/lsm303dlhc", &accelerometer, &magnetometer)) {
+ *     accelerometer.init();
+ *     magnetometer.init();
+ *     // configure and calibrate sensors
+ *     // ...
+ *     PersistentState state;
+ *     state.capture(&accelerometer, &magnetometer);
+ *     state.save_kv("/kv/lsm303dlhc");
+ * }
+ * @endcode
+ *
+ * The blob contains:
+ * - accelerometer configuration registers (LSM303DLHCAccelerometer::save_config), offset and calibration;
+ * - magnetometer configuration registers (LSM303DLHCMagnetometer::save_config), calibration and temperature compensation;
+ * - optional AccelerometerThermalCompensator table and reference.
+ *
+ * @note the blob layout depends on compiler data representation, so it should be restored by the firmware
+ * that is built for the same target. The VERSION is changed, if the blob layout is changed.
+ */
+class PersistentState : NonCopyable<PersistentState> {
+public:
+    /**
+     * Blob signature ("LSMD").
+     */
+    static const uint32_t MAGIC = 0x444D534C;
+
+    /**
+     * Blob layout version.
+     */
+    static const uint16_t VERSION = 1;
+
+    /**
+     * Blob sections.
+     */
+    enum Section {
+        SECTION_ACCELEROMETER = 0x01,
+        SECTION_MAGNETOMETER = 0x02,
+        SECTION_THERMAL_COMPENSATOR = 0x04
+    };
+
+    /**
+     * Serialized state.
+     */
+    struct Blob {
+        // header
+        uint32_t magic;
+        uint16_t version;
+        uint16_t size;
+        uint32_t sections;
+
+        // accelerometer state
+        LSM303DLHCAccelerometer::ConfigSnapshot acc_config;
+        uint8_t acc_offset_enabled;
+        uint8_t acc_cal_enabled;
+        float acc_offset[3];
+        LSM303DLHCAccelerometer::Calibration acc_cal;
+
+        // magnetometer state
+        LSM303DLHCMagnetometer::ConfigSnapshot mag_config;
+        uint8_t mag_cal_enabled;
+        uint8_t mag_tc_enabled;
+        uint32_t mag_tc_update_period;
+        LSM303DLHCMagnetometer::Calibration mag_cal;
+        LSM303DLHCMagnetometer::TemperatureCompensation mag_tc;
+
+        // accelerometer thermal compensator state
+        float tc_t_min;
+        float tc_t_step;
+        uint8_t tc_reference_enabled;
+        float tc_reference[3];
+        float tc_table[AccelerometerThermalCompensator::TABLE_SIZE][3];
+
+        // CRC-32 of the previous fields
+        uint32_t crc;
+    };
+
+    PersistentState();
+
+    virtual ~PersistentState();
+
+    /**
+     * Remove all sections.
+     */
+    void reset();
+
+    /**
+     * Save current state of the drivers into blob.
+     *
+     * The sensor registers are read with burst reads, so the drivers should be initialized.
+     *
+     * @param acc accelerometer or @c nullptr to skip accelerometer section
+     * @param mag magnetometer or @c nullptr to skip magnetometer section
+     * @param compensator optional thermal compensator
+     */
+    void capture(LSM303DLHCAccelerometer *acc, LSM303DLHCMagnetometer *mag, AccelerometerThermalCompensator *compensator = nullptr);
+
+    /**
+     * Restore state of the drivers from blob.
+     *
+     * The configuration registers are written with LSM303DLHCAccelerometer::restore_config and
+     * LSM303DLHCMagnetometer::restore_config, so the sensors are ready to stream data without init invocation.
+     * Nothing is applied, if any requested section is missed or mismatches.
+     *
+     * @param acc accelerometer or @c nullptr to skip accelerometer section
+     * @param mag magnetometer or @c nullptr to skip magnetometer section
+     * @param compensator optional thermal compensator
+     * @return 0 on success, MBED_ERROR_ITEM_NOT_FOUND if section is missed or MBED_ERROR_CONFIG_MISMATCH if
+     *         thermal compensator table nodes are different
+     */
+    int apply(LSM303DLHCAccelerometer *acc, LSM303DLHCMagnetometer *mag, AccelerometerThermalCompensator *compensator = nullptr);
+
+    /**
+     * Get sections of the blob.
+     *
+     * @return bit mask of the Section values
+     */
+    uint32_t get_sections();
+
+    /**
+     * Get blob with actual CRC.
+     *
+     * @return
+     */
+    const Blob &get_blob();
+
+    /**
+     * Set blob.
+     *
+     * @param blob
+     * @return 0 on success, MBED_ERROR_INVALID_FORMAT if blob signature is invalid, MBED_ERROR_UNSUPPORTED
+     *         if blob version is different, MBED_ERROR_INVALID_SIZE if blob size is different or
+     *         MBED_ERROR_INVALID_DATA_DETECTED if CRC is invalid
+     */
+    int set_blob(const Blob &blob);
+
+#if MBED_CONF_LSM303DLHC_DRIVER_PERSISTENT_STATE_KVSTORE
+    /**
+     * Save blob with KVStore global API.
+     *
+     * @param key full key name (for example, "/kv/lsm303dlhc")
+     * @return 0 on success, otherwise KVStore error code
+     */
+    int save_kv(const char *key);
+
+    /**
+     * Load blob with KVStore global API.
+     *
+     * @param key full key name
+     * @return 0 on success, otherwise KVStore or set_blob error code
+     */
+    int load_kv(const char *key);
+
+    /**
+     * Load blob with KVStore global API and apply it.
+     *
+     * It's single call alternative of the init, configuration and calibration at boot.
+     *
+     * @param key full key name
+     * @param acc accelerometer or @c nullptr to skip accelerometer section
+     * @param mag magnetometer or @c nullptr to skip magnetometer section
+     * @param compensator optional thermal compensator
+     * @return 0 on success, otherwise load_kv or apply error code
+     */
+    static int restore_kv(const char *key, LSM303DLHCAccelerometer *acc, LSM303DLHCMagnetometer *mag, AccelerometerThermalCompensator *compensator = nullptr);
+#endif // MBED_CONF_LSM303DLHC_DRIVER_PERSISTENT_STATE_KVSTORE
+
+    /**
+     * Save blob to block device.
+     *
+     * The erase blocks that contain blob are erased. The blob is padded to program size.
+     *
+     * @param bd initialized block device
+     * @param addr address of the erase block
+     * @return 0 on success, MBED_ERROR_OUT_OF_MEMORY if padded buffer cannot be allocated,
+     *         otherwise block device error code
+     */
+    int save_block_device(BlockDevice *bd, bd_addr_t addr);
+
+    /**
+     * Load blob from block device.
+     *
+     * @param bd initialized block device
+     * @param addr address of the blob
+     * @return 0 on success, MBED_ERROR_OUT_OF_MEMORY if padded buffer cannot be allocated,
+     *         otherwise block device or set_blob error code
+     */
+    int load_block_device(BlockDevice *bd, bd_addr_t addr);
+
+    /**
+     * Save blob to file.
+     *
+     * @param path file path
+     * @return 0 on success, otherwise MBED_ERROR_WRITE_FAILED
+     */
+    int save_file(const char *path);
+
+    /**
+     * Load blob from file.
+     *
+     * @param path file path
+     * @return 0 on success, MBED_ERROR_ITEM_NOT_FOUND if file cannot be opened, MBED_ERROR_READ_FAILED
+     *         or set_blob error code
+     */
+    int load_file(const char *path);
+
+private:
+    Blob _blob;
+
+    /**
+     * Calculate CRC-32 of the blob fields.
+     *
+     * @param blob
+     * @return
+     */
+    static uint32_t _calculate_crc(const Blob &blob);
+};
+}
+
+#endif // LSM303DLHC_PERSISTENT_STATE_H
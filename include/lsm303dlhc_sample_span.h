@@ -0,0 +1,87 @@
+#ifndef LSM303DLHC_SAMPLE_SPAN_H
+#define LSM303DLHC_SAMPLE_SPAN_H
+
+#include "mbed.h"
+
+namespace lsm303dlhc {
+
+/**
+ * Non-owning view of the sample block (x, y, z triplets) in caller-owned memory.
+ *
+ * Block methods of the drivers fill the memory in place and return view of the filled part,
+ * so the samples can be passed to the next processing stages without copying.
+ *
+ * @tparam T sample type
+ */
+template <typename T>
+struct SampleSpan {
+    // samples
+    T (*data)[3];
+    // number of samples
+    int size;
+
+    SampleSpan()
+        : data(nullptr)
+        , size(0)
+    {
+    }
+
+    SampleSpan(T (*data)[3], int size)
+        : data(data)
+        , size(size)
+    {
+    }
+
+    template <int N>
+    SampleSpan(T (&data)[N][3])
+        : data(data)
+        , size(N)
+    {
+    }
+
+    /**
+     * Get sample.
+     *
+     * @param i sample index
+     * @return
+     */
+    T *operator[](int i) const
+    {
+        return data[i];
+    }
+
+    /**
+     * Check if view doesn't contain samples.
+     *
+     * @return
+     */
+    bool empty() const
+    {
+        return size <= 0;
+    }
+
+    /**
+     * Get view of the part of the block.
+     *
+     * @param offset index of the first sample
+     * @param count number of samples
+     * @return
+     */
+    SampleSpan subspan(int offset, int count) const
+    {
+        return SampleSpan(data + offset, count);
+    }
+
+    T (*begin() const)[3]
+    {
+        return data;
+    }
+
+    T (*end() const)[3]
+    {
+        return data + size;
+    }
+};
+}
+
+#endif // LSM303DLHC_SAMPLE_SPAN_H
@@ -0,0 +1,81 @@
+#ifndef LSM303DLHC_SAMPLE_TRAITS_H
+#define LSM303DLHC_SAMPLE_TRAITS_H
+
+#include "mbed.h"
+
+namespace lsm303dlhc {
+
+/**
+ * Value in milli units: mg for accelerometer or milligauss for magnetometer.
+ */
+struct MilliUnits {
+    int16_t value;
+};
+
+/**
+ * Sample type traits that are used by read_data_as methods of the drivers.
+ *
+ * The traits convert raw value into sample type. Both sensitivity representations are passed,
+ * so the type can use the suitable one. If full scale is known at compile time, the sensitivities
+ * are constants and the conversion is inlined completely.
+ *
+ * User types can be supported with specialization:
+ *
+ * @code
+ * template <>
+ * struct SampleTraits<double> {
+ *     static double convert(int16_t raw, float sensitivity, int32_t milli_scale)
+ *     {
+ *         return raw * (double)sensitivity;
+ *     }
+ * };
+ * @endcode
+ *
+ * @tparam T sample type
+ */
+template <typename T>
+struct SampleTraits;
+
+/**
+ * Raw value.
+ */
+template <>
+struct SampleTraits<int16_t> {
+    /**
+     * Convert raw value.
+     *
+     * @param raw raw value
+     * @param sensitivity sensitivity in SI units (m/s^2 or gauss) per LSB
+     * @param milli_scale sensitivity in milli units per LSB in Q16 format
+     * @return
+     */
+    static constexpr int16_t convert(int16_t raw, float sensitivity, int32_t milli_scale)
+    {
+        return raw;
+    }
+};
+
+/**
+ * Value in SI units (m/s^2 or gauss).
+ */
+template <>
+struct SampleTraits<float> {
+    static constexpr float convert(int16_t raw, float sensitivity, int32_t milli_scale)
+    {
+        return raw * sensitivity;
+    }
+};
+
+/**
+ * Value in milli units with integer arithmetic.
+ */
+template <>
+struct SampleTraits<MilliUnits> {
+    static constexpr MilliUnits convert(int16_t raw, float sensitivity, int32_t milli_scale)
+    {
+        return MilliUnits { (int16_t)((raw * milli_scale + 0x8000) >> 16) };
+    }
+};
+}
+
+#endif // LSM303DLHC_SAMPLE_TRAITS_H
@@ -0,0 +1,163 @@
+#ifndef LSM303DLHC_STATIC_CONFIG_H
+#define LSM303DLHC_STATIC_CONFIG_H
+
+#include "lsm303dlhc_accelerometer_driver.h"
+#include "lsm303dlhc_magnetometer_driver.h"
+
+namespace lsm303dlhc {
+
+/**
+ * Compile time accelerometer configuration.
+ *
+ * All register values, sensitivity and frequencies are calculated at compile time.
+ * Illegal mode combinations (like LSM303DLHCAccelerometer::ODR_1344HZ in the low power mode) cause compilation error.
+ * The configuration can be applied with LSM303DLHCAccelerometer::apply_static_config.
+ *
+ * @tparam POWER_MODE power mode
+ * @tparam ODR output data rate
+ * @tparam FULL_SCALE full scale
+ * @tparam HRO high resolution output mode (it's disabled by default in the low power mode)
+ * @tparam HPF high pass filter mode
+ * @tparam FIFO_MODE FIFO mode
+ * @tparam WATERMARK FIFO watermark
+ * @tparam DRDY data ready interrupt mode (watermark interrupt if FIFO is enabled)
+ */
+template <
+    LSM303DLHCAccelerometer::PowerMode POWER_MODE,
+    LSM303DLHCAccelerometer::OutputDataRate ODR,
+    LSM303DLHCAccelerometer::FullScale FULL_SCALE,
+    LSM303DLHCAccelerometer::HighResolutionOutputMode HRO = (POWER_MODE == LSM303DLHCAccelerometer::LOW_POWER_MODE ? LSM303DLHCAccelerometer::HRO_DISABLED : LSM303DLHCAccelerometer::HRO_ENABLED),
+    LSM303DLHCAccelerometer::HighPassFilterMode HPF = LSM303DLHCAccelerometer::HPF_OFF,
+    LSM303DLHCAccelerometer::FIFOMode FIFO_MODE = LSM303DLHCAccelerometer::FIFO_DISABLE,
+    int WATERMARK = 0,
+    LSM303DLHCAccelerometer::DatadaReadyInterruptMode DRDY = LSM303DLHCAccelerometer::DRDY_DISABLE>
+struct AccelerometerStaticConfig {
+    // note: the lower bits of the OutputDataRate values contain allowed power modes
+    static_assert(ODR == LSM303DLHCAccelerometer::ODR_NONE || (ODR & (1 << POWER_MODE)), "Output data rate isn't supported in the selected power mode");
+    static_assert(!(POWER_MODE == LSM303DLHCAccelerometer::LOW_POWER_MODE && HRO == LSM303DLHCAccelerometer::HRO_ENABLED), "High resolution output cannot be used in the low power mode");
+    static_assert(WATERMARK >= 0 && WATERMARK < LSM303DLHCAccelerometer::FIFO_SIZE, "Invalid watermark value");
+
+    static constexpr uint8_t ctrl_reg1()
+    {
+        return (ODR & 0xF0) | (POWER_MODE == LSM303DLHCAccelerometer::LOW_POWER_MODE ? 0x08 : 0x00) | 0x07;
+    }
+
+    static constexpr uint8_t ctrl_reg2()
+    {
+        return HPF == LSM303DLHCAccelerometer::HPF_OFF ? 0x00 : (HPF | 0x08);
+    }
+
+    static constexpr uint8_t ctrl_reg3()
+    {
+        return DRDY == LSM303DLHCAccelerometer::DRDY_DISABLE ? 0x00 : FIFO_MODE == LSM303DLHCAccelerometer::FIFO_ENABLE ? 0x04 : 0x10;
+    }
+
+    static constexpr uint8_t ctrl_reg4()
+    {
+        return FULL_SCALE | (HRO == LSM303DLHCAccelerometer::HRO_ENABLED ? 0x08 : 0x00);
+    }
+
+    static constexpr uint8_t ctrl_reg5()
+    {
+        return FIFO_MODE == LSM303DLHCAccelerometer::FIFO_ENABLE ? 0x40 : 0x00;
+    }
+
+    static constexpr uint8_t ctrl_reg6()
+    {
+        return 0x00;
+    }
+
+    static constexpr uint8_t fifo_ctrl_reg()
+    {
+        // stream or bypass mode
+        return (FIFO_MODE == LSM303DLHCAccelerometer::FIFO_ENABLE ? 0x80 : 0x00) | WATERMARK;
+    }
+
+    /**
+     * Get sensitivity in (m/s^2)/LSB.
+     */
+    static constexpr float sensitivity()
+    {
+        return LSM303DLHCAccelerometer::get_full_scale_sensitivity(FULL_SCALE);
+    }
+
+    /**
+     * Get output data rate in Hz.
+     */
+    static constexpr float output_data_rate_hz()
+    {
+        return LSM303DLHCAccelerometer::get_output_data_rate_hz(ODR);
+    }
+
+    /**
+     * Get cut off frequency of the high pass filter in Hz or zero if filter is disabled.
+     */
+    static constexpr float high_pass_filter_cut_off_frequency()
+    {
+        return LSM303DLHCAccelerometer::get_high_pass_filter_cut_off_frequency(HPF, ODR);
+    }
+};
+
+/**
+ * Compile time magnetometer configuration.
+ *
+ * All register values and sensitivities are calculated at compile time.
+ * The configuration can be applied with LSM303DLHCMagnetometer::apply_static_config.
+ *
+ * @tparam ODR output data rate
+ * @tparam FULL_SCALE full scale
+ * @tparam TSM temperature sensor mode
+ * @tparam MM magnetometer mode
+ */
+template <
+    LSM303DLHCMagnetometer::OutputDataRate ODR,
+    LSM303DLHCMagnetometer::FullScale FULL_SCALE,
+    LSM303DLHCMagnetometer::TemperatureSensorMode TSM = LSM303DLHCMagnetometer::TS_ENABLE,
+    LSM303DLHCMagnetometer::MagnetometerMode MM = LSM303DLHCMagnetometer::M_ENABLE>
+struct MagnetometerStaticConfig {
+    static_assert(LSM303DLHCMagnetometer::get_output_data_rate_hz(ODR) > 0, "Invalid output data rate");
+    static_assert(LSM303DLHCMagnetometer::get_full_scale_xy_sensitivity(FULL_SCALE) > 0, "Invalid full scale");
+
+    static constexpr uint8_t cra_reg()
+    {
+        return TSM | (ODR << 2);
+    }
+
+    static constexpr uint8_t crb_reg()
+    {
+        return FULL_SCALE;
+    }
+
+    static constexpr uint8_t mr_reg()
+    {
+        // continuous conversion or sleep mode
+        return MM == LSM303DLHCMagnetometer::M_ENABLE ? 0x00 : 0x03;
+    }
+
+    /**
+     * Get X and Y axes sensitivity in gauss/LSB.
+     */
+    static constexpr float xy_sensitivity()
+    {
+        return LSM303DLHCMagnetometer::get_full_scale_xy_sensitivity(FULL_SCALE);
+    }
+
+    /**
+     * Get Z axis sensitivity in gauss/LSB.
+     */
+    static constexpr float z_sensitivity()
+    {
+        return LSM303DLHCMagnetometer::get_full_scale_z_sensitivity(FULL_SCALE);
+    }
+
+    /**
+     * Get output data rate in Hz.
+     */
+    static constexpr float output_data_rate_hz()
+    {
+        return LSM303DLHCMagnetometer::get_output_data_rate_hz(ODR);
+    }
+};
+}
+
+#endif // LSM303DLHC_STATIC_CONFIG_H
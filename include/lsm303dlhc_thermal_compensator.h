@@ -0,0 +1,177 @@
+#ifndef LSM303DLHC_THERMAL_COMPENSATOR_H
+#define LSM303DLHC_THERMAL_COMPENSATOR_H
+
+#include "lsm303dlhc_accelerometer_driver.h"
+#include "lsm303dlhc_magnetometer_driver.h"
+#include "mbed.h"
+
+namespace lsm303dlhc {
+
+/**
+ * Accelerometer zero-g offset thermal drift compensator.
+ *
+ * The LSM303DLHC has temperature sensor only in the magnetometer block, so the compensator periodically
+ * reads temperature with LSM303DLHCMagnetometer, interpolates per-axis bias with piecewise-linear table
+ * and passes it to LSM303DLHCAccelerometer::set_offset. So the bias is subtracted during data conversion
+ * without additional bus transactions.
+ *
+ * The table nodes are placed uniformly with step \p t_step starting from \p t_min.
+ * The bias outside table range is clamped to the nearest node.
+ *
+ * The table can be learned in place during stationary periods: the bias is difference between stationary
+ * data and reference gravity vector. The magnetometer temperature sensor should be enabled.
+ *
+ * @note the compensator overrides offset of the accelerometer
+ */
+class AccelerometerThermalCompensator : NonCopyable<AccelerometerThermalCompensator> {
+public:
+    /**
+     * Number of table nodes.
+     */
+    static const int TABLE_SIZE = 8;
+
+    /**
+     * Constructor.
+     *
+     * @param acc accelerometer
+     * @param mag magnetometer that is used as temperature sensor
+     * @param t_min temperature of the first table node in celsius
+     * @param t_step temperature step between table nodes in celsius
+     */
+    AccelerometerThermalCompensator(LSM303DLHCAccelerometer *acc, LSM303DLHCMagnetometer *mag, float t_min = -20.0f, float t_step = 10.0f);
+
+    virtual ~AccelerometerThermalCompensator();
+
+    /**
+     * Set temperature update period.
+     *
+     * @param period period in milliseconds
+     */
+    void set_update_period(uint32_t period);
+
+    /**
+     * Get temperature update period.
+     *
+     * @return period in milliseconds
+     */
+    uint32_t get_update_period();
+
+    /**
+     * Read temperature if update period is expired and update accelerometer offset.
+     *
+     * The method should be invoked periodically, for example before FIFO reading.
+     *
+     * @param force read temperature regardless of the update period
+     */
+    void update(bool force = false);
+
+    /**
+     * Get last temperature.
+     *
+     * @return temperature in celsius
+     */
+    float get_temperature();
+
+    /**
+     * Get bias that is applied to the accelerometer.
+     *
+     * @param bias bias in m/s^2
+     */
+    void get_bias(float bias[3]);
+
+    /**
+     * Set table.
+     *
+     * @param table per-axis bias of the table nodes in m/s^2
+     */
+    void set_table(const float table[TABLE_SIZE][3]);
+
+    /**
+     * Get table.
+     *
+     * @param table per-axis bias of the table nodes in m/s^2
+     */
+    void get_table(float table[TABLE_SIZE][3]);
+
+    /**
+     * Get temperature of the table node.
+     *
+     * @param i node index
+     * @return temperature in celsius
+     */
+    float get_node_temperature(int i);
+
+    /**
+     * Set reference gravity vector of the stationary device without bias.
+     *
+     * If reference isn't set, the first learned block is used as reference.
+     *
+     * @param reference gravity vector in m/s^2 or nullptr to reset reference
+     */
+    void set_reference(const float reference[3]);
+
+    /**
+     * Get reference gravity vector.
+     *
+     * @param reference
+     * @return true if reference is set, otherwise false
+     */
+    bool get_reference(float reference[3]);
+
+    /**
+     * Set learning rate.
+     *
+     * @param rate value in range (0, 1]
+     */
+    void set_learning_rate(float rate);
+
+    /**
+     * Update table with block of samples of the stationary device.
+     *
+     * The samples should be read by LSM303DLHCAccelerometer::read_fifo_data or LSM303DLHCAccelerometer::read_data
+     * after the last update invocation, so they are compensated with current bias.
+     *
+     * @param data block samples in m/s^2
+     * @param n number of samples
+     * @param threshold maximal deviation of the samples from the block mean in m/s^2
+     * @return 0 on success, MBED_ERROR_INVALID_DATA_DETECTED if device isn't stationary,
+     *         MBED_ERROR_INVALID_SIZE if block is empty
+     */
+    int learn(const float data[][3], int n, float threshold = 0.1f);
+
+private:
+    LSM303DLHCAccelerometer *_acc;
+    LSM303DLHCMagnetometer *_mag;
+
+    float _t_min;
+    float _t_step;
+    float _table[TABLE_SIZE][3];
+
+    bool _reference_enabled;
+    float _reference[3];
+    float _learning_rate;
+
+    uint32_t _update_period;
+    us_timestamp_t _update_time;
+    bool _updated;
+    float _temperature;
+    // bias that has been passed to accelerometer
+    float _bias[3];
+
+    /**
+     * Get interpolation nodes and weight of the second node for temperature.
+     *
+     * @param temperature
+     * @param i0 first node index
+     * @return weight of the node i0 + 1
+     */
+    float _locate(float temperature, int *i0);
+
+    /**
+     * Calculate bias for current temperature and pass it to accelerometer.
+     */
+    void _apply_bias();
+};
+}
+
+#endif // LSM303DLHC_THERMAL_COMPENSATOR_H
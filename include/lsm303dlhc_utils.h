@@ -80,6 +80,18 @@ public:
      */
     void read_registers(uint8_t reg, uint8_t *data, uint8_t length);
 
+    /**
+     * Write several registers, starting with address \p reg.
+     * This method cannot be invoked in the ISR context.
+     *
+     * @param reg
+     * @param data
+     * @param length number of registers, it shouldn't exceed MAX_WRITE_LENGTH
+     */
+    void write_registers(uint8_t reg, const uint8_t *data, uint8_t length);
+
+    static const uint8_t MAX_WRITE_LENGTH = 16;
+
     // the asynchronous reading isn't implemented as I2C::transfer isn't interrupt safe
     // (probably it should use CriticalSectionLock instead of PlatformMutex)
     // int read_registers_async(uint8_t reg, uint8_t* data, uint8_t length, const Callback<void(void)>& callback);
@@ -0,0 +1,183 @@
+#include "lsm303dlhc_accelerometer_calibrator.h"
+#include "math.h"
+
+using namespace lsm303dlhc;
+
+// minimal ratio of the dominant axis component to the sample magnitude (about 25 degrees of tilt)
+static const float position_alignment_ratio = 0.9f;
+
+AccelerometerCalibrator::AccelerometerCalibrator()
+{
+    reset();
+}
+
+AccelerometerCalibrator::~AccelerometerCalibrator()
+{
+}
+
+void AccelerometerCalibrator::reset()
+{
+    _positions = 0;
+    memset(_data, 0, sizeof(_data));
+}
+
+AccelerometerCalibrator::Position AccelerometerCalibrator::add_position(const float data[3])
+{
+    int axis = 0;
+    for (int i = 1; i < 3; i++) {
+        if (fabsf(data[i]) > fabsf(data[axis])) {
+            axis = i;
+        }
+    }
+    float norm = sqrtf(data[0] * data[0] + data[1] * data[1] + data[2] * data[2]);
+    if (norm == 0.0f || fabsf(data[axis]) < position_alignment_ratio * norm) {
+        return POSITION_NONE;
+    }
+
+    // the accelerometer measures +g for the axis that is directed up
+    int position = axis * 2 + (data[axis] > 0.0f ? 0 : 1);
+    memcpy(_data[position], data, sizeof(_data[position]));
+    _positions |= 1 << position;
+    return (Position)position;
+}
+
+int AccelerometerCalibrator::measure_position(LSM303DLHCAccelerometer *acc, int samples, float motion_threshold, Position *position)
+{
+    const int fifo_size = LSM303DLHCAccelerometer::FIFO_SIZE;
+    if (samples <= 0) {
+        return MBED_ERROR_INVALID_SIZE;
+    }
+    float odr = acc->get_output_data_rate_hz();
+    if (odr <= 0.0f) {
+        return MBED_ERROR_INVALID_DATA_DETECTED;
+    }
+
+    LSM303DLHCAccelerometer::FIFOMode fifo_mode = acc->get_fifo_mode();
+    acc->set_fifo_mode(LSM303DLHCAccelerometer::FIFO_ENABLE);
+    acc->clear_fifo();
+
+    // drain FIFO when it's half full, and allow 4 times more drains than required before timeout
+    const uint32_t drain_period = (uint32_t)(1000.0f * (fifo_size / 2) / odr) + 1;
+    const int max_drains = 4 * (samples / (fifo_size / 2) + 1);
+    int16_t block[fifo_size][3];
+    LSM303DLHCAccelerometer::BlockInfo info;
+    float sum[3] = { 0.0f, 0.0f, 0.0f };
+    float sum2[3] = { 0.0f, 0.0f, 0.0f };
+    int n = 0;
+    int err = MBED_SUCCESS;
+    for (int drains = 0; n < samples; drains++) {
+        if (drains >= max_drains) {
+            err = MBED_ERROR_TIME_OUT;
+            break;
+        }
+        ThisThread::sleep_for(std::chrono::milliseconds(drain_period));
+        int size = samples - n < fifo_size ? samples - n : fifo_size;
+        int m = acc->read_fifo_data_16(block, size, &info);
+        // note: use block sensitivity, as full scale can be changed by auto range mode
+        for (int k = 0; k < m; k++) {
+            for (int i = 0; i < 3; i++) {
+                float v = block[k][i] * info.sensitivity;
+                sum[i] += v;
+                sum2[i] += v * v;
+            }
+        }
+        n += m;
+    }
+    acc->set_fifo_mode(fifo_mode);
+    if (err) {
+        return err;
+    }
+
+    float mean[3];
+    for (int i = 0; i < 3; i++) {
+        mean[i] = sum[i] / n;
+        float variance = sum2[i] / n - mean[i] * mean[i];
+        if (variance > motion_threshold * motion_threshold) {
+            // device isn't stationary
+            return MBED_ERROR_INVALID_DATA_DETECTED;
+        }
+    }
+    Position p = add_position(mean);
+    if (position) {
+        *position = p;
+    }
+    return p == POSITION_NONE ? MBED_ERROR_INVALID_DATA_DETECTED : MBED_SUCCESS;
+}
+
+bool AccelerometerCalibrator::has_position(Position position)
+{
+    return position != POSITION_NONE && (_positions & (1 << position));
+}
+
+AccelerometerCalibrator::Position AccelerometerCalibrator::get_missing_position()
+{
+    for (int i = 0; i < POSITIONS; i++) {
+        if (!(_positions & (1 << i))) {
+            return (Position)i;
+        }
+    }
+    return POSITION_NONE;
+}
+
+int AccelerometerCalibrator::compute(LSM303DLHCAccelerometer::Calibration *cal, float *fit_error)
+{
+    if (get_missing_position() != POSITION_NONE) {
+        return MBED_ERROR_INVALID_SIZE;
+    }
+
+    // bias is mean of all positions, K column i is (a_up - a_down) / 2g
+    const float g = LSM303DLHCAccelerometer::GRAVITY_OF_EARTH;
+    float k[3][3];
+    float o[3];
+    for (int i = 0; i < 3; i++) {
+        o[i] = 0.0f;
+        for (int p = 0; p < POSITIONS; p++) {
+            o[i] += _data[p][i];
+        }
+        o[i] /= POSITIONS;
+        for (int j = 0; j < 3; j++) {
+            k[i][j] = (_data[j * 2][i] - _data[j * 2 + 1][i]) / (2.0f * g);
+        }
+    }
+
+    // W = K^-1 with adjugate matrix
+    float w[3][3];
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) {
+            int j1 = (j + 1) % 3, j2 = (j + 2) % 3;
+            int i1 = (i + 1) % 3, i2 = (i + 2) % 3;
+            w[i][j] = k[j1][i1] * k[j2][i2] - k[j1][i2] * k[j2][i1];
+        }
+    }
+    float det = k[0][0] * w[0][0] + k[0][1] * w[1][0] + k[0][2] * w[2][0];
+    if (fabsf(det) < 1e-3f) {
+        // positions are degenerate
+        return MBED_ERROR_INVALID_DATA_DETECTED;
+    }
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) {
+            cal->matrix[i][j] = w[i][j] / det;
+        }
+        cal->offset[i] = o[i];
+    }
+
+    if (fit_error) {
+        // error of the calibrated positions relatively to the ideal gravity vectors
+        float residual = 0.0f;
+        for (int p = 0; p < POSITIONS; p++) {
+            for (int i = 0; i < 3; i++) {
+                float v = 0.0f;
+                for (int j = 0; j < 3; j++) {
+                    v += cal->matrix[i][j] * (_data[p][j] - o[j]);
+                }
+                if (i == p / 2) {
+                    v -= p % 2 ? -g : g;
+                }
+                residual += v * v;
+            }
+        }
+        *fit_error = sqrtf(residual / POSITIONS);
+    }
+
+    return MBED_SUCCESS;
+}
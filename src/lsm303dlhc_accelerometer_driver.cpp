@@ -1,4 +1,5 @@
 #include "lsm303dlhc_accelerometer_driver.h"
+#include "lsm303dlhc_conversion.h"
 #include "math.h"
 #include "mbed_error.h"
 
@@ -6,13 +7,147 @@ using namespace lsm303dlhc;
 
 LSM303DLHCAccelerometer::LSM303DLHCAccelerometer(I2C *i2c_ptr)
     : _i2c_device(_I2C_ADDRESS, i2c_ptr)
+    , _full_scale(FULL_SCALE_2G)
     , _sensitivity(0)
+    , _sensitivity_mg(0)
+    , _offset_enabled(false)
+    , _offset()
+    , _offset_mg()
+    , _cal_enabled(false)
+    , _cal()
+    , _orientation_enabled(false)
+    , _orientation { { 1, 0, 0 }, { 0, 1, 0 }, { 0, 0, 1 } }
+    , _fifo_enabled(false)
+    , _fifo_watermark(0)
+    , _loss_stats()
+    , _last_read_time(0)
+    , _wtm_edge_time(0)
+    , _prev_wtm_edge_time(0)
+    , _prev_block_samples(0)
+    , _prev_block_left_samples(0)
+    , _period_measurements(0)
+    , _nominal_sample_period(0)
+    , _sample_period(0)
+    , _reconfiguration_time(0)
+    , _awm_enabled(false)
+    , _awm_latency_target(0)
+    , _awm_service_latency(0)
+    , _awm_processing_time(0)
+    , _awm_reported_processing_time(0)
+    , _awm_overrun_backoff(0)
+    , _awm_clean_blocks(0)
+    , _bc_state(BCS_DISABLED)
+    , _bc_idle_ctrl_regs()
+    , _bc_capture_ctrl_regs()
+    , _bc_capture_fifo_ctrl(0)
+    , _bc_idle_sample_period(0)
+    , _bc_capture_sample_period(0)
+    , _bc_max_samples(0)
+    , _bc_quiescent_samples(0)
+    , _bc_quiescent_threshold(0)
+    , _bc_captured_samples(0)
+    , _bc_quiet_samples(0)
+    , _odrg_enabled(false)
+    , _odrg_config()
+    , _odrg_ladder(nullptr)
+    , _odrg_min_index(0)
+    , _odrg_max_index(0)
+    , _odrg_index(0)
+    , _odrg_window_samples(0)
+    , _odrg_quiet_windows(0)
+    , _odrg_energy(0)
+    , _odrg_samples(0)
+    , _odrg_shift()
+    , _odrg_sum()
+    , _odrg_sum_sq()
+    , _ar_enabled(false)
+    , _ar_min_fs(FULL_SCALE_2G)
+    , _ar_max_fs(FULL_SCALE_16G)
+    , _ar_up_threshold(0)
+    , _ar_down_threshold(0)
+    , _ar_quiet_blocks(0)
+    , _ar_pending_samples(0)
+    , _ar_pending_sensitivity(0)
+    , _ar_next_pending_samples(0)
+    , _ar_next_pending_sensitivity(0)
+    , _staging(false)
+    , _staged_regs()
+    , _staged_dirty(0)
+    , _staged_odr(ODR_NONE)
+    , _staged_clear_data(false)
 {
 }
 
 LSM303DLHCAccelerometer::LSM303DLHCAccelerometer(PinName sda, PinName scl, int frequency)
     : _i2c_device(_I2C_ADDRESS, sda, scl, frequency)
+    , _full_scale(FULL_SCALE_2G)
     , _sensitivity(0)
+    , _sensitivity_mg(0)
+    , _offset_enabled(false)
+    , _offset()
+    , _offset_mg()
+    , _cal_enabled(false)
+    , _cal()
+    , _orientation_enabled(false)
+    , _orientation { { 1, 0, 0 }, { 0, 1, 0 }, { 0, 0, 1 } }
+    , _fifo_enabled(false)
+    , _fifo_watermark(0)
+    , _loss_stats()
+    , _last_read_time(0)
+    , _wtm_edge_time(0)
+    , _prev_wtm_edge_time(0)
+    , _prev_block_samples(0)
+    , _prev_block_left_samples(0)
+    , _period_measurements(0)
+    , _nominal_sample_period(0)
+    , _sample_period(0)
+    , _reconfiguration_time(0)
+    , _awm_enabled(false)
+    , _awm_latency_target(0)
+    , _awm_service_latency(0)
+    , _awm_processing_time(0)
+    , _awm_reported_processing_time(0)
+    , _awm_overrun_backoff(0)
+    , _awm_clean_blocks(0)
+    , _bc_state(BCS_DISABLED)
+    , _bc_idle_ctrl_regs()
+    , _bc_capture_ctrl_regs()
+    , _bc_capture_fifo_ctrl(0)
+    , _bc_idle_sample_period(0)
+    , _bc_capture_sample_period(0)
+    , _bc_max_samples(0)
+    , _bc_quiescent_samples(0)
+    , _bc_quiescent_threshold(0)
+    , _bc_captured_samples(0)
+    , _bc_quiet_samples(0)
+    , _odrg_enabled(false)
+    , _odrg_config()
+    , _odrg_ladder(nullptr)
+    , _odrg_min_index(0)
+    , _odrg_max_index(0)
+    , _odrg_index(0)
+    , _odrg_window_samples(0)
+    , _odrg_quiet_windows(0)
+    , _odrg_energy(0)
+    , _odrg_samples(0)
+    , _odrg_shift()
+    , _odrg_sum()
+    , _odrg_sum_sq()
+    , _ar_enabled(false)
+    , _ar_min_fs(FULL_SCALE_2G)
+    , _ar_max_fs(FULL_SCALE_16G)
+    , _ar_up_threshold(0)
+    , _ar_down_threshold(0)
+    , _ar_quiet_blocks(0)
+    , _ar_pending_samples(0)
+    , _ar_pending_sensitivity(0)
+    , _ar_next_pending_samples(0)
+    , _ar_next_pending_sensitivity(0)
+    , _staging(false)
+    , _staged_regs()
+    , _staged_dirty(0)
+    , _staged_odr(ODR_NONE)
+    , _staged_clear_data(false)
 {
 }
 
@@ -31,13 +166,21 @@ int LSM303DLHCAccelerometer::init(bool start)
     // set default modes
     _reboot_memory_content();
     set_data_ready_interrupt_mode(DRDY_DISABLE);
+    set_overrun_interrupt_mode(OVRN_DISABLE);
     set_fifo_mode(FIFO_DISABLE);
+    set_adaptive_watermark_mode(AWM_DISABLE);
     set_fifo_watermark(0);
     set_full_scale(FULL_SCALE_2G);
     set_high_pass_filter_mode(HPF_OFF);
     set_high_resolution_output_mode(HRO_ENABLED);
     set_power_mode(NORMAL_POWER_MODE);
     _clear_data();
+    reset_loss_statistics();
+    _bc_state = BCS_DISABLED;
+    _odrg_enabled = false;
+    _ar_enabled = false;
+    _ar_pending_samples = 0;
+    _ar_next_pending_samples = 0;
 
     LSM303DLHCAccelerometer::OutputDataRate expected_odr = start ? ODR_25HZ : ODR_NONE;
     set_output_data_rate(expected_odr);
@@ -62,12 +205,16 @@ void LSM303DLHCAccelerometer::write_register(uint8_t reg, uint8_t val)
 void LSM303DLHCAccelerometer::set_power_mode(PowerMode power_mode)
 {
     // update power mode bit
-    _i2c_device.update_register(CTRL_REG1_A, (uint8_t)(power_mode << 3), 0x08);
+    _update_config_register(CTRL_REG1_A, (uint8_t)(power_mode << 3), 0x08);
+    // note: power mode changes meaning of the ODR bits
+    if (!_staging) {
+        _update_sample_period(get_output_data_rate_hz());
+    }
 }
 
 LSM303DLHCAccelerometer::PowerMode LSM303DLHCAccelerometer::get_power_mode()
 {
-    uint8_t val = _i2c_device.read_register(CTRL_REG1_A, 0x08);
+    uint8_t val = _read_config_register(CTRL_REG1_A, 0x08);
     return val ? LOW_POWER_MODE : NORMAL_POWER_MODE;
 }
 
@@ -80,21 +227,13 @@ void LSM303DLHCAccelerometer::set_output_data_rate(OutputDataRate odr)
 
     if (odr == ODR_NONE) {
         // set power down mode
-        _i2c_device.update_register(CTRL_REG1_A, 0x00, 0xF0);
+        _update_config_register(CTRL_REG1_A, 0x00, 0xF0);
     } else {
-        PowerMode power_mode = get_power_mode();
-
-        switch (power_mode) {
-        case NORMAL_POWER_MODE:
-            if (!(odr & 0x01)) {
-                MBED_ERROR(MBED_ERROR_CONFIG_MISMATCH, "Invalid ODR for normal power mode");
-            }
-            break;
-        case LOW_POWER_MODE:
-            if (!(odr & 0x02)) {
-                MBED_ERROR(MBED_ERROR_CONFIG_MISMATCH, "Invalid ODR for low power mode");
-            }
-            break;
+        if (_staging) {
+            // power mode can be changed later, so validate ODR during commit
+            _staged_odr = odr;
+        } else {
+            _validate_odr(get_power_mode(), odr);
         }
 
         if (prev_odr == ODR_NONE) {
@@ -102,13 +241,35 @@ void LSM303DLHCAccelerometer::set_output_data_rate(OutputDataRate odr)
         }
 
         // set ODR and enable axes
-        _i2c_device.update_register(CTRL_REG1_A, (odr & 0xF0) | 0x07, 0xF7);
+        _update_config_register(CTRL_REG1_A, (odr & 0xF0) | 0x07, 0xF7);
+    }
+    if (!_staging) {
+        _update_sample_period(get_output_data_rate_hz(odr));
+    }
+}
+
+void LSM303DLHCAccelerometer::_validate_odr(PowerMode power_mode, OutputDataRate odr)
+{
+    if (odr == ODR_NONE) {
+        return;
+    }
+    switch (power_mode) {
+    case NORMAL_POWER_MODE:
+        if (!(odr & 0x01)) {
+            MBED_ERROR(MBED_ERROR_CONFIG_MISMATCH, "Invalid ODR for normal power mode");
+        }
+        break;
+    case LOW_POWER_MODE:
+        if (!(odr & 0x02)) {
+            MBED_ERROR(MBED_ERROR_CONFIG_MISMATCH, "Invalid ODR for low power mode");
+        }
+        break;
     }
 }
 
 LSM303DLHCAccelerometer::OutputDataRate LSM303DLHCAccelerometer::get_output_data_rate()
 {
-    uint8_t val = _i2c_device.read_register(CTRL_REG1_A, 0xF0);
+    uint8_t val = _read_config_register(CTRL_REG1_A, 0xF0);
     PowerMode power_mode;
     OutputDataRate odr;
 
@@ -143,6 +304,7 @@ LSM303DLHCAccelerometer::OutputDataRate LSM303DLHCAccelerometer::get_output_data
     case 0x90:
         power_mode = get_power_mode();
         odr = power_mode == NORMAL_POWER_MODE ? ODR_1344HZ : ODR_5376HZ;
+        break;
     default:
         MBED_ERROR(MBED_ERROR_INVALID_DATA_DETECTED, "Invalid CTRL_REG1_A value");
     }
@@ -151,72 +313,39 @@ LSM303DLHCAccelerometer::OutputDataRate LSM303DLHCAccelerometer::get_output_data
 
 float LSM303DLHCAccelerometer::get_output_data_rate_hz()
 {
-    float f_odr;
+    return get_output_data_rate_hz(get_output_data_rate());
+}
 
-    switch (get_output_data_rate()) {
-    case LSM303DLHCAccelerometer::ODR_NONE:
-        f_odr = 0;
-        break;
-    case LSM303DLHCAccelerometer::ODR_1HZ:
-        f_odr = 1.0f;
-        break;
-    case LSM303DLHCAccelerometer::ODR_10HZ:
-        f_odr = 10.0f;
-        break;
-    case LSM303DLHCAccelerometer::ODR_25HZ:
-        f_odr = 25.0f;
-        break;
-    case LSM303DLHCAccelerometer::ODR_50HZ:
-        f_odr = 50.0f;
-        break;
-    case LSM303DLHCAccelerometer::ODR_100HZ:
-        f_odr = 100.0f;
-        break;
-    case LSM303DLHCAccelerometer::ODR_200HZ:
-        f_odr = 200.0f;
-        break;
-    case LSM303DLHCAccelerometer::ODR_400HZ:
-        f_odr = 400.0f;
-        break;
-    case LSM303DLHCAccelerometer::ODR_1620HZ:
-        f_odr = 1620.0f;
-        break;
-    case LSM303DLHCAccelerometer::ODR_1344HZ:
-        f_odr = 1344.0f;
-        break;
-    case LSM303DLHCAccelerometer::ODR_5376HZ:
-        f_odr = 5376.0f;
-        break;
-    default:
-        MBED_ERROR(MBED_ERROR_UNKNOWN, "Unreachable code");
+LSM303DLHCAccelerometer::OutputDataRate LSM303DLHCAccelerometer::_decode_odr(uint8_t ctrl_reg1)
+{
+    uint8_t odr_bits = ctrl_reg1 & 0xF0;
+    OutputDataRate odr;
+
+    // append power mode bits to get OutputDataRate value
+    if (odr_bits == 0x00) {
+        odr = ODR_NONE;
+    } else if (odr_bits == 0x80) {
+        odr = ODR_1620HZ;
+    } else if (odr_bits == 0x90) {
+        odr = ctrl_reg1 & 0x08 ? ODR_5376HZ : ODR_1344HZ;
+    } else {
+        odr = (OutputDataRate)(odr_bits | 0x03);
     }
-    return f_odr;
+    return odr;
 }
 
 void LSM303DLHCAccelerometer::set_full_scale(FullScale fs)
 {
-    _i2c_device.update_register(CTRL_REG4_A, fs, 0x30);
-
-    // calculate m/s^2 / lsb
-    switch (fs) {
-    case LSM303DLHCAccelerometer::FULL_SCALE_2G:
-        _sensitivity = 0.001f * GRAVITY_OF_EARTH;
-        break;
-    case LSM303DLHCAccelerometer::FULL_SCALE_4G:
-        _sensitivity = 0.002f * GRAVITY_OF_EARTH;
-        break;
-    case LSM303DLHCAccelerometer::FULL_SCALE_8G:
-        _sensitivity = 0.004f * GRAVITY_OF_EARTH;
-        break;
-    case LSM303DLHCAccelerometer::FULL_SCALE_16G:
-        _sensitivity = 0.012f * GRAVITY_OF_EARTH;
-        break;
+    _update_config_register(CTRL_REG4_A, fs, 0x30);
+    // staged full scale is applied by commit_config
+    if (!_staging) {
+        _set_full_scale(fs);
     }
 }
 
 LSM303DLHCAccelerometer::FullScale LSM303DLHCAccelerometer::get_full_scale()
 {
-    uint8_t value = _i2c_device.read_register(CTRL_REG4_A, 0x30);
+    uint8_t value = _read_config_register(CTRL_REG4_A, 0x30);
     FullScale fs;
 
     switch (value) {
@@ -238,7 +367,7 @@ LSM303DLHCAccelerometer::FullScale LSM303DLHCAccelerometer::get_full_scale()
     return fs;
 }
 
-const float LSM303DLHCAccelerometer::GRAVITY_OF_EARTH = 9.80665f;
+constexpr float LSM303DLHCAccelerometer::GRAVITY_OF_EARTH;
 
 float LSM303DLHCAccelerometer::get_sensitivity()
 {
@@ -248,15 +377,15 @@ float LSM303DLHCAccelerometer::get_sensitivity()
 void LSM303DLHCAccelerometer::set_high_pass_filter_mode(LSM303DLHCAccelerometer::HighPassFilterMode hpf)
 {
     if (hpf == HPF_OFF) {
-        _i2c_device.update_register(CTRL_REG2_A, 0x00, 0x08);
+        _update_config_register(CTRL_REG2_A, 0x00, 0x08);
     } else {
-        _i2c_device.update_register(CTRL_REG2_A, hpf | 0x08, 0x38);
+        _update_config_register(CTRL_REG2_A, hpf | 0x08, 0x38);
     }
 }
 
 LSM303DLHCAccelerometer::HighPassFilterMode LSM303DLHCAccelerometer::get_high_pass_filter_mode()
 {
-    uint8_t val = _i2c_device.read_register(CTRL_REG2_A, 0x38);
+    uint8_t val = _read_config_register(CTRL_REG2_A, 0x38);
     HighPassFilterMode hpf = HPF_OFF;
     if (val & 0x08) {
         switch (val & 0x30) {
@@ -279,31 +408,27 @@ LSM303DLHCAccelerometer::HighPassFilterMode LSM303DLHCAccelerometer::get_high_pa
 
 float LSM303DLHCAccelerometer::get_high_pass_filter_cut_off_frequency()
 {
-    uint8_t val = _i2c_device.read_register(CTRL_REG2_A, 0x30);
-    float hp_c = val >> 4;
-    float f_s = get_output_data_rate_hz();
-
-    float f_cutt_off = -logf(1.0f - 3.0f / (25.0f * powf(2, hp_c))) * f_s / (2 * 3.14159265358979323846f);
-
-    return f_cutt_off;
+    uint8_t val = _read_config_register(CTRL_REG2_A, 0x30);
+    return get_high_pass_filter_cut_off_frequency((HighPassFilterMode)val, get_output_data_rate());
 }
 
 void LSM303DLHCAccelerometer::set_fifo_mode(LSM303DLHCAccelerometer::FIFOMode mode)
 {
     if (mode) {
-        _i2c_device.update_register(FIFO_CTRL_REG_A, 0x80, 0xC0); // configure FIFO stream mode
-        _i2c_device.update_register(CTRL_REG5_A, 0x40, 0x40); // enable FIFO
+        _update_config_register(FIFO_CTRL_REG_A, 0x80, 0xC0); // configure FIFO stream mode
+        _update_config_register(CTRL_REG5_A, 0x40, 0x40); // enable FIFO
     } else {
-        _i2c_device.update_register(CTRL_REG5_A, 0x00, 0x40); // disabled FIFO
-        _i2c_device.update_register(FIFO_CTRL_REG_A, 0x00, 0xC0); // configure FIFO bypass mode
+        _update_config_register(CTRL_REG5_A, 0x00, 0x40); // disabled FIFO
+        _update_config_register(FIFO_CTRL_REG_A, 0x00, 0xC0); // configure FIFO bypass mode
     }
+    _fifo_enabled = mode == FIFO_ENABLE;
     // update drdy interrupt
     _process_interrupt_register(2);
 }
 
 LSM303DLHCAccelerometer::FIFOMode LSM303DLHCAccelerometer::get_fifo_mode()
 {
-    uint8_t fifo_mode = _i2c_device.read_register(CTRL_REG5_A, 0x40);
+    uint8_t fifo_mode = _read_config_register(CTRL_REG5_A, 0x40);
     if (fifo_mode) {
         return FIFO_ENABLE;
     } else {
@@ -316,12 +441,14 @@ void LSM303DLHCAccelerometer::set_fifo_watermark(int watermark)
     if (watermark < 0 || watermark >= 32) {
         MBED_ERROR(MBED_ERROR_INVALID_ARGUMENT, "Invalid watermark value");
     }
-    _i2c_device.update_register(FIFO_CTRL_REG_A, watermark, 0x1F);
+    _update_config_register(FIFO_CTRL_REG_A, watermark, 0x1F);
+    _fifo_watermark = watermark;
 }
 
 int LSM303DLHCAccelerometer::get_fifo_watermark()
 {
-    return _i2c_device.read_register(FIFO_CTRL_REG_A, 0x1F);
+    _fifo_watermark = _read_config_register(FIFO_CTRL_REG_A, 0x1F);
+    return _fifo_watermark;
 }
 
 void LSM303DLHCAccelerometer::clear_fifo()
@@ -345,37 +472,1176 @@ LSM303DLHCAccelerometer::DatadaReadyInterruptMode LSM303DLHCAccelerometer::get_d
     return _process_interrupt_register(3);
 }
 
+void LSM303DLHCAccelerometer::set_overrun_interrupt_mode(LSM303DLHCAccelerometer::OverrunInterruptMode ovrn_mode)
+{
+    _update_config_register(CTRL_REG3_A, ovrn_mode == OVRN_ENABLE ? 0x02 : 0x00, 0x02);
+}
+
+LSM303DLHCAccelerometer::OverrunInterruptMode LSM303DLHCAccelerometer::get_overrun_interrupt_mode()
+{
+    return _read_config_register(CTRL_REG3_A, 0x02) ? OVRN_ENABLE : OVRN_DISABLE;
+}
+
 void LSM303DLHCAccelerometer::set_high_resolution_output_mode(HighResolutionOutputMode hro)
 {
-    _i2c_device.update_register(CTRL_REG4_A, hro == HRO_ENABLED ? 0x08 : 0x00, 0x08);
+    _update_config_register(CTRL_REG4_A, hro == HRO_ENABLED ? 0x08 : 0x00, 0x08);
 }
 
 LSM303DLHCAccelerometer::HighResolutionOutputMode LSM303DLHCAccelerometer::get_high_resolution_output_mode()
 {
-    return _i2c_device.read_register(CTRL_REG4_A, 0x08) ? HRO_ENABLED : HRO_DISABLED;
+    return _read_config_register(CTRL_REG4_A, 0x08) ? HRO_ENABLED : HRO_DISABLED;
 }
 
 void LSM303DLHCAccelerometer::read_data(float data[3])
 {
-    int16_t data_16[3];
-    read_data_16(data_16);
+    // reuse output buffer for raw data and convert it as block with one sample
+    read_data_16((int16_t *)data);
+    _convert_block((float(*)[3])data, 1, _sensitivity);
+}
+
+void LSM303DLHCAccelerometer::set_offset(const float offset[3])
+{
+    _offset_enabled = offset != nullptr;
+    for (int i = 0; i < 3; i++) {
+        // zero offset is used if compensation is disabled, so conversion doesn't need any branches
+        _offset[i] = _offset_enabled ? offset[i] : 0.0f;
+    }
+    _update_offset_mg();
+}
+
+bool LSM303DLHCAccelerometer::get_offset(float offset[3])
+{
+    if (_offset_enabled) {
+        memcpy(offset, _offset, sizeof(_offset));
+    }
+    return _offset_enabled;
+}
+
+void LSM303DLHCAccelerometer::set_calibration(const Calibration *cal)
+{
+    _cal_enabled = cal != nullptr;
+    if (_cal_enabled) {
+        _cal = *cal;
+    }
+}
+
+bool LSM303DLHCAccelerometer::get_calibration(Calibration *cal)
+{
+    if (_cal_enabled) {
+        *cal = _cal;
+    }
+    return _cal_enabled;
+}
+
+void LSM303DLHCAccelerometer::_set_orientation(const int8_t matrix[3][3])
+{
+    _orientation_enabled = false;
     for (int i = 0; i < 3; i++) {
-        data[i] = data_16[i] * _sensitivity;
+        for (int j = 0; j < 3; j++) {
+            _orientation[i][j] = matrix[i][j];
+            _orientation_enabled = _orientation_enabled || matrix[i][j] != (i == j ? 1 : 0);
+        }
+    }
+    _update_offset_mg();
+}
+
+void LSM303DLHCAccelerometer::_update_offset_mg()
+{
+    // R (a - R^T u) = R a - u, as the rotation matrix is orthogonal
+    for (int j = 0; j < 3; j++) {
+        float offset = 0.0f;
+        for (int i = 0; i < 3; i++) {
+            offset += _orientation[i][j] * _offset[i];
+        }
+        _offset_mg[j] = (int16_t)lroundf(offset / (0.001f * GRAVITY_OF_EARTH));
+    }
+}
+
+void LSM303DLHCAccelerometer::_correct_data_16(int16_t data[3], float sensitivity)
+{
+    if (!_cal_enabled && !_offset_enabled && !_orientation_enabled) {
+        return;
+    }
+    // reuse float conversion as block with one sample
+    float sample[1][3];
+    memcpy(sample[0], data, 3 * sizeof(int16_t));
+    _convert_block(sample, 1, sensitivity);
+    for (int i = 0; i < 3; i++) {
+        long value = lroundf(sample[0][i] / sensitivity);
+        data[i] = (int16_t)(value > INT16_MAX ? INT16_MAX : value < INT16_MIN ? INT16_MIN : value);
     }
 }
 
 void LSM303DLHCAccelerometer::read_data_16(int16_t data[3])
 {
-    uint8_t raw_data[6];
-    _i2c_device.read_registers(OUT_X_L_A | 0x80, raw_data, 6);
+    // read STATUS_REG_A together with data, as it's next to the output registers
+    uint8_t raw_data[7];
+    _i2c_device.read_registers(STATUS_REG_A | 0x80, raw_data, 7);
     // data layout
     // - output resolution 12 bit
     // - assume that LSB is lower address, as it's default value
     //   note: the byte order is controlled by CTRL_REG4_A
     // - the value is left-justified, so we need to shift it to right
-    data[0] = (int16_t)(raw_data[1] << 8 | raw_data[0]) >> 4; // X axis
-    data[1] = (int16_t)(raw_data[3] << 8 | raw_data[2]) >> 4; // Y axis
-    data[2] = (int16_t)(raw_data[5] << 8 | raw_data[4]) >> 4; // Z axis
+    data[0] = (int16_t)(raw_data[2] << 8 | raw_data[1]) >> 4; // X axis
+    data[1] = (int16_t)(raw_data[4] << 8 | raw_data[3]) >> 4; // Y axis
+    data[2] = (int16_t)(raw_data[6] << 8 | raw_data[5]) >> 4; // Z axis
+
+    // ZYXOR flag is meaningful only in the bypass mode, FIFO overruns are checked by read_fifo_data_16
+    if (!_fifo_enabled) {
+        _account_read(1, 1, raw_data[0] & 0x80);
+    }
+}
+
+int LSM303DLHCAccelerometer::read_fifo_data(float data[][3], int size, BlockInfo *info)
+{
+    BlockInfo block_info;
+    // reuse output buffer for raw data, as sizeof(float) >= sizeof(int16_t)
+    int n = read_fifo_data_16((int16_t(*)[3])data, size, &block_info);
+    // note: full scale can be changed during reading, so use block sensitivity
+    _convert_block(data, n, block_info.sensitivity);
+    if (info) {
+        *info = block_info;
+    }
+    return n;
+}
+
+void LSM303DLHCAccelerometer::read_data_mg(int16_t data[3])
+{
+    const int32_t scale = _sensitivity_mg << 16;
+    const int32_t axes_scale[3] = { scale, scale, scale };
+    read_data_16(data);
+    convert_raw_block_fixed((int16_t(*)[3])data, (int16_t(*)[3])data, 1, axes_scale, _offset_mg);
+    if (_orientation_enabled) {
+        rotate_block((int16_t(*)[3])data, 1, _orientation);
+    }
+}
+
+int LSM303DLHCAccelerometer::read_fifo_data_mg(int16_t data[][3], int size, BlockInfo *info)
+{
+    BlockInfo block_info;
+    int n = read_fifo_data_16(data, size, &block_info);
+    // note: full scale can be changed during reading, so use block sensitivity
+    const int32_t scale = _sensitivity_to_mg(block_info.sensitivity) << 16;
+    const int32_t axes_scale[3] = { scale, scale, scale };
+    convert_raw_block_fixed(data, data, n, axes_scale, _offset_mg);
+    if (_orientation_enabled) {
+        rotate_block(data, n, _orientation);
+    }
+    if (info) {
+        *info = block_info;
+    }
+    return n;
+}
+
+SampleSpan<int16_t> LSM303DLHCAccelerometer::read_fifo_block(const SampleSpan<int16_t> &buffer, BlockInfo *info)
+{
+    return buffer.subspan(0, read_fifo_data_16(buffer.data, buffer.size, info));
+}
+
+SampleSpan<float> LSM303DLHCAccelerometer::read_fifo_block(const SampleSpan<float> &buffer, BlockInfo *info)
+{
+    return buffer.subspan(0, read_fifo_data(buffer.data, buffer.size, info));
+}
+
+SampleSpan<MilliUnits> LSM303DLHCAccelerometer::read_fifo_block(const SampleSpan<MilliUnits> &buffer, BlockInfo *info)
+{
+    // MilliUnits has the same layout as int16_t
+    return buffer.subspan(0, read_fifo_data_mg((int16_t(*)[3])buffer.data, buffer.size, info));
+}
+
+void LSM303DLHCAccelerometer::_set_full_scale(FullScale fs)
+{
+    _full_scale = fs;
+    _sensitivity = get_full_scale_sensitivity(fs);
+    _sensitivity_mg = get_full_scale_sensitivity_mg(fs);
+}
+
+int LSM303DLHCAccelerometer::_sensitivity_to_mg(float sensitivity)
+{
+    return (int)lroundf(sensitivity / (0.001f * GRAVITY_OF_EARTH));
+}
+
+int LSM303DLHCAccelerometer::read_fifo_data_16(int16_t data[][3], int size, BlockInfo *info)
+{
+    // FIFO content is read directly into the output buffer and is decoded in place,
+    // as the raw sample and decoded sample have the same size
+    uint8_t *raw_data = (uint8_t *)data;
+
+    // FIFO_SRC_REG_A bits:
+    // 0bx0000000 - WTM - FIFO content exceeds watermark level
+    // 0b0x000000 - OVRN_FIFO - FIFO is full (32 unread samples), the next sample overwrites the oldest one
+    // 0b00x00000 - EMPTY - FIFO is empty
+    // 0b000xxxxx - FSS - number of unread samples
+    uint8_t fifo_src = _i2c_device.read_register(FIFO_SRC_REG_A);
+    us_timestamp_t drain_time = ticker_read_us(get_us_ticker_data());
+    bool overrun = fifo_src & 0x40;
+    int available = 0;
+    if (!(fifo_src & 0x20)) {
+        available = (fifo_src & 0x1F) + (overrun ? 1 : 0);
+    }
+    int n = available < size ? available : size;
+    float sensitivity = _sensitivity;
+    bool pending_block = false;
+    if (_ar_pending_samples > 0) {
+        if (overrun) {
+            // samples with previous full scale have been overwritten
+            _ar_pending_samples = 0;
+            _ar_next_pending_samples = 0;
+        } else {
+            // return samples with previous full scale as separate block
+            if (n > _ar_pending_samples) {
+                n = _ar_pending_samples;
+            }
+            _ar_pending_samples -= n;
+            sensitivity = _ar_pending_sensitivity;
+            pending_block = true;
+            if (_ar_pending_samples == 0) {
+                // the next block is samples of the previous stream configuration if any
+                _ar_pending_samples = _ar_next_pending_samples;
+                _ar_pending_sensitivity = _ar_next_pending_sensitivity;
+                _ar_next_pending_samples = 0;
+            }
+        }
+    }
+    if (n > 0) {
+        // the register address rolls back to OUT_X_L_A after OUT_Z_H_A, so FIFO can be read with one transaction
+        _i2c_device.read_registers(OUT_X_L_A | 0x80, raw_data, n * 6);
+    }
+    for (int i = 0; i < n; i++) {
+        uint8_t *sample = raw_data + i * 6;
+        data[i][0] = (int16_t)(sample[1] << 8 | sample[0]) >> 4; // X axis
+        data[i][1] = (int16_t)(sample[3] << 8 | sample[2]) >> 4; // Y axis
+        data[i][2] = (int16_t)(sample[5] << 8 | sample[4]) >> 4; // Z axis
+    }
+
+    BlockInfo block_info;
+    block_info.samples = n;
+    block_info.overrun = overrun;
+    block_info.untagged_samples = 0;
+    // samples that have been left in FIFO by the previous block reduce free space
+    block_info.lost_samples = _account_read(n, FIFO_SIZE - _prev_block_left_samples, overrun);
+    block_info.sensitivity = sensitivity;
+    us_timestamp_t edge_time = _process_block_timestamps(&block_info, drain_time, available - n);
+    if (_odrg_enabled && !pending_block) {
+        _update_odr_governor(data, n, available - n);
+    }
+    if (_ar_enabled && !pending_block) {
+        _update_auto_range(data, n);
+    }
+    if (_awm_enabled) {
+        _update_adaptive_watermark(overrun, edge_time && drain_time > edge_time ? (uint32_t)(drain_time - edge_time) : 0);
+    }
+    if (info) {
+        *info = block_info;
+    }
+    return n;
+}
+
+// contiguous groups of the configuration registers: first register and number of registers
+static const uint8_t config_register_groups[][2] = {
+    // note: REFERENCE_A is skipped, as its reading resets high-pass filter
+    { LSM303DLHCAccelerometer::CTRL_REG1_A, 6 }, // CTRL_REG1_A - CTRL_REG6_A
+    { LSM303DLHCAccelerometer::FIFO_CTRL_REG_A, 1 },
+    { LSM303DLHCAccelerometer::INT1_CFG_A, 1 },
+    { LSM303DLHCAccelerometer::INT1_THS_A, 3 }, // INT1_THS_A - INT2_CFG_A
+    { LSM303DLHCAccelerometer::INT2_THS_A, 3 }, // INT2_THS_A - CLICK_CFG_A
+    { LSM303DLHCAccelerometer::CLICK_THS_A, 4 }, // CLICK_THS_A - TIME_WINDOW_A
+};
+static const int config_register_groups_num = sizeof(config_register_groups) / sizeof(config_register_groups[0]);
+
+void LSM303DLHCAccelerometer::save_config(ConfigSnapshot *config)
+{
+    memset(config->regs, 0, sizeof(config->regs));
+    for (int i = 0; i < config_register_groups_num; i++) {
+        uint8_t reg = config_register_groups[i][0];
+        _i2c_device.read_registers(reg | 0x80, config->regs + (reg - CTRL_REG1_A), config_register_groups[i][1]);
+    }
+}
+
+void LSM303DLHCAccelerometer::restore_config(const ConfigSnapshot &config)
+{
+    uint8_t regs[sizeof(config.regs)];
+    memcpy(regs, config.regs, sizeof(regs));
+    // don't reboot memory content
+    regs[CTRL_REG5_A - CTRL_REG1_A] &= ~0x80;
+
+    // write control registers last
+    for (int i = config_register_groups_num - 1; i >= 0; i--) {
+        uint8_t reg = config_register_groups[i][0];
+        _i2c_device.write_registers(reg | 0x80, regs + (reg - CTRL_REG1_A), config_register_groups[i][1]);
+    }
+
+    // update cached state
+    _bc_state = BCS_DISABLED;
+    _odrg_enabled = false;
+    _ar_enabled = false;
+    _ar_pending_samples = 0;
+    _ar_next_pending_samples = 0;
+    _set_full_scale((FullScale)(regs[CTRL_REG4_A - CTRL_REG1_A] & 0x30));
+    _fifo_enabled = regs[CTRL_REG5_A - CTRL_REG1_A] & 0x40;
+    _fifo_watermark = regs[FIFO_CTRL_REG_A - CTRL_REG1_A] & 0x1F;
+    _update_sample_period(get_output_data_rate_hz(_decode_odr(regs[0])));
+}
+
+void LSM303DLHCAccelerometer::_apply_register_image(const uint8_t ctrl_regs[], uint8_t fifo_ctrl, float odr_hz)
+{
+    // the register image replaces any staged changes
+    _staging = false;
+    _staged_dirty = 0;
+
+    // FIFO mode should be configured before FIFO enabling
+    _i2c_device.write_register(FIFO_CTRL_REG_A, fifo_ctrl);
+    _i2c_device.write_registers(CTRL_REG1_A | 0x80, ctrl_regs, CTRL_REG6_A - CTRL_REG1_A + 1);
+
+    // update cached state
+    _bc_state = BCS_DISABLED;
+    _odrg_enabled = false;
+    _ar_enabled = false;
+    _ar_pending_samples = 0;
+    _ar_next_pending_samples = 0;
+    _set_full_scale((FullScale)(ctrl_regs[CTRL_REG4_A - CTRL_REG1_A] & 0x30));
+    _fifo_enabled = ctrl_regs[CTRL_REG5_A - CTRL_REG1_A] & 0x40;
+    _fifo_watermark = fifo_ctrl & 0x1F;
+    _update_sample_period(odr_hz);
+    if (ctrl_regs[CTRL_REG3_A - CTRL_REG1_A] & 0x1C) {
+        // reset pending interrupt request
+        _clear_data();
+    }
+}
+
+void LSM303DLHCAccelerometer::get_stream_config(StreamConfig *config)
+{
+    uint8_t ctrl_regs[4];
+    _i2c_device.read_registers(CTRL_REG1_A | 0x80, ctrl_regs, 4);
+    config->odr = _decode_odr(ctrl_regs[0]);
+    config->full_scale = (FullScale)(ctrl_regs[3] & 0x30);
+    config->hro = ctrl_regs[3] & 0x08 ? HRO_ENABLED : HRO_DISABLED;
+}
+
+int LSM303DLHCAccelerometer::reconfigure_stream(const StreamConfig &config, int16_t data[][3], int size, BlockInfo *info)
+{
+    us_timestamp_t start_time = ticker_read_us(get_us_ticker_data());
+    uint8_t ctrl_regs[4];
+    BlockInfo block_info;
+    BlockInfo tail_info;
+
+    // drain samples that are produced with current configuration
+    bool ar_pending_block = _ar_pending_samples > 0;
+    int n = read_fifo_data_16(data, size, &block_info);
+    // the pending block of the auto range mode is dropped on overrun
+    ar_pending_block = ar_pending_block && !block_info.overrun;
+    float prev_sensitivity = _sensitivity;
+
+    // update CTRL_REG1_A - CTRL_REG4_A with one read and one write transaction
+    _i2c_device.read_registers(CTRL_REG1_A | 0x80, ctrl_regs, 4);
+    uint8_t ctrl_reg1 = ctrl_regs[0];
+    if (config.odr != ODR_NONE) {
+        _validate_odr(ctrl_regs[0] & 0x08 ? LOW_POWER_MODE : NORMAL_POWER_MODE, config.odr);
+        ctrl_regs[0] = (ctrl_regs[0] & ~0xF7) | (config.odr & 0xF0) | 0x07;
+    } else {
+        ctrl_regs[0] &= ~0xF0;
+    }
+    ctrl_regs[3] = (ctrl_regs[3] & ~0x38) | config.full_scale | (config.hro == HRO_ENABLED ? 0x08 : 0x00);
+
+    // Count samples that have been generated after drain or haven't fit into data right before register update.
+    // The sensor is powered down first, so the FIFO level cannot change before the new configuration is written,
+    // even if the sample period is comparable with bus transaction time.
+    int prev_samples = 0;
+    if (_fifo_enabled) {
+        _i2c_device.write_register(CTRL_REG1_A, ctrl_reg1 & ~0xF0);
+        uint8_t fifo_src = _i2c_device.read_register(FIFO_SRC_REG_A);
+        if (!(fifo_src & 0x20)) {
+            prev_samples = (fifo_src & 0x1F) + (fifo_src & 0x40 ? 1 : 0);
+        }
+    }
+    _i2c_device.write_registers(CTRL_REG1_A | 0x80, ctrl_regs, 4);
+
+    if (prev_samples > 0 && _ar_pending_samples == 0) {
+        // return samples of the previous configuration as pending block like after auto range switch,
+        // so they keep previous sensitivity even if they aren't drained now
+        _ar_pending_samples = prev_samples;
+        _ar_pending_sensitivity = prev_sensitivity;
+        if (!ar_pending_block && n < size) {
+            // the pending samples have the same sensitivity as drained ones, so append them to the block
+            int tail_n = read_fifo_data_16(data + n, size - n, &tail_info);
+            block_info.lost_samples += tail_info.lost_samples;
+            if (tail_info.overrun) {
+                // the pending samples have been overwritten, so the tail can contain samples of new configuration
+                block_info.overrun = true;
+                block_info.lost_samples += tail_n;
+            } else {
+                n += tail_n;
+            }
+            block_info.samples = n;
+        }
+    } else if (prev_samples > _ar_pending_samples) {
+        // the samples of the previous configuration follow outstanding pending block
+        if (_ar_next_pending_samples == 0) {
+            _ar_next_pending_samples = prev_samples - _ar_pending_samples;
+            _ar_next_pending_sensitivity = prev_sensitivity;
+        } else {
+            block_info.untagged_samples = prev_samples - _ar_pending_samples - _ar_next_pending_samples;
+        }
+    }
+
+    _set_full_scale(config.full_scale);
+    _update_sample_period(get_output_data_rate_hz(config.odr));
+
+    _reconfiguration_time = (uint32_t)(ticker_read_us(get_us_ticker_data()) - start_time);
+    if (info) {
+        *info = block_info;
+    }
+    return n;
+}
+
+int LSM303DLHCAccelerometer::reconfigure_stream(const StreamConfig &config, float data[][3], int size, BlockInfo *info)
+{
+    BlockInfo block_info;
+    // reuse output buffer for raw data, as sizeof(float) >= sizeof(int16_t)
+    int n = reconfigure_stream(config, (int16_t(*)[3])data, size, &block_info);
+    _convert_block(data, n, block_info.sensitivity);
+    if (info) {
+        *info = block_info;
+    }
+    return n;
+}
+
+void LSM303DLHCAccelerometer::set_adaptive_watermark_mode(AdaptiveWatermarkMode mode, uint32_t latency_target)
+{
+    _awm_enabled = mode == AWM_ENABLE;
+    _awm_latency_target = latency_target;
+    _awm_service_latency = 0;
+    _awm_processing_time = 0;
+    _awm_reported_processing_time = 0;
+    _awm_overrun_backoff = 0;
+    _awm_clean_blocks = 0;
+}
+
+LSM303DLHCAccelerometer::AdaptiveWatermarkMode LSM303DLHCAccelerometer::get_adaptive_watermark_mode()
+{
+    return _awm_enabled ? AWM_ENABLE : AWM_DISABLE;
+}
+
+void LSM303DLHCAccelerometer::report_block_processing_time(uint32_t processing_time)
+{
+    if (processing_time > _awm_reported_processing_time) {
+        _awm_reported_processing_time = processing_time;
+    }
+}
+
+uint32_t LSM303DLHCAccelerometer::get_reconfiguration_time_us()
+{
+    return _reconfiguration_time;
+}
+
+void LSM303DLHCAccelerometer::mark_watermark_interrupt()
+{
+    _wtm_edge_time = ticker_read_us(get_us_ticker_data());
+}
+
+float LSM303DLHCAccelerometer::get_estimated_output_data_rate_hz()
+{
+    return _sample_period > 0 ? 1e6f / _sample_period : 0.0f;
+}
+
+void LSM303DLHCAccelerometer::reset_output_data_rate_estimation()
+{
+    CriticalSectionLock lock;
+    _wtm_edge_time = 0;
+    _prev_wtm_edge_time = 0;
+    _prev_block_samples = 0;
+    _prev_block_left_samples = 0;
+    _period_measurements = 0;
+    _sample_period = _nominal_sample_period;
+}
+
+void LSM303DLHCAccelerometer::get_loss_statistics(LossStatistics *stats)
+{
+    *stats = _loss_stats;
+}
+
+void LSM303DLHCAccelerometer::reset_loss_statistics()
+{
+    memset(&_loss_stats, 0, sizeof(_loss_stats));
+    _last_read_time = 0;
+}
+
+int LSM303DLHCAccelerometer::_account_read(int samples, int capacity, bool overrun)
+{
+    us_timestamp_t now = ticker_read_us(get_us_ticker_data());
+    int lost_samples = 0;
+
+    if (overrun && capacity <= 1) {
+        // ZYXOR: new sample has overwritten unread one, the rest is estimated from time since previous read
+        lost_samples = 1;
+    }
+    if (overrun && capacity > 1) {
+        // OVRN_FIFO only means that FIFO is full, so it's drained in time if it's full exactly now
+        _loss_stats.full_reads++;
+    }
+    if (overrun && _last_read_time && _sample_period > 0) {
+        // the fractional part is ignored, so the drain jitter less than one sample period isn't reported as loss
+        float produced = (now - _last_read_time) / _sample_period;
+        int expected_lost = (int)(produced - capacity);
+        if (expected_lost > lost_samples) {
+            lost_samples = expected_lost;
+        }
+    }
+    if (lost_samples > 0) {
+        _loss_stats.overruns++;
+        _loss_stats.lost_samples += lost_samples;
+    }
+    _loss_stats.reads++;
+    _loss_stats.samples += samples;
+    _last_read_time = now;
+
+    return lost_samples;
+}
+
+void LSM303DLHCAccelerometer::_update_sample_period(float odr_hz)
+{
+    if (_staging) {
+        // the sample period is updated during configuration commit
+        return;
+    }
+    float nominal_sample_period = odr_hz > 0 ? 1e6f / odr_hz : 0.0f;
+    if (nominal_sample_period != _nominal_sample_period) {
+        _nominal_sample_period = nominal_sample_period;
+        reset_output_data_rate_estimation();
+    }
+}
+
+us_timestamp_t LSM303DLHCAccelerometer::_process_block_timestamps(BlockInfo *info, us_timestamp_t drain_time, int left_samples)
+{
+    // maximal relative deviation of the measured period from the nominal one
+    const float max_period_deviation = 0.1f;
+    // minimal weight of new period measurement
+    const float min_period_weight = 1.0f / 16.0f;
+
+    if (info->samples <= 0) {
+        // keep watermark edge for the next block
+        info->sample_period = _sample_period;
+        info->timestamp = drain_time;
+        return 0;
+    }
+
+    us_timestamp_t edge_time;
+    {
+        CriticalSectionLock lock;
+        edge_time = _wtm_edge_time;
+        _wtm_edge_time = 0;
+    }
+
+    // if the previous block reading hasn't drained FIFO, the watermark level could remain exceeded,
+    // so the number of samples between edges is unknown and the edge pair is skipped
+    if (edge_time && !info->overrun && _prev_wtm_edge_time && _prev_block_samples > 0 && _prev_block_left_samples == 0 && _nominal_sample_period > 0) {
+        // samples between two watermark edges are equal to the previous block size,
+        // as every block starts right after the previous one
+        float period = (float)(edge_time - _prev_wtm_edge_time) / _prev_block_samples;
+        float deviation = (period - _nominal_sample_period) / _nominal_sample_period;
+        if (deviation < max_period_deviation && deviation > -max_period_deviation) {
+            _period_measurements++;
+            float weight = 1.0f / _period_measurements;
+            if (weight < min_period_weight) {
+                weight = min_period_weight;
+            }
+            _sample_period += (period - _sample_period) * weight;
+        }
+    }
+
+    info->sample_period = _sample_period;
+    if (edge_time) {
+        // watermark flag is set when FIFO content exceeds watermark level,
+        // so the edge corresponds to the sample with index equal to watermark
+        int edge_index = _fifo_watermark < info->samples ? _fifo_watermark : info->samples - 1;
+        info->timestamp = edge_time - (us_timestamp_t)(edge_index * _sample_period + 0.5f);
+    } else {
+        // the last sample was generated before FIFO drain
+        info->timestamp = drain_time - (us_timestamp_t)((info->samples - 1) * _sample_period + 0.5f);
+    }
+
+    // keep edge chain only if it's continuous
+    _prev_wtm_edge_time = info->overrun ? 0 : edge_time;
+    _prev_block_samples = info->samples;
+    _prev_block_left_samples = left_samples;
+
+    return edge_time;
+}
+
+void LSM303DLHCAccelerometer::_update_adaptive_watermark(bool overrun, uint32_t service_latency)
+{
+    // overrun backoff step and its limit
+    const int overrun_backoff_step = 4;
+    const int max_overrun_backoff = 16;
+    // number of blocks without overruns to decrease backoff
+    const int backoff_decay_blocks = 16;
+
+    if (_sample_period <= 0) {
+        return;
+    }
+
+    // track peaks of the interrupt service latency and consumer processing time with slow decay
+    _awm_service_latency -= _awm_service_latency / 16;
+    if (service_latency > _awm_service_latency) {
+        _awm_service_latency = service_latency;
+    }
+    _awm_processing_time -= _awm_processing_time / 16;
+    if (_awm_reported_processing_time > _awm_processing_time) {
+        _awm_processing_time = _awm_reported_processing_time;
+    }
+    _awm_reported_processing_time = 0;
+
+    if (overrun) {
+        _awm_overrun_backoff += overrun_backoff_step;
+        if (_awm_overrun_backoff > max_overrun_backoff) {
+            _awm_overrun_backoff = max_overrun_backoff;
+        }
+        _awm_clean_blocks = 0;
+    } else if (_awm_overrun_backoff > 0 && ++_awm_clean_blocks >= backoff_decay_blocks) {
+        _awm_overrun_backoff--;
+        _awm_clean_blocks = 0;
+    }
+
+    // samples that are generated while the consumer is woken up and processes the block
+    float busy_time = (float)_awm_service_latency + (float)_awm_processing_time;
+    int busy_samples = (int)(busy_time / _sample_period) + 1;
+
+    // keep at least twice busy time as FIFO headroom
+    int watermark = FIFO_SIZE - 1 - 2 * busy_samples - _awm_overrun_backoff;
+    if (_awm_latency_target > 0) {
+        // the first sample of a block waits for whole block, wakeup and processing
+        int latency_watermark = (int)(((float)_awm_latency_target - busy_time) / _sample_period) - 1;
+        if (latency_watermark < watermark) {
+            watermark = latency_watermark;
+        }
+    }
+    if (watermark < 1) {
+        watermark = 1;
+    } else if (watermark > FIFO_SIZE - 1) {
+        watermark = FIFO_SIZE - 1;
+    }
+
+    if (watermark != _fifo_watermark) {
+        _i2c_device.update_register(FIFO_CTRL_REG_A, watermark, 0x1F);
+        _fifo_watermark = watermark;
+    }
+}
+
+void LSM303DLHCAccelerometer::start_burst_capture(const BurstCaptureConfig &config)
+{
+    if (!(config.idle_odr & 0x02) || config.idle_odr == ODR_NONE) {
+        MBED_ERROR(MBED_ERROR_CONFIG_MISMATCH, "Invalid ODR for low power mode");
+    }
+    if (config.capture_odr == ODR_NONE) {
+        MBED_ERROR(MBED_ERROR_INVALID_ARGUMENT, "Capture ODR isn't set");
+    }
+    if (config.watermark < 0 || config.watermark >= FIFO_SIZE) {
+        MBED_ERROR(MBED_ERROR_INVALID_ARGUMENT, "Invalid watermark value");
+    }
+    bool capture_normal_mode = config.capture_odr & 0x01;
+    float sensitivity = get_full_scale_sensitivity(config.full_scale);
+
+    // INT1_THS_A resolution depends on full scale
+    float threshold_lsb;
+    switch (config.full_scale) {
+    case FULL_SCALE_2G:
+        threshold_lsb = 0.016f * GRAVITY_OF_EARTH;
+        break;
+    case FULL_SCALE_4G:
+        threshold_lsb = 0.032f * GRAVITY_OF_EARTH;
+        break;
+    case FULL_SCALE_8G:
+        threshold_lsb = 0.062f * GRAVITY_OF_EARTH;
+        break;
+    default:
+        threshold_lsb = 0.186f * GRAVITY_OF_EARTH;
+        break;
+    }
+    int threshold = (int)(config.wakeup_threshold / threshold_lsb + 0.5f);
+    if (threshold < 1) {
+        threshold = 1;
+    } else if (threshold > 0x7F) {
+        threshold = 0x7F;
+    }
+
+    // keep overrun interrupt settings
+    uint8_t overrun_int = _i2c_device.read_register(CTRL_REG3_A, 0x02);
+
+    // idle state:
+    // - low power mode
+    // - high-pass filter for the INT1 generator only
+    // - INT1 AOI interrupt with latching
+    _bc_idle_ctrl_regs[0] = (config.idle_odr & 0xF0) | 0x08 | 0x07;
+    _bc_idle_ctrl_regs[1] = 0x30 | 0x01;
+    _bc_idle_ctrl_regs[2] = 0x40;
+    _bc_idle_ctrl_regs[3] = config.full_scale;
+    _bc_idle_ctrl_regs[4] = 0x08;
+    _bc_idle_ctrl_regs[5] = 0x00;
+    // capture state:
+    // - normal high resolution mode or low power mode
+    // - FIFO stream mode with watermark interrupt
+    _bc_capture_ctrl_regs[0] = (config.capture_odr & 0xF0) | (capture_normal_mode ? 0x00 : 0x08) | 0x07;
+    _bc_capture_ctrl_regs[1] = 0x00;
+    _bc_capture_ctrl_regs[2] = 0x04 | overrun_int;
+    _bc_capture_ctrl_regs[3] = config.full_scale | (capture_normal_mode ? 0x08 : 0x00);
+    _bc_capture_ctrl_regs[4] = 0x40;
+    _bc_capture_ctrl_regs[5] = 0x00;
+    _bc_capture_fifo_ctrl = 0x80 | config.watermark;
+
+    _bc_idle_sample_period = 1e6f / get_output_data_rate_hz(config.idle_odr);
+    _bc_capture_sample_period = 1e6f / get_output_data_rate_hz(config.capture_odr);
+    _bc_max_samples = (int)(config.capture_duration * 1e3f / _bc_capture_sample_period);
+    _bc_quiescent_samples = (int)(config.quiescent_duration * 1e3f / _bc_capture_sample_period);
+    _bc_quiescent_threshold = (int16_t)(config.quiescent_threshold / sensitivity);
+
+    // configure wakeup interrupt: OR combination of X/Y/Z high events
+    uint8_t int1_regs[2] = { (uint8_t)threshold, 0x00 };
+    _i2c_device.write_register(INT1_CFG_A, 0x2A);
+    _i2c_device.write_registers(INT1_THS_A | 0x80, int1_regs, 2);
+
+    _set_full_scale(config.full_scale);
+    _bc_enter_idle();
+}
+
+void LSM303DLHCAccelerometer::stop_burst_capture()
+{
+    if (_bc_state == BCS_DISABLED) {
+        return;
+    }
+    if (_bc_state == BCS_CAPTURE) {
+        // restore idle register image and cached FIFO state
+        _bc_enter_idle();
+    }
+    _i2c_device.write_register(CTRL_REG3_A, 0x00);
+    _i2c_device.write_register(INT1_CFG_A, 0x00);
+    _i2c_device.read_register(INT1_SOURCE_A);
+    _bc_state = BCS_DISABLED;
+}
+
+LSM303DLHCAccelerometer::BurstCaptureState LSM303DLHCAccelerometer::get_burst_capture_state()
+{
+    return _bc_state;
+}
+
+int LSM303DLHCAccelerometer::process_burst_capture(int16_t data[][3], int size, BlockInfo *info)
+{
+    int n = 0;
+
+    switch (_bc_state) {
+    case BCS_DISABLED:
+        break;
+    case BCS_IDLE:
+        _bc_enter_capture();
+        break;
+    case BCS_CAPTURE:
+        n = read_fifo_data_16(data, size, info);
+        _bc_captured_samples += n;
+
+        if (_bc_quiescent_samples > 0 && n > 0) {
+            // check acceleration range of the block
+            int16_t min_val[3] = { data[0][0], data[0][1], data[0][2] };
+            int16_t max_val[3] = { data[0][0], data[0][1], data[0][2] };
+            for (int i = 1; i < n; i++) {
+                for (int j = 0; j < 3; j++) {
+                    if (data[i][j] < min_val[j]) {
+                        min_val[j] = data[i][j];
+                    } else if (data[i][j] > max_val[j]) {
+                        max_val[j] = data[i][j];
+                    }
+                }
+            }
+            bool quiet = true;
+            for (int j = 0; j < 3; j++) {
+                quiet = quiet && (max_val[j] - min_val[j] <= _bc_quiescent_threshold);
+            }
+            _bc_quiet_samples = quiet ? _bc_quiet_samples + n : 0;
+        }
+
+        if ((_bc_max_samples > 0 && _bc_captured_samples >= _bc_max_samples) || (_bc_quiescent_samples > 0 && _bc_quiet_samples >= _bc_quiescent_samples)) {
+            _bc_enter_idle();
+        }
+        break;
+    }
+
+    return n;
+}
+
+// output data rates in ascending order
+static const LSM303DLHCAccelerometer::OutputDataRate normal_mode_odr_ladder[] = {
+    LSM303DLHCAccelerometer::ODR_1HZ, LSM303DLHCAccelerometer::ODR_10HZ, LSM303DLHCAccelerometer::ODR_25HZ,
+    LSM303DLHCAccelerometer::ODR_50HZ, LSM303DLHCAccelerometer::ODR_100HZ, LSM303DLHCAccelerometer::ODR_200HZ,
+    LSM303DLHCAccelerometer::ODR_400HZ, LSM303DLHCAccelerometer::ODR_1344HZ
+};
+static const LSM303DLHCAccelerometer::OutputDataRate low_power_mode_odr_ladder[] = {
+    LSM303DLHCAccelerometer::ODR_1HZ, LSM303DLHCAccelerometer::ODR_10HZ, LSM303DLHCAccelerometer::ODR_25HZ,
+    LSM303DLHCAccelerometer::ODR_50HZ, LSM303DLHCAccelerometer::ODR_100HZ, LSM303DLHCAccelerometer::ODR_200HZ,
+    LSM303DLHCAccelerometer::ODR_400HZ, LSM303DLHCAccelerometer::ODR_1620HZ, LSM303DLHCAccelerometer::ODR_5376HZ
+};
+
+void LSM303DLHCAccelerometer::start_odr_governor(const ODRGovernorConfig &config)
+{
+    int ladder_size;
+
+    if (get_power_mode() == LOW_POWER_MODE) {
+        _odrg_ladder = low_power_mode_odr_ladder;
+        ladder_size = sizeof(low_power_mode_odr_ladder) / sizeof(low_power_mode_odr_ladder[0]);
+    } else {
+        _odrg_ladder = normal_mode_odr_ladder;
+        ladder_size = sizeof(normal_mode_odr_ladder) / sizeof(normal_mode_odr_ladder[0]);
+    }
+    _odrg_min_index = -1;
+    _odrg_max_index = -1;
+    for (int i = 0; i < ladder_size; i++) {
+        if (_odrg_ladder[i] == config.min_odr) {
+            _odrg_min_index = i;
+        }
+        if (_odrg_ladder[i] == config.max_odr) {
+            _odrg_max_index = i;
+        }
+    }
+    if (_odrg_min_index < 0 || _odrg_max_index < 0 || _odrg_min_index > _odrg_max_index) {
+        MBED_ERROR(MBED_ERROR_CONFIG_MISMATCH, "Invalid ODR range for current power mode");
+    }
+    if (config.down_threshold > config.up_threshold) {
+        MBED_ERROR(MBED_ERROR_INVALID_ARGUMENT, "Invalid governor thresholds");
+    }
+    _odrg_config = config;
+    _odrg_energy = 0.0f;
+
+    // start from the current output data rate if it's inside range
+    OutputDataRate odr = get_output_data_rate();
+    int index = _odrg_min_index;
+    for (int i = _odrg_min_index; i <= _odrg_max_index; i++) {
+        if (_odrg_ladder[i] == odr) {
+            index = i;
+        }
+    }
+    _odrg_apply(index);
+    _odrg_enabled = true;
+}
+
+void LSM303DLHCAccelerometer::stop_odr_governor()
+{
+    _odrg_enabled = false;
+}
+
+LSM303DLHCAccelerometer::ODRGovernorMode LSM303DLHCAccelerometer::get_odr_governor_mode()
+{
+    return _odrg_enabled ? ODRG_ENABLE : ODRG_DISABLE;
+}
+
+float LSM303DLHCAccelerometer::get_odr_governor_energy()
+{
+    return _odrg_energy;
+}
+
+void LSM303DLHCAccelerometer::_update_odr_governor(const int16_t data[][3], int n, int left_samples)
+{
+    for (int i = 0; i < n; i++) {
+        if (_odrg_samples == 0) {
+            // shift data by the first sample to prevent precision loss
+            for (int j = 0; j < 3; j++) {
+                _odrg_shift[j] = data[i][j];
+                _odrg_sum[j] = 0;
+                _odrg_sum_sq[j] = 0;
+            }
+        }
+        for (int j = 0; j < 3; j++) {
+            int32_t d = data[i][j] - _odrg_shift[j];
+            _odrg_sum[j] += d;
+            _odrg_sum_sq[j] += d * d;
+        }
+        _odrg_samples++;
+    }
+    // output data rate can be changed only if FIFO has been drained, otherwise the left samples
+    // would get timestamps of the new sample period, so the window is extended until full drain
+    if (_odrg_samples < _odrg_window_samples || left_samples > 0) {
+        return;
+    }
+
+    // sum of axis variances
+    float variance = 0.0f;
+    for (int j = 0; j < 3; j++) {
+        float mean = (float)_odrg_sum[j] / _odrg_samples;
+        variance += (float)_odrg_sum_sq[j] / _odrg_samples - mean * mean;
+    }
+    _odrg_energy = variance * _sensitivity * _sensitivity;
+    _odrg_samples = 0;
+
+    if (_odrg_energy > _odrg_config.up_threshold) {
+        _odrg_quiet_windows = 0;
+        if (_odrg_index < _odrg_max_index) {
+            _odrg_apply(_odrg_index + 1);
+        }
+    } else if (_odrg_energy < _odrg_config.down_threshold) {
+        if (++_odrg_quiet_windows >= _odrg_config.hold_windows && _odrg_index > _odrg_min_index) {
+            _odrg_apply(_odrg_index - 1);
+        }
+    } else {
+        _odrg_quiet_windows = 0;
+    }
+}
+
+// automatic full scale ranging thresholds relative to the full scale
+static const float auto_range_up_ratio = 0.9f;
+static const float auto_range_down_ratio = 0.45f;
+// number of consecutive quiet blocks to decrease full scale
+static const int auto_range_hold_blocks = 4;
+// maximal absolute value of the 12-bit output
+static const int accelerometer_max_output = 2048;
+
+void LSM303DLHCAccelerometer::set_auto_range_mode(AutoRangeMode mode, FullScale min_fs, FullScale max_fs)
+{
+    if (min_fs > max_fs) {
+        MBED_ERROR(MBED_ERROR_INVALID_ARGUMENT, "Invalid full scale range");
+    }
+    _ar_min_fs = min_fs;
+    _ar_max_fs = max_fs;
+    _ar_quiet_blocks = 0;
+    _ar_enabled = mode == AR_ENABLE;
+    if (!_ar_enabled) {
+        return;
+    }
+
+    // move current full scale into the range
+    FullScale fs = get_full_scale();
+    if (fs < min_fs) {
+        fs = min_fs;
+    } else if (fs > max_fs) {
+        fs = max_fs;
+    }
+    set_full_scale(fs);
+    _ar_update_thresholds(fs);
+}
+
+LSM303DLHCAccelerometer::AutoRangeMode LSM303DLHCAccelerometer::get_auto_range_mode()
+{
+    return _ar_enabled ? AR_ENABLE : AR_DISABLE;
+}
+
+void LSM303DLHCAccelerometer::_ar_update_thresholds(FullScale fs)
+{
+    _ar_up_threshold = (int16_t)(auto_range_up_ratio * accelerometer_max_output);
+    if (fs > FULL_SCALE_2G) {
+        // threshold of the lower full scale in the current LSB units
+        float lower_sensitivity = get_full_scale_sensitivity((FullScale)(fs - 0x10));
+        _ar_down_threshold = (int16_t)(auto_range_down_ratio * accelerometer_max_output * lower_sensitivity / get_full_scale_sensitivity(fs));
+    } else {
+        _ar_down_threshold = 0;
+    }
+}
+
+void LSM303DLHCAccelerometer::_update_auto_range(const int16_t data[][3], int n)
+{
+    if (n <= 0) {
+        return;
+    }
+    int peak = 0;
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < 3; j++) {
+            int v = data[i][j] < 0 ? -data[i][j] : data[i][j];
+            if (v > peak) {
+                peak = v;
+            }
+        }
+    }
+
+    // use cached full scale to avoid register reading
+    FullScale fs = _full_scale;
+    FullScale new_fs = fs;
+    if (peak >= _ar_up_threshold) {
+        _ar_quiet_blocks = 0;
+        if (fs < _ar_max_fs) {
+            new_fs = (FullScale)(fs + 0x10);
+        }
+    } else if (peak < _ar_down_threshold) {
+        if (++_ar_quiet_blocks >= auto_range_hold_blocks && fs > _ar_min_fs) {
+            new_fs = (FullScale)(fs - 0x10);
+        }
+    } else {
+        _ar_quiet_blocks = 0;
+    }
+    if (new_fs == fs) {
+        return;
+    }
+
+    // Remember samples that have been generated with previous full scale. FIFO_SRC_REG_A is read before
+    // CTRL_REG4_A update, so samples with new full scale cannot be counted.
+    uint8_t fifo_src = _i2c_device.read_register(FIFO_SRC_REG_A);
+    _ar_pending_samples = fifo_src & 0x20 ? 0 : (fifo_src & 0x1F) + (fifo_src & 0x40 ? 1 : 0);
+    _ar_pending_sensitivity = _sensitivity;
+    set_full_scale(new_fs);
+    _ar_update_thresholds(new_fs);
+    _ar_quiet_blocks = 0;
+    // governor window contains samples with previous full scale
+    _odrg_samples = 0;
+}
+
+void LSM303DLHCAccelerometer::_odrg_apply(int index)
+{
+    OutputDataRate odr = _odrg_ladder[index];
+    _i2c_device.update_register(CTRL_REG1_A, (odr & 0xF0) | 0x07, 0xF7);
+    _update_sample_period(get_output_data_rate_hz(odr));
+
+    _odrg_index = index;
+    _odrg_window_samples = (int)(_odrg_config.window * 1e3f / _nominal_sample_period);
+    if (_odrg_window_samples < 1) {
+        _odrg_window_samples = 1;
+    }
+    _odrg_samples = 0;
+    _odrg_quiet_windows = 0;
+}
+
+void LSM303DLHCAccelerometer::_bc_enter_idle()
+{
+    // disable FIFO and switch to low power mode
+    _i2c_device.write_registers(CTRL_REG1_A | 0x80, _bc_idle_ctrl_regs, 6);
+    _i2c_device.write_register(FIFO_CTRL_REG_A, 0x00);
+    // reset high-pass filter to current acceleration and clear latched interrupt
+    _i2c_device.read_register(REFERENCE_A);
+    _i2c_device.read_register(INT1_SOURCE_A);
+
+    _fifo_enabled = false;
+    _sample_period = _nominal_sample_period = _bc_idle_sample_period;
+    _bc_state = BCS_IDLE;
+}
+
+void LSM303DLHCAccelerometer::_bc_enter_capture()
+{
+    // clear latched interrupt and enable FIFO streaming
+    _i2c_device.read_register(INT1_SOURCE_A);
+    _i2c_device.write_register(FIFO_CTRL_REG_A, _bc_capture_fifo_ctrl);
+    _i2c_device.write_registers(CTRL_REG1_A | 0x80, _bc_capture_ctrl_regs, 6);
+
+    _fifo_enabled = true;
+    _fifo_watermark = _bc_capture_fifo_ctrl & 0x1F;
+    _sample_period = _nominal_sample_period = _bc_capture_sample_period;
+    reset_output_data_rate_estimation();
+    _bc_captured_samples = 0;
+    _bc_quiet_samples = 0;
+    _bc_state = BCS_CAPTURE;
+}
+
+void LSM303DLHCAccelerometer::_convert_block(float data[][3], int n, float sensitivity)
+{
+    if (!_cal_enabled && !_orientation_enabled) {
+        const float axes_sensitivity[3] = { sensitivity, sensitivity, sensitivity };
+        convert_raw_block((int16_t(*)[3])data, data, n, axes_sensitivity, _offset);
+        return;
+    }
+    // fuse sensitivity, calibration, orientation and offset: R W (s r - o) - u = (s R W) r - (R W o + u),
+    // where W is identity if calibration isn't set
+    float matrix[3][3];
+    float offset[3];
+    for (int i = 0; i < 3; i++) {
+        offset[i] = _offset[i];
+        for (int j = 0; j < 3; j++) {
+            float rw = 0.0f;
+            for (int k = 0; k < 3; k++) {
+                rw += _orientation[i][k] * (_cal_enabled ? _cal.matrix[k][j] : (k == j ? 1.0f : 0.0f));
+            }
+            matrix[i][j] = rw * sensitivity;
+            if (_cal_enabled) {
+                offset[i] += rw * _cal.offset[j];
+            }
+        }
+    }
+    convert_raw_block_affine((int16_t(*)[3])data, data, n, matrix, offset);
+}
+
+void LSM303DLHCAccelerometer::begin_config()
+{
+    if (_staging) {
+        return;
+    }
+    _i2c_device.read_registers(CTRL_REG1_A | 0x80, _staged_regs, 6);
+    _staged_regs[6] = _i2c_device.read_register(FIFO_CTRL_REG_A);
+    _staged_dirty = 0;
+    _staged_odr = ODR_NONE;
+    _staged_clear_data = false;
+    _staging = true;
+}
+
+void LSM303DLHCAccelerometer::commit_config()
+{
+    if (!_staging) {
+        return;
+    }
+    _staging = false;
+
+    // validate resulting power mode and output data rate combination, as any of them can be changed
+    uint8_t ctrl_reg1 = _staged_regs[0];
+    PowerMode power_mode = ctrl_reg1 & 0x08 ? LOW_POWER_MODE : NORMAL_POWER_MODE;
+    OutputDataRate odr = _decode_odr(ctrl_reg1);
+    _validate_odr(power_mode, odr);
+    if (odr != ODR_NONE && _staged_odr != ODR_NONE) {
+        // ODR bits of the ODR_1344HZ and ODR_5376HZ are the same, so check requested value too
+        _validate_odr(power_mode, _staged_odr);
+    }
+
+    // FIFO mode should be configured before FIFO enabling
+    if (_staged_dirty & (1 << 6)) {
+        _i2c_device.write_register(FIFO_CTRL_REG_A, _staged_regs[6]);
+    }
+    // write contiguous range of the modified control registers
+    int first = -1;
+    int last = -1;
+    for (int i = 0; i < 6; i++) {
+        if (_staged_dirty & (1 << i)) {
+            if (first < 0) {
+                first = i;
+            }
+            last = i;
+        }
+    }
+    if (first >= 0) {
+        _i2c_device.write_registers((CTRL_REG1_A + first) | 0x80, _staged_regs + first, last - first + 1);
+    }
+    _staged_dirty = 0;
+
+    if (_staged_clear_data) {
+        _clear_data();
+    }
+    _set_full_scale((FullScale)(_staged_regs[CTRL_REG4_A - CTRL_REG1_A] & 0x30));
+    _update_sample_period(get_output_data_rate_hz(odr));
+}
+
+void LSM303DLHCAccelerometer::cancel_config()
+{
+    _staging = false;
+    _staged_dirty = 0;
+    // restore cached values
+    _fifo_enabled = get_fifo_mode() == FIFO_ENABLE;
+    get_fifo_watermark();
+}
+
+uint8_t LSM303DLHCAccelerometer::_read_config_register(uint8_t reg, uint8_t mask)
+{
+    if (_staging) {
+        return _staged_regs[_staged_index(reg)] & mask;
+    }
+    return _i2c_device.read_register(reg, mask);
+}
+
+void LSM303DLHCAccelerometer::_update_config_register(uint8_t reg, uint8_t val, uint8_t mask)
+{
+    if (_staging) {
+        int i = _staged_index(reg);
+        _staged_regs[i] = (_staged_regs[i] & ~mask) | (val & mask);
+        _staged_dirty |= 1 << i;
+    } else {
+        _i2c_device.update_register(reg, val, mask);
+    }
+}
+
+int LSM303DLHCAccelerometer::_staged_index(uint8_t reg)
+{
+    if (reg == FIFO_CTRL_REG_A) {
+        return 6;
+    } else if (reg >= CTRL_REG1_A && reg <= CTRL_REG6_A) {
+        return reg - CTRL_REG1_A;
+    }
+    MBED_ERROR(MBED_ERROR_INVALID_ARGUMENT, "Register cannot be staged");
 }
 
 void LSM303DLHCAccelerometer::_reboot_memory_content()
@@ -391,6 +1657,11 @@ void LSM303DLHCAccelerometer::_dummy_read()
 
 void LSM303DLHCAccelerometer::_clear_data()
 {
+    if (_staging) {
+        // data should be cleared after configuration commit
+        _staged_clear_data = true;
+        return;
+    }
     uint8_t status = _i2c_device.read_register(STATUS_REG_A);
     if (status) {
         _dummy_read();
@@ -407,10 +1678,11 @@ LSM303DLHCAccelerometer::DatadaReadyInterruptMode LSM303DLHCAccelerometer::_proc
     // 0b00000x00 - I1_WTM - FIFO watermark
     // 0b0000x000 - I1_DRDY2 - purpose is unknown
     // 0b000x0000 - I1_DRDY1 - new data is generated
+    // note: I1_OVERRUN is controlled separately by set_overrun_interrupt_mode
     switch (mode) {
     case 0:
         // disable interrupts
-        _i2c_device.update_register(CTRL_REG3_A, 0x00, 0x1E);
+        _update_config_register(CTRL_REG3_A, 0x00, 0x1C);
         res = DRDY_DISABLE;
         break;
     case 1:
@@ -418,10 +1690,10 @@ LSM303DLHCAccelerometer::DatadaReadyInterruptMode LSM303DLHCAccelerometer::_proc
         fifo_mode = get_fifo_mode();
         if (fifo_mode) {
             // watermark interrupt
-            _i2c_device.update_register(CTRL_REG3_A, 0x04, 0x1E);
+            _update_config_register(CTRL_REG3_A, 0x04, 0x1C);
         } else {
             // DRDY interrupt
-            _i2c_device.update_register(CTRL_REG3_A, 0x10, 0x1E);
+            _update_config_register(CTRL_REG3_A, 0x10, 0x1C);
         }
         _clear_data();
         res = DRDY_ENABLE;
@@ -437,7 +1709,7 @@ LSM303DLHCAccelerometer::DatadaReadyInterruptMode LSM303DLHCAccelerometer::_proc
         break;
     case 3:
         // check current interrupt state
-        if (_i2c_device.read_register(CTRL_REG3_A, 0x1E)) {
+        if (_read_config_register(CTRL_REG3_A, 0x1C)) {
             res = DRDY_ENABLE;
         } else {
             res = DRDY_DISABLE;
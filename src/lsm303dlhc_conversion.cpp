@@ -0,0 +1,104 @@
+#include "lsm303dlhc_conversion.h"
+
+using namespace lsm303dlhc;
+
+#if defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 9)
+#define LSM303DLHC_CONVERSION_VECTORIZE 1
+typedef float v4sf __attribute__((vector_size(16)));
+typedef int16_t v4hi __attribute__((vector_size(8)));
+#else
+#define LSM303DLHC_CONVERSION_VECTORIZE 0
+#endif
+
+void lsm303dlhc::convert_raw_block(const int16_t raw[][3], float data[][3], int n, const float sensitivity[3], const float offset[3])
+{
+    const int16_t *src = &raw[0][0];
+    float *dst = &data[0][0];
+    const float zero_offset[3] = { 0.0f, 0.0f, 0.0f };
+    if (!offset) {
+        offset = zero_offset;
+    }
+
+    // Values are processed from the end, as the output can overlap the input:
+    // the output value i overwrites only input values with indices >= i.
+#if LSM303DLHC_CONVERSION_VECTORIZE
+    // 4 samples (12 values) are processed by 3 vectors with repeated axes pattern
+    int head = n % 4;
+    v4sf s[3];
+    v4sf o[3];
+    for (int k = 0; k < 12; k++) {
+        s[k / 4][k % 4] = sensitivity[k % 3];
+        o[k / 4][k % 4] = offset[k % 3];
+    }
+    for (int i = n * 3 - 12; i >= head * 3; i -= 12) {
+        v4hi r[3];
+        v4sf f[3];
+        // load all input values before the output writing
+        memcpy(r, src + i, sizeof(r));
+        for (int k = 0; k < 3; k++) {
+            f[k] = __builtin_convertvector(r[k], v4sf) * s[k] - o[k];
+        }
+        memcpy(dst + i, f, sizeof(f));
+    }
+#else
+    int head = n;
+#endif
+    for (int i = head - 1; i >= 0; i--) {
+        int16_t x = src[i * 3 + 0];
+        int16_t y = src[i * 3 + 1];
+        int16_t z = src[i * 3 + 2];
+        dst[i * 3 + 0] = x * sensitivity[0] - offset[0];
+        dst[i * 3 + 1] = y * sensitivity[1] - offset[1];
+        dst[i * 3 + 2] = z * sensitivity[2] - offset[2];
+    }
+}
+
+void lsm303dlhc::convert_raw_block_affine(const int16_t raw[][3], float data[][3], int n, const float matrix[3][3], const float offset[3])
+{
+    const int16_t *src = &raw[0][0];
+    float *dst = &data[0][0];
+    const float a00 = matrix[0][0], a01 = matrix[0][1], a02 = matrix[0][2];
+    const float a10 = matrix[1][0], a11 = matrix[1][1], a12 = matrix[1][2];
+    const float a20 = matrix[2][0], a21 = matrix[2][1], a22 = matrix[2][2];
+    const float b0 = offset[0], b1 = offset[1], b2 = offset[2];
+
+    // process samples from the end, as the output can overlap the input
+    for (int i = n - 1; i >= 0; i--) {
+        float x = src[i * 3 + 0];
+        float y = src[i * 3 + 1];
+        float z = src[i * 3 + 2];
+        dst[i * 3 + 0] = a00 * x + a01 * y + a02 * z - b0;
+        dst[i * 3 + 1] = a10 * x + a11 * y + a12 * z - b1;
+        dst[i * 3 + 2] = a20 * x + a21 * y + a22 * z - b2;
+    }
+}
+
+void lsm303dlhc::convert_raw_block_fixed(const int16_t raw[][3], int16_t data[][3], int n, const int32_t scale[3], const int16_t offset[3])
+{
+    const int32_t s0 = scale[0], s1 = scale[1], s2 = scale[2];
+    int32_t o0 = 0, o1 = 0, o2 = 0;
+    if (offset) {
+        o0 = offset[0];
+        o1 = offset[1];
+        o2 = offset[2];
+    }
+    // note: the products fit into int32_t for all full scales, as |raw| <= 4096 and |raw * scale| < 2^31
+    for (int i = 0; i < n; i++) {
+        int32_t x = raw[i][0];
+        int32_t y = raw[i][1];
+        int32_t z = raw[i][2];
+        data[i][0] = (int16_t)(((x * s0 + 0x8000) >> 16) - o0);
+        data[i][1] = (int16_t)(((y * s1 + 0x8000) >> 16) - o1);
+        data[i][2] = (int16_t)(((z * s2 + 0x8000) >> 16) - o2);
+    }
+}
+
+void lsm303dlhc::rotate_block(int16_t data[][3], int n, const int8_t matrix[3][3])
+{
+    for (int i = 0; i < n; i++) {
+        const int32_t v[3] = { data[i][0], data[i][1], data[i][2] };
+        for (int j = 0; j < 3; j++) {
+            data[i][j] = (int16_t)(matrix[j][0] * v[0] + matrix[j][1] * v[1] + matrix[j][2] * v[2]);
+        }
+    }
+}
@@ -0,0 +1,406 @@
+#include "lsm303dlhc_magnetometer_calibrator.h"
+#include "math.h"
+
+using namespace lsm303dlhc;
+
+MagnetometerCalibrator::MagnetometerCalibrator()
+{
+    reset();
+}
+
+MagnetometerCalibrator::~MagnetometerCalibrator()
+{
+}
+
+void MagnetometerCalibrator::reset()
+{
+    _samples = 0;
+    memset(_dtd, 0, sizeof(_dtd));
+    memset(_dt1, 0, sizeof(_dt1));
+    for (int i = 0; i < 3; i++) {
+        _min[i] = INFINITY;
+        _max[i] = -INFINITY;
+    }
+    _coverage_count = 0;
+    _coverage_stride = 1;
+}
+
+int MagnetometerCalibrator::_dtd_index(int i, int j)
+{
+    if (i > j) {
+        int t = i;
+        i = j;
+        j = t;
+    }
+    // row-wise packed upper triangle
+    return i * _N_PARAMS - i * (i - 1) / 2 + (j - i);
+}
+
+void MagnetometerCalibrator::add_sample(const float data[])
+{
+    float x = data[0];
+    float y = data[1];
+    float z = data[2];
+    // design matrix row
+    float d[_N_PARAMS] = { x * x, y * y, z * z, 2 * x * y, 2 * x * z, 2 * y * z, 2 * x, 2 * y, 2 * z };
+
+    int k = 0;
+    for (int i = 0; i < _N_PARAMS; i++) {
+        for (int j = i; j < _N_PARAMS; j++) {
+            _dtd[k++] += d[i] * d[j];
+        }
+        _dt1[i] += d[i];
+    }
+    _samples++;
+
+    // update coverage
+    for (int i = 0; i < 3; i++) {
+        if (data[i] < _min[i]) {
+            _min[i] = data[i];
+        }
+        if (data[i] > _max[i]) {
+            _max[i] = data[i];
+        }
+    }
+    // the center moves while samples are added, so keep samples to bin them against the final center
+    int index = _samples - 1;
+    if (index % _coverage_stride == 0) {
+        if (_coverage_count == _N_COVERAGE_SAMPLES) {
+            // keep every second sample and double decimation factor
+            for (int k = 0; k < _N_COVERAGE_SAMPLES / 2; k++) {
+                memcpy(_coverage_data[k], _coverage_data[k * 2], sizeof(_coverage_data[k]));
+            }
+            _coverage_count = _N_COVERAGE_SAMPLES / 2;
+            _coverage_stride *= 2;
+        }
+        if (index % _coverage_stride == 0) {
+            memcpy(_coverage_data[_coverage_count++], data, sizeof(_coverage_data[0]));
+        }
+    }
+}
+
+void MagnetometerCalibrator::add_sample_16(const int16_t data[], const float sensitivity[])
+{
+    float data_f[3] = { data[0] * sensitivity[0], data[1] * sensitivity[1], data[2] * sensitivity[2] };
+    add_sample(data_f);
+}
+
+int MagnetometerCalibrator::get_samples()
+{
+    return _samples;
+}
+
+float MagnetometerCalibrator::get_coverage()
+{
+    float center[3];
+    for (int i = 0; i < 3; i++) {
+        center[i] = (_min[i] + _max[i]) * 0.5f;
+    }
+    uint32_t sectors = 0;
+    for (int k = 0; k < _coverage_count; k++) {
+        float u[3];
+        int octant = 0;
+        int dominant_axis = 0;
+        for (int i = 0; i < 3; i++) {
+            u[i] = _coverage_data[k][i] - center[i];
+            if (u[i] < 0) {
+                octant |= 1 << i;
+                u[i] = -u[i];
+            }
+            if (u[i] > u[dominant_axis]) {
+                dominant_axis = i;
+            }
+        }
+        sectors |= 1UL << (octant * 3 + dominant_axis);
+    }
+
+    int n = 0;
+    for (uint32_t s = sectors; s; s &= s - 1) {
+        n++;
+    }
+    return (float)n / _N_SECTORS;
+}
+
+/**
+ * Solve linear system with Gaussian elimination and partial pivoting.
+ *
+ * @param a matrix n x n (it's modified)
+ * @param b vector n (it's modified)
+ * @param x solution
+ * @param n
+ * @return true on success, false if matrix is singular
+ */
+static bool solve_linear_system(float *a, float *b, float *x, int n)
+{
+    for (int col = 0; col < n; col++) {
+        int pivot = col;
+        for (int row = col + 1; row < n; row++) {
+            if (fabsf(a[row * n + col]) > fabsf(a[pivot * n + col])) {
+                pivot = row;
+            }
+        }
+        if (fabsf(a[pivot * n + col]) < 1e-12f) {
+            return false;
+        }
+        if (pivot != col) {
+            for (int k = 0; k < n; k++) {
+                float t = a[col * n + k];
+                a[col * n + k] = a[pivot * n + k];
+                a[pivot * n + k] = t;
+            }
+            float t = b[col];
+            b[col] = b[pivot];
+            b[pivot] = t;
+        }
+        for (int row = col + 1; row < n; row++) {
+            float f = a[row * n + col] / a[col * n + col];
+            for (int k = col; k < n; k++) {
+                a[row * n + k] -= f * a[col * n + k];
+            }
+            b[row] -= f * b[col];
+        }
+    }
+    for (int row = n - 1; row >= 0; row--) {
+        float s = b[row];
+        for (int k = row + 1; k < n; k++) {
+            s -= a[row * n + k] * x[k];
+        }
+        x[row] = s / a[row * n + row];
+    }
+    return true;
+}
+
+/**
+ * Eigen decomposition of the symmetric 3x3 matrix with Jacobi method.
+ *
+ * @param a symmetric matrix (it's modified)
+ * @param v eigenvectors (columns)
+ * @param w eigenvalues
+ */
+static void symmetric_eigen_3x3(float a[3][3], float v[3][3], float w[3])
+{
+    const int max_sweeps = 16;
+
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) {
+            v[i][j] = i == j ? 1.0f : 0.0f;
+        }
+    }
+    for (int sweep = 0; sweep < max_sweeps; sweep++) {
+        float off_diag = fabsf(a[0][1]) + fabsf(a[0][2]) + fabsf(a[1][2]);
+        if (off_diag < 1e-12f) {
+            break;
+        }
+        for (int p = 0; p < 2; p++) {
+            for (int q = p + 1; q < 3; q++) {
+                if (a[p][q] == 0.0f) {
+                    continue;
+                }
+                // rotation that zeroes a[p][q]
+                float theta = (a[q][q] - a[p][p]) / (2.0f * a[p][q]);
+                float t = (theta >= 0 ? 1.0f : -1.0f) / (fabsf(theta) + sqrtf(theta * theta + 1.0f));
+                float c = 1.0f / sqrtf(t * t + 1.0f);
+                float s = t * c;
+                for (int k = 0; k < 3; k++) {
+                    float akp = a[k][p];
+                    float akq = a[k][q];
+                    a[k][p] = c * akp - s * akq;
+                    a[k][q] = s * akp + c * akq;
+                }
+                for (int k = 0; k < 3; k++) {
+                    float apk = a[p][k];
+                    float aqk = a[q][k];
+                    a[p][k] = c * apk - s * aqk;
+                    a[q][k] = s * apk + c * aqk;
+                }
+                for (int k = 0; k < 3; k++) {
+                    float vkp = v[k][p];
+                    float vkq = v[k][q];
+                    v[k][p] = c * vkp - s * vkq;
+                    v[k][q] = s * vkp + c * vkq;
+                }
+            }
+        }
+    }
+    for (int i = 0; i < 3; i++) {
+        w[i] = a[i][i];
+    }
+}
+
+int MagnetometerCalibrator::compute(LSM303DLHCMagnetometer::Calibration *cal, float *fit_error)
+{
+    if (_samples < MIN_SAMPLES) {
+        return MBED_ERROR_INVALID_SIZE;
+    }
+
+    // solve normal equations D^T D p = D^T 1
+    float a[_N_PARAMS * _N_PARAMS];
+    float b[_N_PARAMS];
+    float p[_N_PARAMS];
+    for (int i = 0; i < _N_PARAMS; i++) {
+        for (int j = 0; j < _N_PARAMS; j++) {
+            a[i * _N_PARAMS + j] = _dtd[_dtd_index(i, j)];
+        }
+        b[i] = _dt1[i];
+    }
+    if (!solve_linear_system(a, b, p, _N_PARAMS)) {
+        return MBED_ERROR_INVALID_DATA_DETECTED;
+    }
+
+    if (fit_error) {
+        // |D p - 1|^2 = p^T D^T D p - 2 p^T D^T 1 + N
+        float residual = _samples;
+        for (int i = 0; i < _N_PARAMS; i++) {
+            float dtd_p = 0.0f;
+            for (int j = 0; j < _N_PARAMS; j++) {
+                dtd_p += _dtd[_dtd_index(i, j)] * p[j];
+            }
+            residual += p[i] * dtd_p - 2.0f * p[i] * _dt1[i];
+        }
+        *fit_error = residual > 0 ? sqrtf(residual / _samples) : 0.0f;
+    }
+
+    // quadric form: x^T A x + 2 v^T x = 1
+    float q[3][3] = {
+        { p[0], p[3], p[4] },
+        { p[3], p[1], p[5] },
+        { p[4], p[5], p[2] }
+    };
+    float v[3] = { p[6], p[7], p[8] };
+
+    // center: o = -A^-1 v
+    float a3[9];
+    float b3[3];
+    float o[3];
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) {
+            a3[i * 3 + j] = q[i][j];
+        }
+        b3[i] = -v[i];
+    }
+    if (!solve_linear_system(a3, b3, o, 3)) {
+        return MBED_ERROR_INVALID_DATA_DETECTED;
+    }
+
+    // (x - o)^T A (x - o) = 1 + o^T A o
+    float k = 1.0f;
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) {
+            k += o[i] * q[i][j] * o[j];
+        }
+    }
+    if (k <= 0.0f) {
+        return MBED_ERROR_INVALID_DATA_DETECTED;
+    }
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) {
+            q[i][j] /= k;
+        }
+    }
+
+    // soft-iron matrix: W = r * sqrt(A / k), where r is geometric mean of the ellipsoid semi-axes
+    float ev[3][3];
+    float ew[3];
+    symmetric_eigen_3x3(q, ev, ew);
+    if (ew[0] <= 0.0f || ew[1] <= 0.0f || ew[2] <= 0.0f) {
+        // samples don't form ellipsoid
+        return MBED_ERROR_INVALID_DATA_DETECTED;
+    }
+    float r = 1.0f / sqrtf(cbrtf(ew[0] * ew[1] * ew[2]));
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) {
+            float w = 0.0f;
+            for (int l = 0; l < 3; l++) {
+                w += ev[i][l] * sqrtf(ew[l]) * ev[j][l];
+            }
+            cal->matrix[i][j] = r * w;
+        }
+        cal->offset[i] = o[i];
+    }
+
+    return MBED_SUCCESS;
+}
+
+MagnetometerTemperatureCalibrator::MagnetometerTemperatureCalibrator()
+{
+    reset();
+}
+
+MagnetometerTemperatureCalibrator::~MagnetometerTemperatureCalibrator()
+{
+}
+
+void MagnetometerTemperatureCalibrator::reset()
+{
+    _samples = 0;
+    _t_min = INFINITY;
+    _t_max = -INFINITY;
+    _sum_t = 0.0f;
+    _sum_t2 = 0.0f;
+    memset(_sum_m, 0, sizeof(_sum_m));
+    memset(_sum_tm, 0, sizeof(_sum_tm));
+}
+
+void MagnetometerTemperatureCalibrator::add_sample(const float data[], float temperature)
+{
+    float m[4] = { data[0], data[1], data[2], sqrtf(data[0] * data[0] + data[1] * data[1] + data[2] * data[2]) };
+
+    _sum_t += temperature;
+    _sum_t2 += temperature * temperature;
+    for (int i = 0; i < 4; i++) {
+        _sum_m[i] += m[i];
+        _sum_tm[i] += temperature * m[i];
+    }
+    if (temperature < _t_min) {
+        _t_min = temperature;
+    }
+    if (temperature > _t_max) {
+        _t_max = temperature;
+    }
+    _samples++;
+}
+
+int MagnetometerTemperatureCalibrator::get_samples()
+{
+    return _samples;
+}
+
+float MagnetometerTemperatureCalibrator::get_temperature_range()
+{
+    return _samples > 0 ? _t_max - _t_min : 0.0f;
+}
+
+int MagnetometerTemperatureCalibrator::compute(LSM303DLHCMagnetometer::TemperatureCompensation *tc, float min_temperature_range)
+{
+    if (_samples < 2) {
+        return MBED_ERROR_INVALID_SIZE;
+    }
+    if (get_temperature_range() < min_temperature_range) {
+        return MBED_ERROR_INVALID_DATA_DETECTED;
+    }
+
+    float t_mean = _sum_t / _samples;
+    float t_var = _sum_t2 / _samples - t_mean * t_mean;
+    if (t_var <= 0.0f) {
+        return MBED_ERROR_INVALID_DATA_DETECTED;
+    }
+    // linear regression slopes and means
+    float slope[4];
+    float mean[4];
+    for (int i = 0; i < 4; i++) {
+        mean[i] = _sum_m[i] / _samples;
+        slope[i] = (_sum_tm[i] / _samples - t_mean * mean[i]) / t_var;
+    }
+    if (mean[3] <= 0.0f) {
+        return MBED_ERROR_INVALID_DATA_DETECTED;
+    }
+
+    // dm/dt = m_0 * k_g + k_o
+    float k_g = slope[3] / mean[3];
+    tc->reference_temperature = t_mean;
+    for (int i = 0; i < 3; i++) {
+        tc->gain_coefficients[i] = k_g;
+        tc->offset_coefficients[i] = slope[i] - k_g * mean[i];
+    }
+    return MBED_SUCCESS;
+}
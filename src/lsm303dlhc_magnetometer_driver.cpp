@@ -1,4 +1,6 @@
 #include "lsm303dlhc_magnetometer_driver.h"
+#include "lsm303dlhc_conversion.h"
+#include "math.h"
 
 using namespace lsm303dlhc;
 
@@ -6,7 +8,70 @@ LSM303DLHCMagnetometer::LSM303DLHCMagnetometer(I2C *i2c_ptr)
     : _i2c_device(_I2C_ADDRESS, i2c_ptr)
     , _xy_mag_sensitivity(0)
     , _z_mag_sensitivity(0)
-    , _mode_state(0)
+    , _xy_mg_scale(0)
+    , _z_mg_scale(0)
+    , _ar_enabled(false)
+    , _ar_min_fs(FULL_SCALE_1_3_G)
+    , _ar_max_fs(FULL_SCALE_8_1_G)
+    , _ar_fs(FULL_SCALE_1_3_G)
+    , _ar_up_threshold(0)
+    , _ar_down_threshold(0)
+    , _ar_quiet_samples(0)
+    , _ar_pending(false)
+    , _ar_pending_xy_sensitivity(0)
+    , _ar_pending_z_sensitivity(0)
+    , _ar_pending_xy_mg_scale(0)
+    , _ar_pending_z_mg_scale(0)
+    , _drdy_pin(nullptr)
+    , _drdy_queue(nullptr)
+    , _drdy_sample_cb(nullptr)
+    , _drdy_buffer(nullptr)
+    , _drdy_buffer_size(0)
+    , _drdy_buffer_count(0)
+    , _drdy_complete_cb(nullptr)
+    , _drdy_pending(false)
+    , _drdy_discard(false)
+    , _drdy_edge_time(0)
+    , _drdy_missed(0)
+    , _sc_min_period(0)
+    , _sc_valid(false)
+    , _sc_last_sample()
+    , _sc_queue(nullptr)
+    , _sc_event_id(0)
+    , _sc_poll_event_id(0)
+    , _sc_polls(0)
+    , _sc_sample_cb(nullptr)
+    , _dc_config { 1000, 4 }
+    , _dc_queue(nullptr)
+    , _dc_event_id(0)
+    , _dc_data_cb(nullptr)
+    , _dc_poll_event_id(0)
+    , _dc_start_time(0)
+    , _dc_sample_period(0)
+    , _dc_xy_sensitivity(0)
+    , _dc_z_sensitivity(0)
+    , _dc_index(0)
+    , _dc_sum()
+    , _cal_enabled(false)
+    , _cal()
+    , _cal_w_offset()
+    , _orientation_enabled(false)
+    , _orientation { { 1, 0, 0 }, { 0, 1, 0 }, { 0, 0, 1 } }
+    , _tc_enabled(false)
+    , _tc()
+    , _tc_update_period(0)
+    , _tc_update_time(0)
+    , _tc_temperature(0)
+    , _tc_scale()
+    , _tc_bias()
+    , _continuous_mode(false)
+    , _wd_enabled(true)
+    , _wd_timeout(0)
+    , _wd_last_data()
+    , _wd_last_change_time(0)
+    , _wd_last_drdy_time(0)
+    , _wd_drdy_event_id(0)
+    , _wd_stats()
 {
 }
 
@@ -14,12 +79,78 @@ LSM303DLHCMagnetometer::LSM303DLHCMagnetometer(PinName sda, PinName scl, int fre
     : _i2c_device(_I2C_ADDRESS, sda, scl, frequency)
     , _xy_mag_sensitivity(0)
     , _z_mag_sensitivity(0)
-    , _mode_state(0)
+    , _xy_mg_scale(0)
+    , _z_mg_scale(0)
+    , _ar_enabled(false)
+    , _ar_min_fs(FULL_SCALE_1_3_G)
+    , _ar_max_fs(FULL_SCALE_8_1_G)
+    , _ar_fs(FULL_SCALE_1_3_G)
+    , _ar_up_threshold(0)
+    , _ar_down_threshold(0)
+    , _ar_quiet_samples(0)
+    , _ar_pending(false)
+    , _ar_pending_xy_sensitivity(0)
+    , _ar_pending_z_sensitivity(0)
+    , _ar_pending_xy_mg_scale(0)
+    , _ar_pending_z_mg_scale(0)
+    , _drdy_pin(nullptr)
+    , _drdy_queue(nullptr)
+    , _drdy_sample_cb(nullptr)
+    , _drdy_buffer(nullptr)
+    , _drdy_buffer_size(0)
+    , _drdy_buffer_count(0)
+    , _drdy_complete_cb(nullptr)
+    , _drdy_pending(false)
+    , _drdy_discard(false)
+    , _drdy_edge_time(0)
+    , _drdy_missed(0)
+    , _sc_min_period(0)
+    , _sc_valid(false)
+    , _sc_last_sample()
+    , _sc_queue(nullptr)
+    , _sc_event_id(0)
+    , _sc_poll_event_id(0)
+    , _sc_polls(0)
+    , _sc_sample_cb(nullptr)
+    , _dc_config { 1000, 4 }
+    , _dc_queue(nullptr)
+    , _dc_event_id(0)
+    , _dc_data_cb(nullptr)
+    , _dc_poll_event_id(0)
+    , _dc_start_time(0)
+    , _dc_sample_period(0)
+    , _dc_xy_sensitivity(0)
+    , _dc_z_sensitivity(0)
+    , _dc_index(0)
+    , _dc_sum()
+    , _cal_enabled(false)
+    , _cal()
+    , _cal_w_offset()
+    , _orientation_enabled(false)
+    , _orientation { { 1, 0, 0 }, { 0, 1, 0 }, { 0, 0, 1 } }
+    , _tc_enabled(false)
+    , _tc()
+    , _tc_update_period(0)
+    , _tc_update_time(0)
+    , _tc_temperature(0)
+    , _tc_scale()
+    , _tc_bias()
+    , _continuous_mode(false)
+    , _wd_enabled(true)
+    , _wd_timeout(0)
+    , _wd_last_data()
+    , _wd_last_change_time(0)
+    , _wd_last_drdy_time(0)
+    , _wd_drdy_event_id(0)
+    , _wd_stats()
 {
 }
 
 LSM303DLHCMagnetometer::~LSM303DLHCMagnetometer()
 {
+    stop_drdy_acquisition();
+    stop_single_conversion_schedule();
+    stop_duty_cycle_schedule();
 }
 
 int LSM303DLHCMagnetometer::init(bool start)
@@ -34,10 +165,13 @@ int LSM303DLHCMagnetometer::init(bool start)
     }
 
     // set default values
+    _ar_enabled = false;
+    _ar_pending = false;
     set_temperature_sensor_mode(TS_ENABLE);
     set_output_data_rate(ODR_15_HZ);
     set_full_scale(FULL_SCALE_1_3_G);
     set_magnetometer_mode(start ? M_ENABLE : M_DISABLE);
+    reset_hang_watchdog_statistics();
 
     return MBED_SUCCESS;
 }
@@ -89,6 +223,7 @@ float LSM303DLHCMagnetometer::get_temperature_sensor_zero_offset()
 void LSM303DLHCMagnetometer::set_output_data_rate(OutputDataRate odr)
 {
     _i2c_device.update_register(CRA_REG_M, (uint8_t)(odr << 2), 0x3C);
+    _wd_update_timeout(odr);
 }
 
 LSM303DLHCMagnetometer::OutputDataRate LSM303DLHCMagnetometer::get_output_data_rate()
@@ -129,49 +264,17 @@ LSM303DLHCMagnetometer::OutputDataRate LSM303DLHCMagnetometer::get_output_data_r
 
 float LSM303DLHCMagnetometer::get_output_data_rate_hz()
 {
-    OutputDataRate odr = get_output_data_rate();
-    float res;
-
-    switch (odr) {
-    case lsm303dlhc::LSM303DLHCMagnetometer::ODR_0_75_HZ:
-        res = 0.75f;
-        break;
-    case lsm303dlhc::LSM303DLHCMagnetometer::ODR_1_5_HZ:
-        res = 1.5f;
-        break;
-    case lsm303dlhc::LSM303DLHCMagnetometer::ODR_3_0_HZ:
-        res = 3.0f;
-        break;
-    case lsm303dlhc::LSM303DLHCMagnetometer::ODR_7_5_HZ:
-        res = 7.5f;
-        break;
-    case lsm303dlhc::LSM303DLHCMagnetometer::ODR_15_HZ:
-        res = 15.0f;
-        break;
-    case lsm303dlhc::LSM303DLHCMagnetometer::ODR_30_HZ:
-        res = 30.0f;
-        break;
-    case lsm303dlhc::LSM303DLHCMagnetometer::ODR_75_HZ:
-        res = 75.0f;
-        break;
-    case lsm303dlhc::LSM303DLHCMagnetometer::ODR_220_HZ:
-        res = 220.0f;
-        break;
-    default:
-        MBED_ERROR(MBED_ERROR_UNKNOWN, "Unreachable code");
-    }
-    return res;
+    return get_output_data_rate_hz(get_output_data_rate());
 }
 
 void LSM303DLHCMagnetometer::set_magnetometer_mode(MagnetometerMode mm)
 {
     if (mm) {
         _i2c_device.write_register(MR_REG_M, 0x00);
-        _mode_state = 1;
     } else {
-        _mode_state = 0;
         _i2c_device.write_register(MR_REG_M, 0x03);
     }
+    _wd_reset(mm == M_ENABLE);
 }
 
 LSM303DLHCMagnetometer::MagnetometerMode LSM303DLHCMagnetometer::get_magnetometer_mode()
@@ -183,36 +286,15 @@ LSM303DLHCMagnetometer::MagnetometerMode LSM303DLHCMagnetometer::get_magnetomete
 void LSM303DLHCMagnetometer::set_full_scale(FullScale fs)
 {
     _i2c_device.update_register(CRB_REG_M, fs, 0xE0);
-    switch (fs) {
-    case lsm303dlhc::LSM303DLHCMagnetometer::FULL_SCALE_1_3_G:
-        _xy_mag_sensitivity = 1.0f / 1100.0f;
-        _z_mag_sensitivity = 1.0f / 980.0f;
-        break;
-    case lsm303dlhc::LSM303DLHCMagnetometer::FULL_SCALE_1_9_G:
-        _xy_mag_sensitivity = 1.0f / 885.0f;
-        _z_mag_sensitivity = 1.0f / 760.0f;
-        break;
-    case lsm303dlhc::LSM303DLHCMagnetometer::FULL_SCALE_2_5_G:
-        _xy_mag_sensitivity = 1.0f / 670.0f;
-        _z_mag_sensitivity = 1.0f / 600.0f;
-        break;
-    case lsm303dlhc::LSM303DLHCMagnetometer::FULL_SCALE_4_0_G:
-        _xy_mag_sensitivity = 1.0f / 450.0f;
-        _z_mag_sensitivity = 1.0f / 400.0f;
-        break;
-    case lsm303dlhc::LSM303DLHCMagnetometer::FULL_SCALE_4_7_GA:
-        _xy_mag_sensitivity = 1.0f / 400.0f;
-        _z_mag_sensitivity = 1.0f / 355.0f;
-        break;
-    case lsm303dlhc::LSM303DLHCMagnetometer::FULL_SCALE_5_6_G:
-        _xy_mag_sensitivity = 1.0f / 330.0f;
-        _z_mag_sensitivity = 1.0f / 295.0f;
-        break;
-    case lsm303dlhc::LSM303DLHCMagnetometer::FULL_SCALE_8_1_G:
-        _xy_mag_sensitivity = 1.0f / 230.0f;
-        _z_mag_sensitivity = 1.0f / 205.0f;
-        break;
-    }
+    _update_sensitivity(fs);
+}
+
+void LSM303DLHCMagnetometer::_update_sensitivity(FullScale fs)
+{
+    _xy_mag_sensitivity = get_full_scale_xy_sensitivity(fs);
+    _z_mag_sensitivity = get_full_scale_z_sensitivity(fs);
+    _xy_mg_scale = _sensitivity_to_mg_scale(_xy_mag_sensitivity);
+    _z_mg_scale = _sensitivity_to_mg_scale(_z_mag_sensitivity);
 }
 
 LSM303DLHCMagnetometer::FullScale LSM303DLHCMagnetometer::get_full_scale()
@@ -263,24 +345,953 @@ float LSM303DLHCMagnetometer::get_sensitivity(int axis_no)
 void LSM303DLHCMagnetometer::read_data(float data[])
 {
     int16_t data_16[3];
-    read_data_16(data_16);
-    data[0] = data_16[0] * _xy_mag_sensitivity;
-    data[1] = data_16[1] * _xy_mag_sensitivity;
-    data[2] = data_16[2] * _z_mag_sensitivity;
+    float sensitivity[3];
+    read_data_16(data_16, sensitivity);
+    _convert(data_16, sensitivity, data);
 }
 
 void LSM303DLHCMagnetometer::read_data_16(int16_t data[])
 {
-    uint8_t raw_data[6];
-    _i2c_device.read_registers(OUT_X_H_M, raw_data, 6);
-    if (_mode_state == 1) {
-        // HACK: prevent hangs in the continuous mode
-        _i2c_device.write_register(MR_REG_M, 0x00);
+    float sensitivity[3];
+    read_data_16(data, sensitivity);
+}
+
+void LSM303DLHCMagnetometer::read_data_16(int16_t data[], float sensitivity[])
+{
+    _read_frame(data, sensitivity, false);
+}
+
+int LSM303DLHCMagnetometer::read_new_data(float data[], uint8_t *status)
+{
+    int16_t data_16[3];
+    float sensitivity[3];
+    int sr = _read_frame(data_16, sensitivity, true);
+    _convert(data_16, sensitivity, data);
+    if (status) {
+        *status = sr;
     }
+    return sr & STATUS_DRDY ? 1 : 0;
+}
+
+int LSM303DLHCMagnetometer::read_new_data_16(int16_t data[], uint8_t *status)
+{
+    float sensitivity[3];
+    int sr = _read_frame(data, sensitivity, true);
+    if (status) {
+        *status = sr;
+    }
+    return sr & STATUS_DRDY ? 1 : 0;
+}
+
+void LSM303DLHCMagnetometer::read_data_mg(int16_t data[])
+{
+    float sensitivity[3];
+    int32_t mg_scale[3];
+    _read_frame(data, sensitivity, false, mg_scale);
+    convert_raw_block_fixed((int16_t(*)[3])data, (int16_t(*)[3])data, 1, mg_scale);
+    if (_orientation_enabled) {
+        rotate_block((int16_t(*)[3])data, 1, _orientation);
+    }
+}
+
+int LSM303DLHCMagnetometer::read_new_data_mg(int16_t data[], uint8_t *status)
+{
+    float sensitivity[3];
+    int32_t mg_scale[3];
+    int sr = _read_frame(data, sensitivity, true, mg_scale);
+    convert_raw_block_fixed((int16_t(*)[3])data, (int16_t(*)[3])data, 1, mg_scale);
+    if (_orientation_enabled) {
+        rotate_block((int16_t(*)[3])data, 1, _orientation);
+    }
+    if (status) {
+        *status = sr;
+    }
+    return sr & STATUS_DRDY ? 1 : 0;
+}
+
+void LSM303DLHCMagnetometer::convert_block_mg(const int16_t data_16[][3], int16_t data[][3], int n)
+{
+    const int32_t mg_scale[3] = { _xy_mg_scale, _xy_mg_scale, _z_mg_scale };
+    convert_raw_block_fixed(data_16, data, n, mg_scale);
+    if (_orientation_enabled) {
+        rotate_block(data, n, _orientation);
+    }
+}
+
+void LSM303DLHCMagnetometer::set_calibration(const Calibration *cal)
+{
+    if (!cal) {
+        _cal_enabled = false;
+        return;
+    }
+    _cal = *cal;
+    for (int i = 0; i < 3; i++) {
+        _cal_w_offset[i] = 0.0f;
+        for (int j = 0; j < 3; j++) {
+            _cal_w_offset[i] += _cal.matrix[i][j] * _cal.offset[j];
+        }
+    }
+    _cal_enabled = true;
+}
+
+void LSM303DLHCMagnetometer::_set_orientation(const int8_t matrix[3][3])
+{
+    _orientation_enabled = false;
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) {
+            _orientation[i][j] = matrix[i][j];
+            _orientation_enabled = _orientation_enabled || matrix[i][j] != (i == j ? 1 : 0);
+        }
+    }
+}
+
+void LSM303DLHCMagnetometer::_correct_data_16(int16_t data[], const float sensitivity[])
+{
+    if (!_tc_enabled && !_cal_enabled && !_orientation_enabled) {
+        return;
+    }
+    float m[3];
+    _convert(data, sensitivity, m);
+    for (int i = 0; i < 3; i++) {
+        long value = lroundf(m[i] / sensitivity[_orientation_source(i)]);
+        data[i] = (int16_t)(value > INT16_MAX ? INT16_MAX : value < INT16_MIN ? INT16_MIN : value);
+    }
+}
+
+bool LSM303DLHCMagnetometer::get_calibration(Calibration *cal)
+{
+    if (_cal_enabled) {
+        *cal = _cal;
+    }
+    return _cal_enabled;
+}
+
+void LSM303DLHCMagnetometer::set_temperature_compensation(const TemperatureCompensation *tc, uint32_t update_period)
+{
+    if (!tc) {
+        _tc_enabled = false;
+        return;
+    }
+    _tc = *tc;
+    _tc_update_period = update_period;
+    _tc_enabled = true;
+    // read temperature immediately
+    _tc_update_time = ticker_read_us(get_us_ticker_data()) - (us_timestamp_t)update_period * 1000;
+    _tc_update();
+}
+
+bool LSM303DLHCMagnetometer::get_temperature_compensation(TemperatureCompensation *tc)
+{
+    if (_tc_enabled) {
+        *tc = _tc;
+    }
+    return _tc_enabled;
+}
+
+uint32_t LSM303DLHCMagnetometer::get_temperature_compensation_update_period()
+{
+    return _tc_update_period;
+}
+
+float LSM303DLHCMagnetometer::get_compensation_temperature()
+{
+    return _tc_temperature;
+}
+
+void LSM303DLHCMagnetometer::_tc_update()
+{
+    us_timestamp_t now = ticker_read_us(get_us_ticker_data());
+    if (now - _tc_update_time < (us_timestamp_t)_tc_update_period * 1000) {
+        return;
+    }
+    _tc_update_time = now;
+    _tc_temperature = read_temperature();
+
+    // m_comp = (m - k_o * dt) / (1 + k_g * dt) = m * scale - bias
+    float dt = _tc_temperature - _tc.reference_temperature;
+    for (int i = 0; i < 3; i++) {
+        _tc_scale[i] = 1.0f / (1.0f + _tc.gain_coefficients[i] * dt);
+        _tc_bias[i] = _tc.offset_coefficients[i] * dt * _tc_scale[i];
+    }
+}
+
+void LSM303DLHCMagnetometer::convert_sample(const Sample &sample, float data[])
+{
+    _convert(sample.data, sample.sensitivity, data);
+}
+
+void LSM303DLHCMagnetometer::convert_block(const int16_t data_16[][3], float data[][3], int n)
+{
+    const float sensitivity[3] = { _xy_mag_sensitivity, _xy_mag_sensitivity, _z_mag_sensitivity };
+    if (!_tc_enabled && !_cal_enabled && !_orientation_enabled) {
+        convert_raw_block(data_16, data, n, sensitivity);
+        return;
+    }
+
+    // per-axis scale and bias: m' = m * scale - bias
+    float scale[3];
+    float bias[3];
+    for (int i = 0; i < 3; i++) {
+        scale[i] = sensitivity[i];
+        bias[i] = 0.0f;
+    }
+    if (_tc_enabled) {
+        _tc_update();
+        for (int i = 0; i < 3; i++) {
+            scale[i] *= _tc_scale[i];
+            bias[i] = _tc_bias[i];
+        }
+    }
+    if (!_cal_enabled && !_orientation_enabled) {
+        convert_raw_block(data_16, data, n, scale, bias);
+        return;
+    }
+
+    // R W (m' - o) = R W diag(scale) raw - R (W bias + W o), where W is identity if calibration isn't set
+    float matrix[3][3];
+    float offset[3];
+    for (int i = 0; i < 3; i++) {
+        offset[i] = 0.0f;
+        for (int j = 0; j < 3; j++) {
+            float rw = 0.0f;
+            for (int k = 0; k < 3; k++) {
+                rw += _orientation[i][k] * (_cal_enabled ? _cal.matrix[k][j] : (k == j ? 1.0f : 0.0f));
+            }
+            matrix[i][j] = rw * scale[j];
+            offset[i] += rw * bias[j] + (_cal_enabled ? _orientation[i][j] * _cal_w_offset[j] : 0.0f);
+        }
+    }
+    convert_raw_block_affine(data_16, data, n, matrix, offset);
+}
+
+SampleSpan<float> LSM303DLHCMagnetometer::convert_block(const SampleSpan<int16_t> &data_16, const SampleSpan<float> &data)
+{
+    int n = data_16.size < data.size ? data_16.size : data.size;
+    convert_block(data_16.data, data.data, n);
+    return data.subspan(0, n);
+}
+
+void LSM303DLHCMagnetometer::_convert(const int16_t data_16[], const float sensitivity[], float data[])
+{
+    float m[3] = { data_16[0] * sensitivity[0], data_16[1] * sensitivity[1], data_16[2] * sensitivity[2] };
+    _compensate(m, data);
+}
+
+void LSM303DLHCMagnetometer::_compensate(const float m_in[], float data[])
+{
+    float m[3] = { m_in[0], m_in[1], m_in[2] };
+    if (_tc_enabled) {
+        _tc_update();
+        for (int i = 0; i < 3; i++) {
+            m[i] = m[i] * _tc_scale[i] - _tc_bias[i];
+        }
+    }
+    if (_cal_enabled) {
+        // W (m - o) = W m - W o
+        float c[3];
+        for (int i = 0; i < 3; i++) {
+            c[i] = _cal.matrix[i][0] * m[0] + _cal.matrix[i][1] * m[1] + _cal.matrix[i][2] * m[2] - _cal_w_offset[i];
+        }
+        memcpy(m, c, sizeof(m));
+    }
+    if (!_orientation_enabled) {
+        data[0] = m[0];
+        data[1] = m[1];
+        data[2] = m[2];
+        return;
+    }
+    for (int i = 0; i < 3; i++) {
+        data[i] = _orientation[i][0] * m[0] + _orientation[i][1] * m[1] + _orientation[i][2] * m[2];
+    }
+}
+
+int LSM303DLHCMagnetometer::_read_frame(int16_t data[], float sensitivity[], bool with_status, int32_t mg_scale[])
+{
+    // status is needed to check if the conversion with new full scale has been finished
+    with_status = with_status || _ar_pending;
+
+    // SR_REG_M follows output registers, so it can be read with data in one transaction
+    uint8_t raw_data[OUT_Y_L_M - OUT_X_H_M + 2];
+    _i2c_device.read_registers(OUT_X_H_M, raw_data, with_status ? 7 : 6);
+    _decode_data(raw_data, data);
+    int status = with_status ? raw_data[SR_REG_M - OUT_X_H_M] & (STATUS_DRDY | STATUS_LOCK) : -1;
+    if (_continuous_mode && _wd_enabled) {
+        _wd_process(data, status);
+    }
+
+    bool prev_fs_sample = false;
+    if (_ar_pending) {
+        prev_fs_sample = !(status & STATUS_DRDY);
+        _ar_pending = prev_fs_sample;
+    }
+    if (prev_fs_sample) {
+        sensitivity[0] = sensitivity[1] = _ar_pending_xy_sensitivity;
+        sensitivity[2] = _ar_pending_z_sensitivity;
+        if (mg_scale) {
+            mg_scale[0] = mg_scale[1] = _ar_pending_xy_mg_scale;
+            mg_scale[2] = _ar_pending_z_mg_scale;
+        }
+    } else {
+        sensitivity[0] = sensitivity[1] = _xy_mag_sensitivity;
+        sensitivity[2] = _z_mag_sensitivity;
+        if (mg_scale) {
+            mg_scale[0] = mg_scale[1] = _xy_mg_scale;
+            mg_scale[2] = _z_mg_scale;
+        }
+        // don't process the same sample twice
+        if (_ar_enabled && (status < 0 || status & STATUS_DRDY)) {
+            _update_auto_range(data);
+        }
+    }
+    return status;
+}
+
+// automatic full scale ranging thresholds relative to the full scale
+static const float auto_range_up_ratio = 0.9f;
+static const float auto_range_down_ratio = 0.45f;
+// number of consecutive quiet samples to decrease full scale
+static const int auto_range_hold_samples = 16;
+// maximal absolute value of the 12-bit output and overflow value
+static const int magnetometer_max_output = 2048;
+static const int16_t magnetometer_overflow_value = -4096;
+
+void LSM303DLHCMagnetometer::set_auto_range_mode(AutoRangeMode mode, FullScale min_fs, FullScale max_fs)
+{
+    if (min_fs > max_fs) {
+        MBED_ERROR(MBED_ERROR_INVALID_ARGUMENT, "Invalid full scale range");
+    }
+    _ar_min_fs = min_fs;
+    _ar_max_fs = max_fs;
+    _ar_enabled = mode == AR_ENABLE;
+    if (!_ar_enabled) {
+        return;
+    }
+
+    // move current full scale into the range
+    FullScale fs = get_full_scale();
+    if (fs < min_fs) {
+        fs = min_fs;
+    } else if (fs > max_fs) {
+        fs = max_fs;
+    }
+    _ar_apply(fs);
+    _ar_pending = false;
+}
+
+LSM303DLHCMagnetometer::AutoRangeMode LSM303DLHCMagnetometer::get_auto_range_mode()
+{
+    return _ar_enabled ? AR_ENABLE : AR_DISABLE;
+}
+
+void LSM303DLHCMagnetometer::_ar_apply(FullScale fs)
+{
+    set_full_scale(fs);
+    _ar_fs = fs;
+    _ar_quiet_samples = 0;
+    _ar_up_threshold = (int16_t)(auto_range_up_ratio * magnetometer_max_output);
+    if (fs > FULL_SCALE_1_3_G) {
+        // threshold of the lower full scale in the current LSB units
+        float lower_sensitivity = get_full_scale_xy_sensitivity((FullScale)(fs - 0x20));
+        _ar_down_threshold = (int16_t)(auto_range_down_ratio * magnetometer_max_output * lower_sensitivity / _xy_mag_sensitivity);
+    } else {
+        _ar_down_threshold = 0;
+    }
+}
+
+void LSM303DLHCMagnetometer::_update_auto_range(const int16_t data[])
+{
+    bool overflow = false;
+    int peak = 0;
+    for (int i = 0; i < 3; i++) {
+        if (data[i] == magnetometer_overflow_value) {
+            overflow = true;
+        }
+        int v = data[i] < 0 ? -data[i] : data[i];
+        if (v > peak) {
+            peak = v;
+        }
+    }
+
+    FullScale new_fs = _ar_fs;
+    if (overflow || peak >= _ar_up_threshold) {
+        _ar_quiet_samples = 0;
+        if (_ar_fs < _ar_max_fs) {
+            new_fs = (FullScale)(_ar_fs + 0x20);
+        }
+    } else if (peak < _ar_down_threshold) {
+        if (++_ar_quiet_samples >= auto_range_hold_samples && _ar_fs > _ar_min_fs) {
+            new_fs = (FullScale)(_ar_fs - 0x20);
+        }
+    } else {
+        _ar_quiet_samples = 0;
+    }
+    if (new_fs == _ar_fs) {
+        return;
+    }
+
+    // output registers contain sample with previous full scale until the next conversion
+    _ar_pending_xy_sensitivity = _xy_mag_sensitivity;
+    _ar_pending_z_sensitivity = _z_mag_sensitivity;
+    _ar_pending_xy_mg_scale = _xy_mg_scale;
+    _ar_pending_z_mg_scale = _z_mg_scale;
+    _ar_pending = true;
+    _ar_apply(new_fs);
+}
+
+void LSM303DLHCMagnetometer::start_drdy_acquisition(InterruptIn *drdy_pin, EventQueue *queue, SampleCallback sample_cb)
+{
+    stop_drdy_acquisition();
+    _drdy_sample_cb = sample_cb;
+    _drdy_start(drdy_pin, queue);
+}
+
+void LSM303DLHCMagnetometer::start_drdy_acquisition(InterruptIn *drdy_pin, EventQueue *queue, Sample buffer[], int size, Callback<void(int)> complete_cb)
+{
+    if (size <= 0) {
+        MBED_ERROR(MBED_ERROR_INVALID_SIZE, "Invalid buffer size");
+    }
+    stop_drdy_acquisition();
+    _drdy_buffer = buffer;
+    _drdy_buffer_size = size;
+    _drdy_buffer_count = 0;
+    _drdy_complete_cb = complete_cb;
+    _drdy_start(drdy_pin, queue);
+}
+
+void LSM303DLHCMagnetometer::_drdy_start(InterruptIn *drdy_pin, EventQueue *queue)
+{
+    _drdy_queue = queue;
+    _drdy_missed = 0;
+    _drdy_pending = false;
+    _drdy_discard = false;
+    _drdy_pin = drdy_pin;
+    _wd_last_drdy_time = ticker_read_us(get_us_ticker_data());
+    _wd_drdy_event_id = _drdy_queue->call_every(std::chrono::milliseconds(_wd_timeout / 1000 + 1), callback(this, &LSM303DLHCMagnetometer::_wd_check_drdy));
+    if (!_wd_drdy_event_id) {
+        MBED_ERROR(MBED_ERROR_OUT_OF_MEMORY, "Event queue is full");
+    }
+    _drdy_pin->rise(callback(this, &LSM303DLHCMagnetometer::_drdy_isr));
+    if (_drdy_pin->read()) {
+        // DRDY is already high, so rising edge won't be generated until data reading.
+        // The sample should be read to get the next edge, but it's discarded, as its generation time is unknown.
+        bool queued = true;
+        {
+            CriticalSectionLock lock;
+            if (!_drdy_pending) {
+                _drdy_discard = true;
+                _drdy_isr();
+                // the sample isn't queued if queue is full
+                _drdy_discard = _drdy_pending;
+                queued = _drdy_pending;
+            }
+        }
+        if (!queued) {
+            // DRDY would stay high without the reading, so acquisition cannot be started
+            MBED_ERROR(MBED_ERROR_OUT_OF_MEMORY, "Event queue is full");
+        }
+    }
+}
+
+int LSM303DLHCMagnetometer::stop_drdy_acquisition()
+{
+    if (_drdy_pin) {
+        _drdy_pin->rise(nullptr);
+        _drdy_pin = nullptr;
+        if (_wd_drdy_event_id) {
+            _drdy_queue->cancel(_wd_drdy_event_id);
+            _wd_drdy_event_id = 0;
+        }
+    }
+    _drdy_queue = nullptr;
+    _drdy_sample_cb = nullptr;
+    _drdy_complete_cb = nullptr;
+    _drdy_buffer = nullptr;
+    return _drdy_buffer_count;
+}
+
+uint32_t LSM303DLHCMagnetometer::get_drdy_missed_samples()
+{
+    return _drdy_missed;
+}
+
+void LSM303DLHCMagnetometer::_drdy_isr()
+{
+    if (_drdy_pending) {
+        // previous sample hasn't been read yet
+        _drdy_missed++;
+        return;
+    }
+    _drdy_edge_time = ticker_read_us(get_us_ticker_data());
+    _drdy_pending = true;
+    if (!_drdy_queue->call(callback(this, &LSM303DLHCMagnetometer::_drdy_process))) {
+        // queue is full
+        _drdy_pending = false;
+        _drdy_missed++;
+    }
+}
+
+void LSM303DLHCMagnetometer::_drdy_process()
+{
+    if (!_drdy_pin) {
+        // acquisition has been stopped
+        _drdy_pending = false;
+        return;
+    }
+
+    Sample sample;
+    sample.timestamp = _drdy_edge_time;
+    read_data_16(sample.data, sample.sensitivity);
+    _wd_last_drdy_time = sample.timestamp;
+    _drdy_pending = false;
+    if (_drdy_discard) {
+        _drdy_discard = false;
+        return;
+    }
+
+    if (_drdy_buffer) {
+        _drdy_buffer[_drdy_buffer_count++] = sample;
+        if (_drdy_buffer_count >= _drdy_buffer_size) {
+            Callback<void(int)> complete_cb = _drdy_complete_cb;
+            int n = stop_drdy_acquisition();
+            if (complete_cb) {
+                complete_cb(n);
+            }
+        }
+    } else {
+        _drdy_sample_cb(sample);
+    }
+}
+
+void LSM303DLHCMagnetometer::_decode_data(const uint8_t raw_data[], int16_t data[])
+{
+    // output registers order: X, Z, Y
     data[0] = (int16_t)((raw_data[0] << 8) + raw_data[1]);
     data[1] = (int16_t)((raw_data[4] << 8) + raw_data[5]);
     data[2] = (int16_t)((raw_data[2] << 8) + raw_data[3]);
 }
 
+// typical and maximal single conversion time in milliseconds and status polling interval
+static const int single_conversion_time = 5;
+static const int single_conversion_timeout = 20;
+static const int single_conversion_poll_interval = 1;
+
+void LSM303DLHCMagnetometer::set_single_conversion_min_period(uint32_t min_period)
+{
+    _sc_min_period = min_period;
+}
+
+bool LSM303DLHCMagnetometer::_sc_rate_limited(us_timestamp_t now)
+{
+    return _sc_valid && _sc_min_period > 0 && now - _sc_last_sample.timestamp < (us_timestamp_t)_sc_min_period * 1000;
+}
+
+void LSM303DLHCMagnetometer::_sc_trigger()
+{
+    // the hang watchdog shouldn't restart continuous conversions
+    _wd_reset(false);
+    // dummy read clears DRDY of the previous conversion, so it cannot be taken as completion of the new one
+    uint8_t raw_data[6];
+    _i2c_device.read_registers(OUT_X_H_M, raw_data, 6);
+    _i2c_device.write_register(MR_REG_M, 0x01);
+}
+
+bool LSM303DLHCMagnetometer::_sc_read_sample()
+{
+    if (!(_i2c_device.read_register(SR_REG_M) & 0x01)) {
+        return false;
+    }
+    uint8_t raw_data[6];
+    _i2c_device.read_registers(OUT_X_H_M, raw_data, 6);
+    _decode_data(raw_data, _sc_last_sample.data);
+    _sc_last_sample.sensitivity[0] = _sc_last_sample.sensitivity[1] = _xy_mag_sensitivity;
+    _sc_last_sample.sensitivity[2] = _z_mag_sensitivity;
+    _sc_last_sample.timestamp = ticker_read_us(get_us_ticker_data());
+    _sc_valid = true;
+    return true;
+}
+
+int LSM303DLHCMagnetometer::read_single_conversion(Sample *sample)
+{
+    if (_sc_rate_limited(ticker_read_us(get_us_ticker_data()))) {
+        *sample = _sc_last_sample;
+        return 0;
+    }
+
+    _sc_trigger();
+
+    // wait conversion completion
+    bool drdy = false;
+    ThisThread::sleep_for(std::chrono::milliseconds(single_conversion_time));
+    for (int t = single_conversion_time; t <= single_conversion_timeout; t += single_conversion_poll_interval) {
+        if (_sc_read_sample()) {
+            drdy = true;
+            break;
+        }
+        ThisThread::sleep_for(std::chrono::milliseconds(single_conversion_poll_interval));
+    }
+    if (!drdy) {
+        return MBED_ERROR_TIME_OUT;
+    }
+
+    *sample = _sc_last_sample;
+    return 1;
+}
+
+void LSM303DLHCMagnetometer::start_single_conversion_schedule(EventQueue *queue, uint32_t period, SampleCallback sample_cb)
+{
+    stop_single_conversion_schedule();
+    _sc_queue = queue;
+    _sc_sample_cb = sample_cb;
+    _sc_event_id = _sc_queue->call_every(std::chrono::milliseconds(period), callback(this, &LSM303DLHCMagnetometer::_sc_process));
+    if (!_sc_event_id) {
+        MBED_ERROR(MBED_ERROR_OUT_OF_MEMORY, "Event queue is full");
+    }
+}
+
+void LSM303DLHCMagnetometer::stop_single_conversion_schedule()
+{
+    if (_sc_queue) {
+        _sc_queue->cancel(_sc_event_id);
+        if (_sc_poll_event_id) {
+            _sc_queue->cancel(_sc_poll_event_id);
+        }
+        _sc_queue = nullptr;
+    }
+    _sc_event_id = 0;
+    _sc_poll_event_id = 0;
+    _sc_sample_cb = nullptr;
+}
+
+void LSM303DLHCMagnetometer::_sc_process()
+{
+    if (_sc_poll_event_id || _sc_rate_limited(ticker_read_us(get_us_ticker_data()))) {
+        // previous conversion is in progress or previous sample is still fresh
+        return;
+    }
+    _sc_trigger();
+    // the event queue thread isn't blocked during conversion, completion is checked by separate event
+    _sc_polls = 0;
+    _sc_poll_event_id = _sc_queue->call_in(std::chrono::milliseconds(single_conversion_time), callback(this, &LSM303DLHCMagnetometer::_sc_poll));
+}
+
+void LSM303DLHCMagnetometer::_sc_poll()
+{
+    _sc_poll_event_id = 0;
+    if (!_sc_queue) {
+        return;
+    }
+    if (_sc_read_sample()) {
+        _sc_sample_cb(_sc_last_sample);
+    } else if (single_conversion_time + ++_sc_polls * single_conversion_poll_interval <= single_conversion_timeout) {
+        _sc_poll_event_id = _sc_queue->call_in(std::chrono::milliseconds(single_conversion_poll_interval), callback(this, &LSM303DLHCMagnetometer::_sc_poll));
+    }
+    // otherwise conversion is lost and the next one is triggered by schedule
+}
+
+// typical magnetometer current in the continuous and sleep modes in uA
+static const float duty_cycle_active_current = 110.0f;
+static const float duty_cycle_sleep_current = 1.0f;
+// assumed RMS noise of the single sample in LSB
+static const float duty_cycle_sample_noise = 1.5f;
+
+void LSM303DLHCMagnetometer::set_duty_cycle_config(const DutyCycleConfig &config)
+{
+    MBED_ASSERT(config.conversions > 0);
+    _dc_config = config;
+}
+
+void LSM303DLHCMagnetometer::get_duty_cycle_config(DutyCycleConfig *config)
+{
+    *config = _dc_config;
+}
+
+int LSM303DLHCMagnetometer::read_duty_cycle_window(float data[3])
+{
+    int err = MBED_SUCCESS;
+    _dc_wake();
+    while (_dc_index < _dc_config.conversions) {
+        // sleep until the expected end of conversion, so status is usually read once per conversion
+        ThisThread::sleep_for(std::chrono::milliseconds(_dc_delay()));
+        int ret = _dc_read_conversion();
+        if (ret < 0) {
+            err = ret;
+            break;
+        }
+    }
+    return _dc_finish(err, data);
+}
+
+void LSM303DLHCMagnetometer::start_duty_cycle_schedule(EventQueue *queue, Callback<void(const float *data)> data_cb)
+{
+    stop_duty_cycle_schedule();
+    _dc_queue = queue;
+    _dc_data_cb = data_cb;
+    _dc_event_id = _dc_queue->call_every(std::chrono::milliseconds(_dc_config.period), callback(this, &LSM303DLHCMagnetometer::_dc_process));
+    if (!_dc_event_id) {
+        MBED_ERROR(MBED_ERROR_OUT_OF_MEMORY, "Event queue is full");
+    }
+}
+
+void LSM303DLHCMagnetometer::stop_duty_cycle_schedule()
+{
+    if (_dc_queue) {
+        _dc_queue->cancel(_dc_event_id);
+        if (_dc_poll_event_id) {
+            // interrupted window shouldn't leave magnetometer in the continuous mode
+            _dc_queue->cancel(_dc_poll_event_id);
+            _i2c_device.write_register(MR_REG_M, 0x03);
+        }
+        _dc_queue = nullptr;
+    }
+    _dc_event_id = 0;
+    _dc_poll_event_id = 0;
+    _dc_data_cb = nullptr;
+}
+
+void LSM303DLHCMagnetometer::_dc_wake()
+{
+    uint8_t raw_data[6];
+    _dc_sample_period = 1e6f / get_output_data_rate_hz();
+    _dc_xy_sensitivity = _xy_mag_sensitivity;
+    _dc_z_sensitivity = _z_mag_sensitivity;
+    _dc_index = -1;
+    for (int j = 0; j < 3; j++) {
+        _dc_sum[j] = 0;
+    }
+
+    // the hang watchdog shouldn't restart continuous conversions after the window
+    _wd_reset(false);
+    // dummy read clears DRDY of the previous window
+    _i2c_device.read_registers(OUT_X_H_M, raw_data, 6);
+    _i2c_device.write_register(MR_REG_M, 0x00);
+    _dc_start_time = ticker_read_us(get_us_ticker_data());
+}
+
+int LSM303DLHCMagnetometer::_dc_delay()
+{
+    // the conversion i is finished after i + 2 sample periods, as the first one is discarded wake up conversion
+    us_timestamp_t deadline = _dc_start_time + (us_timestamp_t)((_dc_index + 2) * _dc_sample_period);
+    us_timestamp_t now = ticker_read_us(get_us_ticker_data());
+    if (deadline <= now + 1000) {
+        // the conversion is late, so check it again soon
+        return 1;
+    }
+    return (int)((deadline - now + 999) / 1000);
+}
+
+int LSM303DLHCMagnetometer::_dc_read_conversion()
+{
+    if (!(_i2c_device.read_register(SR_REG_M) & 0x01)) {
+        // allow one extra sample period and 2 ms of the oscillator and scheduling deviation
+        us_timestamp_t timeout = _dc_start_time + (us_timestamp_t)((_dc_index + 3) * _dc_sample_period) + 2000;
+        return ticker_read_us(get_us_ticker_data()) > timeout ? MBED_ERROR_TIME_OUT : 0;
+    }
+    uint8_t raw_data[6];
+    int16_t data_16[3];
+    _i2c_device.read_registers(OUT_X_H_M, raw_data, 6);
+    // the first conversion after wake up is discarded, as it can be affected by mode transition
+    if (_dc_index >= 0) {
+        _decode_data(raw_data, data_16);
+        for (int j = 0; j < 3; j++) {
+            _dc_sum[j] += data_16[j];
+        }
+    }
+    _dc_index++;
+    return 1;
+}
+
+int LSM303DLHCMagnetometer::_dc_finish(int err, float data[])
+{
+    _i2c_device.write_register(MR_REG_M, 0x03);
+    if (err) {
+        return err;
+    }
+    float m[3] = {
+        _dc_sum[0] * _dc_xy_sensitivity / _dc_config.conversions,
+        _dc_sum[1] * _dc_xy_sensitivity / _dc_config.conversions,
+        _dc_sum[2] * _dc_z_sensitivity / _dc_config.conversions
+    };
+    _compensate(m, data);
+    return MBED_SUCCESS;
+}
+
+void LSM303DLHCMagnetometer::_dc_process()
+{
+    if (_dc_poll_event_id) {
+        // previous window is in progress
+        return;
+    }
+    _dc_wake();
+    _dc_schedule_poll();
+}
+
+void LSM303DLHCMagnetometer::_dc_schedule_poll()
+{
+    _dc_poll_event_id = _dc_queue->call_in(std::chrono::milliseconds(_dc_delay()), callback(this, &LSM303DLHCMagnetometer::_dc_poll));
+    if (!_dc_poll_event_id) {
+        // queue is full, so the window is lost
+        _dc_finish(MBED_ERROR_OUT_OF_MEMORY, nullptr);
+    }
+}
+
+void LSM303DLHCMagnetometer::_dc_poll()
+{
+    _dc_poll_event_id = 0;
+    if (!_dc_queue) {
+        return;
+    }
+    int ret = _dc_read_conversion();
+    if (ret >= 0 && _dc_index < _dc_config.conversions) {
+        _dc_schedule_poll();
+        return;
+    }
+    float data[3];
+    if (_dc_finish(ret < 0 ? ret : MBED_SUCCESS, data) == MBED_SUCCESS) {
+        _dc_data_cb(data);
+    }
+}
+
+void LSM303DLHCMagnetometer::get_duty_cycle_estimation(DutyCycleEstimation *estimation)
+{
+    estimate_duty_cycle(_dc_config, get_output_data_rate(), get_full_scale(), estimation);
+}
+
+void LSM303DLHCMagnetometer::estimate_duty_cycle(const DutyCycleConfig &config, OutputDataRate odr, FullScale fs, DutyCycleEstimation *estimation)
+{
+    // window duration with discarded wake up sample
+    float window = (config.conversions + 1) * 1000.0f / get_output_data_rate_hz(odr);
+    float duty_cycle = config.period > 0 ? window / config.period : 1.0f;
+    if (duty_cycle > 1.0f) {
+        duty_cycle = 1.0f;
+    }
+    float noise = duty_cycle_sample_noise / sqrtf(config.conversions);
+
+    estimation->duty_cycle = duty_cycle;
+    estimation->current = duty_cycle * duty_cycle_active_current + (1.0f - duty_cycle) * duty_cycle_sleep_current;
+    estimation->xy_noise = noise * get_full_scale_xy_sensitivity(fs);
+    estimation->z_noise = noise * get_full_scale_z_sensitivity(fs);
+}
+
+void LSM303DLHCMagnetometer::set_hang_watchdog_mode(HangWatchdogMode mode)
+{
+    _wd_enabled = mode == HWD_ENABLE;
+    _wd_reset(_continuous_mode);
+}
+
+LSM303DLHCMagnetometer::HangWatchdogMode LSM303DLHCMagnetometer::get_hang_watchdog_mode()
+{
+    return _wd_enabled ? HWD_ENABLE : HWD_DISABLE;
+}
+
+void LSM303DLHCMagnetometer::get_hang_watchdog_statistics(HangWatchdogStatistics *stats)
+{
+    *stats = _wd_stats;
+}
+
+void LSM303DLHCMagnetometer::reset_hang_watchdog_statistics()
+{
+    memset(&_wd_stats, 0, sizeof(_wd_stats));
+}
+
+// number of sample periods without new data to detect hang
+static const int hang_timeout_periods = 4;
+// additional hang timeout in microseconds to compensate read jitter
+static const uint32_t hang_timeout_margin = 2000;
+
+void LSM303DLHCMagnetometer::_wd_reset(bool continuous_mode)
+{
+    _continuous_mode = continuous_mode;
+    // the output cannot have such value, so next frame is always treated as new one
+    _wd_last_data[0] = _wd_last_data[1] = _wd_last_data[2] = INT16_MIN;
+    _wd_last_change_time = _wd_last_drdy_time = ticker_read_us(get_us_ticker_data());
+}
+
+void LSM303DLHCMagnetometer::_wd_update_timeout(OutputDataRate odr)
+{
+    _wd_timeout = (uint32_t)(hang_timeout_periods * 1e6f / get_output_data_rate_hz(odr)) + hang_timeout_margin;
+}
+
+void LSM303DLHCMagnetometer::_wd_process(const int16_t data[], int status)
+{
+    us_timestamp_t now = ticker_read_us(get_us_ticker_data());
+    bool stale;
+    if (status >= 0) {
+        stale = !(status & STATUS_DRDY);
+    } else {
+        stale = data[0] == _wd_last_data[0] && data[1] == _wd_last_data[1] && data[2] == _wd_last_data[2];
+    }
+    if (stale) {
+        // note: the same frame is normal if data is read faster than output data rate,
+        //       but sensor noise guarantees changes during several sample periods
+        _wd_stats.stale_reads++;
+        if (now - _wd_last_change_time > _wd_timeout) {
+            _wd_stats.data_timeouts++;
+            _wd_rearm(now);
+        }
+    } else {
+        _wd_last_data[0] = data[0];
+        _wd_last_data[1] = data[1];
+        _wd_last_data[2] = data[2];
+        _wd_last_change_time = now;
+    }
+}
+
+void LSM303DLHCMagnetometer::_wd_check_drdy()
+{
+    if (!_drdy_pin || !_continuous_mode || !_wd_enabled) {
+        return;
+    }
+    us_timestamp_t now = ticker_read_us(get_us_ticker_data());
+    if (now - _wd_last_drdy_time <= _wd_timeout) {
+        return;
+    }
+    _wd_stats.drdy_timeouts++;
+    _wd_rearm(now);
+    _wd_last_drdy_time = now;
+    if (!_drdy_pending && _drdy_pin->read()) {
+        // DRDY can stuck in the high state, so read data to generate new edge.
+        // The sample is discarded, as its generation time is unknown.
+        _drdy_edge_time = now;
+        _drdy_pending = true;
+        _drdy_discard = true;
+        _drdy_process();
+    }
+}
+
+void LSM303DLHCMagnetometer::_wd_rearm(us_timestamp_t now)
+{
+    _i2c_device.write_register(MR_REG_M, 0x00);
+    _wd_stats.rearms++;
+    _wd_last_change_time = now;
+}
+
+void LSM303DLHCMagnetometer::save_config(ConfigSnapshot *config)
+{
+    _i2c_device.read_registers(CRA_REG_M, config->regs, sizeof(config->regs));
+}
+
+void LSM303DLHCMagnetometer::restore_config(const ConfigSnapshot &config)
+{
+    _i2c_device.write_registers(CRA_REG_M, config.regs, sizeof(config.regs));
+    _ar_enabled = false;
+    _ar_pending = false;
+    _update_sensitivity((FullScale)(config.regs[CRB_REG_M - CRA_REG_M] & 0xE0));
+    _wd_update_timeout((OutputDataRate)((config.regs[CRA_REG_M] & 0x1C) >> 2));
+    _wd_reset((config.regs[MR_REG_M - CRA_REG_M] & 0x03) == 0x00);
+}
+
+void LSM303DLHCMagnetometer::_apply_register_image(const uint8_t regs[], float xy_sensitivity, float z_sensitivity)
+{
+    _i2c_device.write_registers(CRA_REG_M, regs, MR_REG_M - CRA_REG_M + 1);
+    _ar_enabled = false;
+    _ar_pending = false;
+    _xy_mag_sensitivity = xy_sensitivity;
+    _z_mag_sensitivity = z_sensitivity;
+    _xy_mg_scale = _sensitivity_to_mg_scale(xy_sensitivity);
+    _z_mg_scale = _sensitivity_to_mg_scale(z_sensitivity);
+    _wd_update_timeout((OutputDataRate)((regs[CRA_REG_M] & 0x1C) >> 2));
+    _wd_reset((regs[MR_REG_M - CRA_REG_M] & 0x03) == 0x00);
+}
+
 const float LSM303DLHCMagnetometer::_temperature_sensitivity = 1.0f / 16.0f;
 const float LSM303DLHCMagnetometer::_temperature_offset = 21.0f;
@@ -0,0 +1,233 @@
+#include "lsm303dlhc_persistent_state.h"
+#include "stdio.h"
+#include "stdlib.h"
+#if MBED_CONF_LSM303DLHC_DRIVER_PERSISTENT_STATE_KVSTORE
+#include "kvstore_global_api.h"
+#endif
+
+using namespace lsm303dlhc;
+
+PersistentState::PersistentState()
+{
+    reset();
+}
+
+PersistentState::~PersistentState()
+{
+}
+
+void PersistentState::reset()
+{
+    // padding bytes are zeroed too, so CRC doesn't depend on uninitialized memory
+    memset(&_blob, 0, sizeof(_blob));
+    _blob.magic = MAGIC;
+    _blob.version = VERSION;
+    _blob.size = sizeof(Blob);
+}
+
+void PersistentState::capture(LSM303DLHCAccelerometer *acc, LSM303DLHCMagnetometer *mag, AccelerometerThermalCompensator *compensator)
+{
+    reset();
+    if (acc) {
+        acc->save_config(&_blob.acc_config);
+        _blob.acc_offset_enabled = acc->get_offset(_blob.acc_offset);
+        _blob.acc_cal_enabled = acc->get_calibration(&_blob.acc_cal);
+        _blob.sections |= SECTION_ACCELEROMETER;
+    }
+    if (mag) {
+        mag->save_config(&_blob.mag_config);
+        _blob.mag_cal_enabled = mag->get_calibration(&_blob.mag_cal);
+        _blob.mag_tc_enabled = mag->get_temperature_compensation(&_blob.mag_tc);
+        _blob.mag_tc_update_period = mag->get_temperature_compensation_update_period();
+        _blob.sections |= SECTION_MAGNETOMETER;
+    }
+    if (compensator) {
+        _blob.tc_t_min = compensator->get_node_temperature(0);
+        _blob.tc_t_step = compensator->get_node_temperature(1) - _blob.tc_t_min;
+        _blob.tc_reference_enabled = compensator->get_reference(_blob.tc_reference);
+        compensator->get_table(_blob.tc_table);
+        _blob.sections |= SECTION_THERMAL_COMPENSATOR;
+    }
+}
+
+int PersistentState::apply(LSM303DLHCAccelerometer *acc, LSM303DLHCMagnetometer *mag, AccelerometerThermalCompensator *compensator)
+{
+    // check all sections before any changes
+    if ((acc && !(_blob.sections & SECTION_ACCELEROMETER)) || (mag && !(_blob.sections & SECTION_MAGNETOMETER))) {
+        return MBED_ERROR_ITEM_NOT_FOUND;
+    }
+    if (compensator) {
+        if (!(_blob.sections & SECTION_THERMAL_COMPENSATOR)) {
+            return MBED_ERROR_ITEM_NOT_FOUND;
+        }
+        float t_min = compensator->get_node_temperature(0);
+        if (t_min != _blob.tc_t_min || compensator->get_node_temperature(1) - t_min != _blob.tc_t_step) {
+            return MBED_ERROR_CONFIG_MISMATCH;
+        }
+    }
+
+    if (acc) {
+        acc->restore_config(_blob.acc_config);
+        acc->set_offset(_blob.acc_offset_enabled ? _blob.acc_offset : nullptr);
+        acc->set_calibration(_blob.acc_cal_enabled ? &_blob.acc_cal : nullptr);
+    }
+    if (mag) {
+        // the temperature sensor is enabled by configuration before compensation enabling
+        mag->restore_config(_blob.mag_config);
+        mag->set_calibration(_blob.mag_cal_enabled ? &_blob.mag_cal : nullptr);
+        mag->set_temperature_compensation(_blob.mag_tc_enabled ? &_blob.mag_tc : nullptr, _blob.mag_tc_update_period);
+    }
+    if (compensator) {
+        compensator->set_table(_blob.tc_table);
+        compensator->set_reference(_blob.tc_reference_enabled ? _blob.tc_reference : nullptr);
+        // the compensator overrides accelerometer offset with current temperature bias
+        compensator->update(true);
+    }
+    return MBED_SUCCESS;
+}
+
+uint32_t PersistentState::get_sections()
+{
+    return _blob.sections;
+}
+
+const PersistentState::Blob &PersistentState::get_blob()
+{
+    _blob.crc = _calculate_crc(_blob);
+    return _blob;
+}
+
+int PersistentState::set_blob(const Blob &blob)
+{
+    if (blob.magic != MAGIC) {
+        return MBED_ERROR_INVALID_FORMAT;
+    }
+    if (blob.version != VERSION) {
+        return MBED_ERROR_UNSUPPORTED;
+    }
+    if (blob.size != sizeof(Blob)) {
+        return MBED_ERROR_INVALID_SIZE;
+    }
+    if (blob.crc != _calculate_crc(blob)) {
+        return MBED_ERROR_INVALID_DATA_DETECTED;
+    }
+    memcpy(&_blob, &blob, sizeof(_blob));
+    return MBED_SUCCESS;
+}
+
+#if MBED_CONF_LSM303DLHC_DRIVER_PERSISTENT_STATE_KVSTORE
+int PersistentState::save_kv(const char *key)
+{
+    const Blob &blob = get_blob();
+    return kv_set(key, &blob, sizeof(blob), 0);
+}
+
+int PersistentState::load_kv(const char *key)
+{
+    Blob blob;
+    size_t actual_size = 0;
+    int err = kv_get(key, &blob, sizeof(blob), &actual_size);
+    if (err) {
+        return err;
+    }
+    if (actual_size != sizeof(blob)) {
+        return MBED_ERROR_INVALID_SIZE;
+    }
+    return set_blob(blob);
+}
+
+int PersistentState::restore_kv(const char *key, LSM303DLHCAccelerometer *acc, LSM303DLHCMagnetometer *mag, AccelerometerThermalCompensator *compensator)
+{
+    PersistentState state;
+    int err = state.load_kv(key);
+    if (err) {
+        return err;
+    }
+    return state.apply(acc, mag, compensator);
+}
+#endif // MBED_CONF_LSM303DLHC_DRIVER_PERSISTENT_STATE_KVSTORE
+
+static bd_size_t align_up(bd_size_t size, bd_size_t block)
+{
+    return block > 1 ? (size + block - 1) / block * block : size;
+}
+
+int PersistentState::save_block_device(BlockDevice *bd, bd_addr_t addr)
+{
+    const Blob &blob = get_blob();
+    bd_size_t program_size = align_up(sizeof(blob), bd->get_program_size());
+    uint8_t *buffer = (uint8_t *)malloc(program_size);
+    if (!buffer) {
+        return MBED_ERROR_OUT_OF_MEMORY;
+    }
+    memset(buffer, bd->get_erase_value() < 0 ? 0xFF : bd->get_erase_value(), program_size);
+    memcpy(buffer, &blob, sizeof(blob));
+
+    int err = bd->erase(addr, align_up(program_size, bd->get_erase_size(addr)));
+    if (!err) {
+        err = bd->program(buffer, addr, program_size);
+    }
+    free(buffer);
+    return err;
+}
+
+int PersistentState::load_block_device(BlockDevice *bd, bd_addr_t addr)
+{
+    bd_size_t read_size = align_up(sizeof(Blob), bd->get_read_size());
+    uint8_t *buffer = (uint8_t *)malloc(read_size);
+    if (!buffer) {
+        return MBED_ERROR_OUT_OF_MEMORY;
+    }
+    int err = bd->read(buffer, addr, read_size);
+    if (!err) {
+        Blob blob;
+        memcpy(&blob, buffer, sizeof(blob));
+        err = set_blob(blob);
+    }
+    free(buffer);
+    return err;
+}
+
+int PersistentState::save_file(const char *path)
+{
+    const Blob &blob = get_blob();
+    FILE *file = fopen(path, "wb");
+    if (!file) {
+        return MBED_ERROR_WRITE_FAILED;
+    }
+    size_t written = fwrite(&blob, 1, sizeof(blob), file);
+    int close_result = fclose(file);
+    if (written != sizeof(blob) || close_result != 0) {
+        return MBED_ERROR_WRITE_FAILED;
+    }
+    return MBED_SUCCESS;
+}
+
+int PersistentState::load_file(const char *path)
+{
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        return MBED_ERROR_ITEM_NOT_FOUND;
+    }
+    Blob blob;
+    size_t read = fread(&blob, 1, sizeof(blob), file);
+    fclose(file);
+    if (read != sizeof(blob)) {
+        return MBED_ERROR_READ_FAILED;
+    }
+    return set_blob(blob);
+}
+
+uint32_t PersistentState::_calculate_crc(const Blob &blob)
+{
+    // CRC-32 (IEEE 802.3) of all fields except crc
+    const uint8_t *data = (const uint8_t *)&blob;
+    uint32_t crc = 0xFFFFFFFF;
+    for (size_t i = 0; i < offsetof(Blob, crc); i++) {
+        crc ^= data[i];
+        for (int j = 0; j < 8; j++) {
+            crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+        }
+    }
+    return ~crc;
+}
@@ -0,0 +1,177 @@
+#include "lsm303dlhc_thermal_compensator.h"
+#include "math.h"
+
+using namespace lsm303dlhc;
+
+AccelerometerThermalCompensator::AccelerometerThermalCompensator(LSM303DLHCAccelerometer *acc, LSM303DLHCMagnetometer *mag, float t_min, float t_step)
+    : _acc(acc)
+    , _mag(mag)
+    , _t_min(t_min)
+    , _t_step(t_step)
+    , _table()
+    , _reference_enabled(false)
+    , _reference()
+    , _learning_rate(0.1f)
+    , _update_period(1000)
+    , _update_time(0)
+    , _updated(false)
+    , _temperature(0)
+    , _bias()
+{
+    MBED_ASSERT(t_step > 0);
+}
+
+AccelerometerThermalCompensator::~AccelerometerThermalCompensator()
+{
+}
+
+void AccelerometerThermalCompensator::set_update_period(uint32_t period)
+{
+    _update_period = period;
+}
+
+uint32_t AccelerometerThermalCompensator::get_update_period()
+{
+    return _update_period;
+}
+
+void AccelerometerThermalCompensator::update(bool force)
+{
+    us_timestamp_t now = ticker_read_us(get_us_ticker_data());
+    if (!force && _updated && now - _update_time < (us_timestamp_t)_update_period * 1000) {
+        return;
+    }
+    _update_time = now;
+    _updated = true;
+    _temperature = _mag->read_temperature();
+    _apply_bias();
+}
+
+float AccelerometerThermalCompensator::get_temperature()
+{
+    return _temperature;
+}
+
+void AccelerometerThermalCompensator::get_bias(float bias[])
+{
+    memcpy(bias, _bias, sizeof(_bias));
+}
+
+void AccelerometerThermalCompensator::set_table(const float table[][3])
+{
+    memcpy(_table, table, sizeof(_table));
+    if (_updated) {
+        _apply_bias();
+    }
+}
+
+void AccelerometerThermalCompensator::get_table(float table[][3])
+{
+    memcpy(table, _table, sizeof(_table));
+}
+
+float AccelerometerThermalCompensator::get_node_temperature(int i)
+{
+    return _t_min + _t_step * i;
+}
+
+void AccelerometerThermalCompensator::set_reference(const float reference[])
+{
+    _reference_enabled = reference != nullptr;
+    if (_reference_enabled) {
+        memcpy(_reference, reference, sizeof(_reference));
+    }
+}
+
+bool AccelerometerThermalCompensator::get_reference(float reference[])
+{
+    if (_reference_enabled) {
+        memcpy(reference, _reference, sizeof(_reference));
+    }
+    return _reference_enabled;
+}
+
+void AccelerometerThermalCompensator::set_learning_rate(float rate)
+{
+    MBED_ASSERT(rate > 0 && rate <= 1);
+    _learning_rate = rate;
+}
+
+int AccelerometerThermalCompensator::learn(const float data[][3], int n, float threshold)
+{
+    if (n <= 0) {
+        return MBED_ERROR_INVALID_SIZE;
+    }
+
+    // block mean and stationarity check
+    float mean[3] = { 0.0f, 0.0f, 0.0f };
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < 3; j++) {
+            mean[j] += data[i][j];
+        }
+    }
+    for (int j = 0; j < 3; j++) {
+        mean[j] /= n;
+    }
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < 3; j++) {
+            if (fabsf(data[i][j] - mean[j]) > threshold) {
+                return MBED_ERROR_INVALID_DATA_DETECTED;
+            }
+        }
+    }
+
+    // the data is compensated with current bias, so restore uncompensated values
+    for (int j = 0; j < 3; j++) {
+        mean[j] += _bias[j];
+    }
+
+    int i0;
+    float w1 = _locate(_temperature, &i0);
+    float w0 = 1.0f - w1;
+    if (!_reference_enabled) {
+        // use the first block as reference
+        for (int j = 0; j < 3; j++) {
+            _reference[j] = mean[j] - (w0 * _table[i0][j] + w1 * _table[i0 + 1][j]);
+        }
+        _reference_enabled = true;
+        return MBED_SUCCESS;
+    }
+
+    // move both neighbour nodes proportionally to their interpolation weights
+    for (int j = 0; j < 3; j++) {
+        float error = mean[j] - _reference[j] - (w0 * _table[i0][j] + w1 * _table[i0 + 1][j]);
+        _table[i0][j] += _learning_rate * w0 * error;
+        _table[i0 + 1][j] += _learning_rate * w1 * error;
+    }
+    _apply_bias();
+    return MBED_SUCCESS;
+}
+
+float AccelerometerThermalCompensator::_locate(float temperature, int *i0)
+{
+    float x = (temperature - _t_min) / _t_step;
+    if (x <= 0.0f) {
+        *i0 = 0;
+        return 0.0f;
+    }
+    if (x >= TABLE_SIZE - 1) {
+        *i0 = TABLE_SIZE - 2;
+        return 1.0f;
+    }
+    *i0 = (int)x;
+    if (*i0 > TABLE_SIZE - 2) {
+        *i0 = TABLE_SIZE - 2;
+    }
+    return x - *i0;
+}
+
+void AccelerometerThermalCompensator::_apply_bias()
+{
+    int i0;
+    float w1 = _locate(_temperature, &i0);
+    for (int j = 0; j < 3; j++) {
+        _bias[j] = (1.0f - w1) * _table[i0][j] + w1 * _table[i0 + 1][j];
+    }
+    _acc->set_offset(_bias);
+}
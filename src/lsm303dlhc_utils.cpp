@@ -81,3 +81,19 @@ void I2CDevice::read_registers(uint8_t reg, uint8_t *data, uint8_t length)
         MBED_ERROR(MBED_MAKE_ERROR(MBED_MODULE_DRIVER_I2C, MBED_ERROR_CODE_READ_FAILED), "registers reading failed");
     }
 }
+
+void I2CDevice::write_registers(uint8_t reg, const uint8_t *data, uint8_t length)
+{
+    uint8_t buf[MAX_WRITE_LENGTH + 1];
+
+    if (length > MAX_WRITE_LENGTH) {
+        MBED_ERROR(MBED_ERROR_INVALID_ARGUMENT, "Too many registers to write");
+    }
+    // write register address and values
+    buf[0] = reg;
+    memcpy(buf + 1, data, length);
+    int res = _i2c_ptr->write(_address, (char *)buf, length + 1);
+    if (res) {
+        MBED_ERROR(MBED_MAKE_ERROR(MBED_MODULE_DRIVER_I2C, MBED_ERROR_CODE_WRITE_FAILED), "registers writing failed");
+    }
+}